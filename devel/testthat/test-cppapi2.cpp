@@ -0,0 +1,55 @@
+// [[Rcpp::depends(stringi)]]
+#define R_NO_REMAP
+#define STRINGI_CAPI_DEFINE_TABLE
+#include <stringi_capi.h>
+#include <Rcpp.h>
+#include <string>
+using namespace Rcpp;
+
+static void test_append(void* ctx, const char* data, int len) {
+   ((std::string*)ctx)->append(data, len);
+}
+
+// [[Rcpp::export]]
+int test_capi_init() {
+   return stri_capi_init();
+}
+
+// [[Rcpp::export]]
+IntegerVector test_capi_locate(int type, std::string pattern, std::string s, int flags) {
+   char err[256];
+   stri_capi_matcher* m = stri_capi_matcher_new(type, pattern.c_str(),
+      (int)pattern.size(), flags, NULL, err, sizeof(err));
+   if (!m) stop(err);
+   std::vector<int> ret;
+   int start, end, from = 0, n = (int)s.size(), r;
+   while (from <= n && (r = stri_capi_matcher_find(m, s.c_str(), n, from, &start, &end)) > 0) {
+      ret.push_back(start);
+      ret.push_back(end);
+      from = (end > start) ? end : end+1;
+   }
+   stri_capi_matcher_free(m);
+   if (r < 0) stop("stri_capi_matcher_find failed");
+   return wrap(ret);
+}
+
+// [[Rcpp::export]]
+SEXP test_capi_normalize(int form, std::string s) {
+   std::string out;
+   if (stri_capi_normalize(form, s.c_str(), (int)s.size(), test_append, &out) != 0)
+      return R_NilValue;
+   return Rf_ScalarString(Rf_mkCharLenCE(out.c_str(), (int)out.size(), CE_UTF8));
+}
+
+// [[Rcpp::export]]
+int test_capi_is_normalized(int form, std::string s) {
+   return stri_capi_is_normalized(form, s.c_str(), (int)s.size());
+}
+
+// [[Rcpp::export]]
+SEXP test_capi_convert(std::string to_enc, std::string s) {
+   std::string out;
+   if (stri_capi_convert(NULL, to_enc.c_str(), s.c_str(), (int)s.size(), test_append, &out) != 0)
+      return R_NilValue;
+   return RawVector(out.begin(), out.end());
+}
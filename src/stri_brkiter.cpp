@@ -31,6 +31,180 @@
 
 #include "stri_stringi.h"
 #include "stri_brkiter.h"
+#include <string>
+#include <unicode/rbbi.h>
+
+
+/** maximal number of prototypes kept by StriBrkIterCache */
+#define STRI__BRKITER_CACHE_SIZE 16
+
+
+/**
+ * A prototype break iterator stored in StriBrkIterCache
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ */
+struct StriBrkIterCacheEntry {
+   UBreakIteratorType type;  // ignored if rules are given
+   std::string locale;       // canonical locale name
+   UnicodeString rules;
+   BreakIterator* prototype;
+};
+
+
+/** Prototypes, the most recently used one is at the front */
+static std::deque<StriBrkIterCacheEntry> stri__brkiter_cache;
+
+
+/** Get a cached break iterator prototype (create it if necessary)
+ *
+ * @param type break iterator type (ignored if \code{rules} are non-empty)
+ * @param locale locale ID or NULL for default
+ * @param rules custom break rules or empty
+ * @param status [out] ICU error status
+ * @return a prototype owned by the cache or NULL on error
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ */
+static BreakIterator* stri__brkiter_cache_get(UBreakIteratorType type,
+   const char* locale, const UnicodeString& rules, UErrorCode& status)
+{
+   // the default locale may change between calls, hence the canonical name
+   Locale loc = Locale::createFromName(locale);
+   const char* locale_name = rules.isEmpty() ? loc.getName() : "";
+
+   for (std::deque<StriBrkIterCacheEntry>::iterator it = stri__brkiter_cache.begin();
+         it != stri__brkiter_cache.end(); ++it) {
+      if ((!rules.isEmpty() || (*it).type == type) && (*it).rules == rules &&
+            (*it).locale == locale_name) {
+         if (it != stri__brkiter_cache.begin()) {
+            StriBrkIterCacheEntry entry = *it;
+            stri__brkiter_cache.erase(it);
+            stri__brkiter_cache.push_front(entry);
+         }
+         return stri__brkiter_cache.front().prototype;
+      }
+   }
+
+   BreakIterator* prototype = NULL;
+   if (!rules.isEmpty()) {
+      UParseError parseErr;
+      prototype = (BreakIterator*) new RuleBasedBreakIterator(
+         rules, parseErr, status
+      );
+   }
+   else {
+      switch (type) {
+      case UBRK_CHARACTER: // character
+         prototype = BreakIterator::createCharacterInstance(loc, status);
+         break;
+      case UBRK_LINE: // line_break
+         prototype = BreakIterator::createLineInstance(loc, status);
+         break;
+      case UBRK_SENTENCE: // sentence
+         prototype = BreakIterator::createSentenceInstance(loc, status);
+         break;
+      case UBRK_WORD: // word
+         prototype = BreakIterator::createWordInstance(loc, status);
+         break;
+      default:
+         status = U_ILLEGAL_ARGUMENT_ERROR;
+      }
+   }
+
+   if (U_FAILURE(status)) {
+      if (prototype) delete prototype;
+      return NULL;
+   }
+   if (!prototype) {
+      status = U_MEMORY_ALLOCATION_ERROR;
+      return NULL;
+   }
+
+   if (stri__brkiter_cache.size() >= STRI__BRKITER_CACHE_SIZE) {
+      delete stri__brkiter_cache.back().prototype;
+      stri__brkiter_cache.pop_back();
+   }
+
+   StriBrkIterCacheEntry entry;
+   entry.type = type;
+   entry.locale = locale_name;
+   entry.rules = rules;
+   entry.prototype = prototype;
+   stri__brkiter_cache.push_front(entry);
+   return prototype;
+}
+
+
+/** Get a new break iterator
+ *
+ * The iterator is a clone of a cached prototype; the caller
+ * is responsible for deleting it.
+ *
+ * Note that R calls us from a single thread only, therefore
+ * the pool itself is not guarded by a lock. However, the clones
+ * returned are independent of each other (and of the prototype).
+ *
+ * @param type break iterator type (ignored if \code{rules} are non-empty)
+ * @param locale locale ID or NULL for default
+ * @param rules custom break rules or empty
+ * @param status [out] ICU error status
+ * @return a new break iterator or NULL on error
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ */
+BreakIterator* StriBrkIterCache::createInstance(UBreakIteratorType type,
+   const char* locale, const UnicodeString& rules, UErrorCode& status)
+{
+   BreakIterator* prototype = stri__brkiter_cache_get(type, locale, rules, status);
+   if (!prototype) return NULL;
+
+   BreakIterator* ret = prototype->clone();
+   if (!ret) status = U_MEMORY_ALLOCATION_ERROR;
+   return ret;
+}
+
+
+/** Does a break iterator use the same rules as the root locale's one?
+ *
+ * This holds, e.g., for word break iterators for most locales,
+ * but not for "en_US_POSIX", "fi", or "sv".
+ *
+ * @param briter break iterator
+ * @param type break iterator type
+ * @return logical value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+bool StriBrkIterCache::hasDefaultRules(BreakIterator* briter, UBreakIteratorType type)
+{
+   RuleBasedBreakIterator* rbbi1 = dynamic_cast<RuleBasedBreakIterator*>(briter);
+   if (!rbbi1) return false;
+
+   UErrorCode status = U_ZERO_ERROR;
+   RuleBasedBreakIterator* rbbi2 = dynamic_cast<RuleBasedBreakIterator*>(
+      stri__brkiter_cache_get(type, "", UnicodeString(), status));
+   if (U_FAILURE(status) || !rbbi2) return false;
+
+   uint32_t len1 = 0, len2 = 0;
+   const uint8_t* rules1 = rbbi1->getBinaryRules(len1);
+   const uint8_t* rules2 = rbbi2->getBinaryRules(len2);
+   if (!rules1 || !rules2 || len1 != len2) return false;
+   return (rules1 == rules2 || memcmp(rules1, rules2, (size_t)len1) == 0);
+}
+
+
+/** Delete all the cached break iterator prototypes
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ */
+void StriBrkIterCache::clear()
+{
+   for (std::deque<StriBrkIterCacheEntry>::iterator it = stri__brkiter_cache.begin();
+         it != stri__brkiter_cache.end(); ++it)
+      delete (*it).prototype;
+   stri__brkiter_cache.clear();
+}
 
 
 /** Select Break Iterator
@@ -230,11 +404,290 @@ void StriBrkIterOptions::setSkipRuleStatus(SEXP opts_brkiter) {
 }
 
 
+/* Word_Break property values (UAX #29) of ASCII characters
+ * as used by ICU's default word break rules */
+#define STRI__WB_OTHER      0
+#define STRI__WB_CR         1
+#define STRI__WB_LF         2
+#define STRI__WB_NEWLINE    3
+#define STRI__WB_ALETTER    4
+#define STRI__WB_NUMERIC    5
+#define STRI__WB_MIDNUMLET  6 /* MidNumLet or Single_Quote */
+#define STRI__WB_MIDNUM     7
+#define STRI__WB_EXTNUMLET  8
+#define STRI__WB_WSEGSPACE  9
+
+
+/** Get the Word_Break property value of an ASCII character
+ *
+ * Note that ICU excludes the colon from MidLetter
+ * (only the "fi" and "sv" rules include it), hence there is
+ * no ASCII MidLetter character here.
+ *
+ * @param c ASCII character
+ * @return one of STRI__WB_*
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+static inline int stri__brkiter_ascii_wb(char c)
+{
+   if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z'))
+      return STRI__WB_ALETTER;
+#if U_ICU_VERSION_MAJOR_NUM >= 72
+   if (c == '@')
+      return STRI__WB_ALETTER; // CLDR 42
+#endif
+   if (c >= '0' && c <= '9')
+      return STRI__WB_NUMERIC;
+   switch (c) {
+      case ASCII_CR:  return STRI__WB_CR;
+      case ASCII_LF:  return STRI__WB_LF;
+      case ASCII_VT:
+      case ASCII_FF:  return STRI__WB_NEWLINE;
+      case '.':
+      case '\'':      return STRI__WB_MIDNUMLET;
+      case ',':
+      case ';':       return STRI__WB_MIDNUM;
+      case '_':       return STRI__WB_EXTNUMLET;
+#if U_ICU_VERSION_MAJOR_NUM >= 62
+      case ' ':       return STRI__WB_WSEGSPACE; // Unicode 11
+#endif
+      default:        return STRI__WB_OTHER;
+   }
+}
+
+
+/** Determine the word boundaries in an ASCII string
+ *
+ * This gives the same results as ICU's default word break rules
+ * (UAX #29 restricted to ASCII), including the rule status values,
+ * which are used for skipping boundaries.
+ *
+ * @param str ASCII string
+ * @param n number of bytes in \code{str}
+ * @param boundaries [out] boundary positions, starting with 0
+ * @param status [out] rule status for each boundary
+ *    (of the segment preceding it)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+static void stri__brkiter_ascii_words(const char* str, R_len_t n,
+   std::vector<R_len_t>& boundaries, std::vector<int32_t>& status)
+{
+   boundaries.clear();
+   status.clear();
+   boundaries.push_back(0);
+   status.push_back(UBRK_WORD_NONE);
+   if (n <= 0) return;
+
+   int wb_prev2 = STRI__WB_OTHER; // for WB7 and WB11
+   int wb_prev = stri__brkiter_ascii_wb(str[0]);
+   int wb_cur = (n > 1) ? stri__brkiter_ascii_wb(str[1]) : STRI__WB_OTHER;
+   R_len_t last = 0;
+   for (R_len_t i=1; i<=n; ++i) {
+      // is there a break between str[i-1] (wb_prev) and str[i] (wb_cur)?
+      bool brk = true;
+      int wb_next = (i+1 < n) ? stri__brkiter_ascii_wb(str[i+1]) : STRI__WB_OTHER;
+      if (i >= n)
+         brk = true; // WB2
+      else if (wb_prev == STRI__WB_CR && wb_cur == STRI__WB_LF)
+         brk = false; // WB3
+      else if (wb_prev == STRI__WB_CR || wb_prev == STRI__WB_LF || wb_prev == STRI__WB_NEWLINE)
+         brk = true;  // WB3a
+      else if (wb_cur == STRI__WB_CR || wb_cur == STRI__WB_LF || wb_cur == STRI__WB_NEWLINE)
+         brk = true;  // WB3b
+      else if (wb_prev == STRI__WB_WSEGSPACE && wb_cur == STRI__WB_WSEGSPACE)
+         brk = false; // WB3d
+      else if (wb_prev == STRI__WB_ALETTER) {
+         if (wb_cur == STRI__WB_ALETTER || wb_cur == STRI__WB_NUMERIC ||
+               wb_cur == STRI__WB_EXTNUMLET)
+            brk = false; // WB5, WB9, WB13a
+         else if (wb_cur == STRI__WB_MIDNUMLET && wb_next == STRI__WB_ALETTER)
+            brk = false; // WB6
+      }
+      else if (wb_prev == STRI__WB_NUMERIC) {
+         if (wb_cur == STRI__WB_ALETTER || wb_cur == STRI__WB_NUMERIC ||
+               wb_cur == STRI__WB_EXTNUMLET)
+            brk = false; // WB8, WB10, WB13a
+         else if ((wb_cur == STRI__WB_MIDNUMLET || wb_cur == STRI__WB_MIDNUM) &&
+               wb_next == STRI__WB_NUMERIC)
+            brk = false; // WB12
+      }
+      else if (wb_prev == STRI__WB_EXTNUMLET) {
+         if (wb_cur == STRI__WB_ALETTER || wb_cur == STRI__WB_NUMERIC ||
+               wb_cur == STRI__WB_EXTNUMLET)
+            brk = false; // WB13a, WB13b
+      }
+      else if (wb_prev == STRI__WB_MIDNUMLET) {
+         if (wb_prev2 == STRI__WB_ALETTER && wb_cur == STRI__WB_ALETTER)
+            brk = false; // WB7
+         else if (wb_prev2 == STRI__WB_NUMERIC && wb_cur == STRI__WB_NUMERIC)
+            brk = false; // WB11
+      }
+      else if (wb_prev == STRI__WB_MIDNUM) {
+         if (wb_prev2 == STRI__WB_NUMERIC && wb_cur == STRI__WB_NUMERIC)
+            brk = false; // WB11
+      }
+
+      if (brk) {
+         // ICU's rule status depends on the last rule applied
+         int32_t cur_status = UBRK_WORD_NONE;
+         if (wb_prev == STRI__WB_ALETTER)
+            cur_status = UBRK_WORD_LETTER;
+         else if (wb_prev == STRI__WB_NUMERIC)
+            cur_status = UBRK_WORD_NUMBER;
+         else if (wb_prev == STRI__WB_EXTNUMLET && i-last > 1)
+            cur_status = (wb_prev2 == STRI__WB_NUMERIC) ? UBRK_WORD_NUMBER : UBRK_WORD_LETTER;
+
+         boundaries.push_back(i);
+         status.push_back(cur_status);
+         last = i;
+      }
+
+      wb_prev2 = wb_prev;
+      wb_prev = wb_cur;
+      wb_cur = wb_next;
+   }
+}
+
+
+/** Check if stri__brkiter_ascii_words() agrees with ICU
+ *
+ * The Word_Break property values of a few ASCII characters have changed
+ * across Unicode/CLDR versions. Therefore, before the ASCII fast path
+ * is enabled, the results are compared against the ICU version
+ * we are linked with on strings exercising each ASCII character
+ * in different contexts. This is done only once.
+ *
+ * @return logical value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+bool StriRuleBasedBreakIterator::checkAsciiWords()
+{
+   static int verdict = -1;
+   if (verdict >= 0) return (verdict > 0);
+
+   UErrorCode status = U_ZERO_ERROR;
+   BreakIterator* briter = StriBrkIterCache::createInstance(UBRK_WORD, "", UnicodeString(), status);
+   if (U_FAILURE(status) || !briter) {
+      verdict = 0;
+      return false;
+   }
+
+   const char* patterns[] = {
+      "aXa", "1X1", "XX", "aX", "Xa", "1X", "X1", "_X", "X_", "X X", "a.X",
+      "X.a", "1,X", "X,1", "a'X", "X'1", "X\r\n", "Xa_1.2", NULL
+   };
+
+   std::string str;
+   std::vector<R_len_t> boundaries1, boundaries2;
+   std::vector<int32_t> status1, status2;
+   UText* ut = NULL;
+   verdict = 1;
+   for (int c=1; verdict > 0 && c<128; ++c) {
+      for (int k=0; verdict > 0 && patterns[k]; ++k) {
+         str.clear();
+         for (const char* p=patterns[k]; *p; ++p)
+            str.push_back((*p == 'X') ? (char)c : *p);
+
+         status = U_ZERO_ERROR;
+         ut = utext_openUTF8(ut, str.c_str(), (int64_t)str.size(), &status);
+         if (U_SUCCESS(status)) briter->setText(ut, status);
+         if (U_FAILURE(status)) {
+            verdict = 0;
+            break;
+         }
+
+         boundaries1.clear();
+         status1.clear();
+         for (int32_t pos = briter->first(); pos != BreakIterator::DONE; pos = briter->next()) {
+            boundaries1.push_back(pos);
+            status1.push_back(briter->getRuleStatus());
+         }
+
+         stri__brkiter_ascii_words(str.c_str(), (R_len_t)str.size(), boundaries2, status2);
+         if (boundaries1 != boundaries2 || status1 != status2)
+            verdict = 0;
+      }
+   }
+
+   if (ut) utext_close(ut);
+   delete briter;
+   return (verdict > 0);
+}
+
+
+/** Set up the ASCII word boundaries for the current search string
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+void StriRuleBasedBreakIterator::setupAsciiWords()
+{
+   stri__brkiter_ascii_words(searchStr, searchLen, asciiBoundaries, asciiRuleStatus);
+   asciiIndex = 0;
+}
+
+
+/** Move to the first boundary (either in the ASCII or ICU mode)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+R_len_t StriRuleBasedBreakIterator::iterFirst()
+{
+   if (!asciiMode) return rbiterator->first();
+   asciiIndex = 0;
+   return asciiBoundaries[0];
+}
+
+
+/** Move to the last boundary (either in the ASCII or ICU mode)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+R_len_t StriRuleBasedBreakIterator::iterLast()
+{
+   if (!asciiMode) return rbiterator->last();
+   asciiIndex = (R_len_t)asciiBoundaries.size()-1;
+   return asciiBoundaries[asciiIndex];
+}
+
+
+/** Move to the next boundary (either in the ASCII or ICU mode)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+R_len_t StriRuleBasedBreakIterator::iterNext()
+{
+   if (!asciiMode) return rbiterator->next();
+   if (asciiIndex+1 >= (R_len_t)asciiBoundaries.size())
+      return BreakIterator::DONE;
+   return asciiBoundaries[++asciiIndex];
+}
+
+
+/** Move to the previous boundary (either in the ASCII or ICU mode)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ */
+R_len_t StriRuleBasedBreakIterator::iterPrevious()
+{
+   if (!asciiMode) return rbiterator->previous();
+   if (asciiIndex <= 0)
+      return BreakIterator::DONE;
+   return asciiBoundaries[--asciiIndex];
+}
+
+
 /**
  *
  * @ version 0.4-1 (Marek Gagolewski, 2014-12-03)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ *    new arg `isASCII`: ICU is bypassed for ASCII strings
+ *    if we're looking for word boundaries with the default rules
  */
-void StriRuleBasedBreakIterator::setupMatcher(const char* _searchStr, R_len_t _searchLen)
+void StriRuleBasedBreakIterator::setupMatcher(const char* _searchStr, R_len_t _searchLen, bool isASCII)
 {
    if (!rbiterator) open();
 
@@ -242,6 +695,12 @@ void StriRuleBasedBreakIterator::setupMatcher(const char* _searchStr, R_len_t _s
    this->searchLen = _searchLen;
    this->searchPos = BreakIterator::DONE;
 
+   this->asciiMode = (isASCII && asciiAllowed);
+   if (this->asciiMode) {
+      setupAsciiWords();
+      return;
+   }
+
    UErrorCode status = U_ZERO_ERROR;
    this->searchText = utext_openUTF8(this->searchText,
       _searchStr, _searchLen, &status);
@@ -263,16 +722,20 @@ void StriRuleBasedBreakIterator::setupMatcher(const char* _searchStr, R_len_t _s
  *
  * @version 0.4-1 (Marek Gagolews, 2014-12-03)
  *    moved to StriRuleBasedBreakIterator
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ *    ASCII mode
  */
 bool StriRuleBasedBreakIterator::ignoreBoundary() {
 #ifndef NDEBUG
-   if (!rbiterator || !searchText)
+   if (!rbiterator || (!searchText && !asciiMode))
       throw StriException("!NDEBUG: StriRuleBasedBreakIterator::ignoreBoundary()");
 #endif
 
    if (skip_size <= 0) return false;
 
-   int rule = rbiterator->getRuleStatus();   /* this is ICU 52 */
+   int rule = asciiMode ? asciiRuleStatus[asciiIndex]
+                        : rbiterator->getRuleStatus();   /* this is ICU 52 */
    for (int i=0; i<skip_size; i += 2) {
       // skip_size is even - that's sure
       if (rule >= skip_rules[i] && rule < skip_rules[i+1])
@@ -294,7 +757,7 @@ void StriRuleBasedBreakIterator::first()
       throw StriException("!NDEBUG: StriRuleBasedBreakIterator::first");
 #endif
 
-   this->searchPos = rbiterator->first(); // ICU man: "The offset of the beginning of the text, zero."
+   this->searchPos = iterFirst(); // ICU man: "The offset of the beginning of the text, zero."
 
 #ifndef NDBEGUG
    if (this->searchPos != 0)
@@ -309,7 +772,7 @@ void StriRuleBasedBreakIterator::first()
  */
 bool StriRuleBasedBreakIterator::next()
 {
-   while ((this->searchPos = rbiterator->next()) != BreakIterator::DONE) {
+   while ((this->searchPos = iterNext()) != BreakIterator::DONE) {
       if (!ignoreBoundary())
          return true;
    }
@@ -324,7 +787,7 @@ bool StriRuleBasedBreakIterator::next()
 bool StriRuleBasedBreakIterator::next(std::pair<R_len_t, R_len_t>& bdr)
 {
    R_len_t lastPos = searchPos;
-   while ((searchPos = rbiterator->next()) != BreakIterator::DONE) {
+   while ((searchPos = iterNext()) != BreakIterator::DONE) {
       if (!ignoreBoundary()) {
          bdr.first  = lastPos;
          bdr.second = searchPos;
@@ -350,8 +813,8 @@ void StriRuleBasedBreakIterator::last()
       throw StriException("!NDEBUG: StriRuleBasedBreakIterator::last");
 #endif
 
-   rbiterator->first();
-   this->searchPos = rbiterator->last(); // ICU man: "The text's past-the-end offset. "
+   iterFirst();
+   this->searchPos = iterLast(); // ICU man: "The text's past-the-end offset. "
 
 #ifndef NDBEGUG
    if (this->searchPos > this->searchLen)
@@ -369,12 +832,12 @@ bool StriRuleBasedBreakIterator::previous(std::pair<R_len_t, R_len_t>& bdr)
    do {
       if (!ignoreBoundary()) {
          bdr.second  = searchPos;
-         searchPos = rbiterator->previous();
+         searchPos = iterPrevious();
          if (searchPos == BreakIterator::DONE) return false;
          bdr.first = searchPos;
          return true;
       }
-      searchPos = rbiterator->previous();
+      searchPos = iterPrevious();
    }
    while (searchPos != BreakIterator::DONE);
    return false;
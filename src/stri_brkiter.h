@@ -90,6 +90,30 @@ class StriBrkIterOptions {
 };
 
 
+/**
+ * A global pool of break iterator prototypes
+ *
+ * Creating a break iterator requires loading (and compiling)
+ * the break rules from ICU data, which is costly compared to processing
+ * short strings. Therefore, for each (type, locale, rules) triple,
+ * a prototype is created only once and each user gets its own clone.
+ * Clones share the (read-only) rules data, but they have
+ * their own state, so each one may be used independently.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ */
+class StriBrkIterCache {
+   public:
+
+      static BreakIterator* createInstance(UBreakIteratorType type,
+         const char* locale, const UnicodeString& rules, UErrorCode& status);
+
+      static void clear();
+
+      static bool hasDefaultRules(BreakIterator* briter, UBreakIteratorType type);
+};
+
+
 /**
  * A class to manage a break iterator
  *
@@ -100,6 +124,9 @@ class StriBrkIterOptions {
  * @version 1.1.3 (Marek Gagolewski, 2017-01-07) UBRK_COUNT deprecated
  *
  * @version 1.1.6 (Marek Gagolewski, 2017-04-22) Add support for RBBI
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ *    clone iterators from StriBrkIterCache
  */
 class StriUBreakIterator : public StriBrkIterOptions {
    private:
@@ -110,31 +137,11 @@ class StriUBreakIterator : public StriBrkIterOptions {
 #ifndef NDEBUG
          if (uiterator) throw StriException("!NDEBUG: StriUBreakIterator::open()");
 #endif
+         // ICU's UBreakIterator is just a BreakIterator in disguise
+         // (this is what ubrk_open() and ubrk_close() assume)
          UErrorCode status = U_ZERO_ERROR;
-         if (!rules.isEmpty()) {
-            UParseError parseErr;
-            uiterator = ubrk_openRules(rules.getTerminatedBuffer(),
-                                       -1/*null-terminated*/, NULL, 0,
-                                       &parseErr, &status);
-         }
-         else {
-            switch (type) {
-            case UBRK_CHARACTER: // character
-               uiterator = ubrk_open(UBRK_CHARACTER, locale, NULL, 0, &status);
-               break;
-            case UBRK_LINE: // line_break
-               uiterator = ubrk_open(UBRK_LINE, locale, NULL, 0, &status);
-               break;
-            case UBRK_SENTENCE: // sentence
-               uiterator = ubrk_open(UBRK_SENTENCE, locale, NULL, 0, &status);
-               break;
-            case UBRK_WORD: // word
-               uiterator = ubrk_open(UBRK_WORD, locale, NULL, 0, &status);
-               break;
-            default:
-               throw StriException(MSG__INTERNAL_ERROR);
-            }
-         }
+         uiterator = (UBreakIterator*)StriBrkIterCache::createInstance(
+            type, locale, rules, status);
          STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
       }
 
@@ -194,6 +201,12 @@ class StriUBreakIterator : public StriBrkIterOptions {
  * separate class
  *
  * @version 1.1.6 (Marek Gagolewski, 2017-04-22) Add support for RBBI
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ *    clone iterators from StriBrkIterCache
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-29)
+ *    ASCII fast path for word boundaries
  */
 class StriRuleBasedBreakIterator : public StriBrkIterOptions {
    private:
@@ -204,46 +217,43 @@ class StriRuleBasedBreakIterator : public StriBrkIterOptions {
       const char* searchStr; // owned by caller
       R_len_t searchLen; // in bytes
 
+      bool asciiAllowed; // may we bypass ICU on ASCII strings?
+      bool asciiMode;    // are the boundaries below in use?
+      std::vector<R_len_t> asciiBoundaries;
+      std::vector<int32_t> asciiRuleStatus;
+      R_len_t asciiIndex;
+
       void setEmptyOpts() {
          rbiterator = NULL;
          searchText = NULL;
          searchPos = BreakIterator::DONE;
          searchStr = NULL;
          searchLen = 0;
+         asciiAllowed = false;
+         asciiMode = false;
+         asciiIndex = 0;
       }
 
       void open() {
          UErrorCode status = U_ZERO_ERROR;
-         Locale loc = Locale::createFromName(locale);
-         if (!rules.isEmpty()) {
-            UParseError parseErr;
-            rbiterator = (BreakIterator*) new RuleBasedBreakIterator(
-               UnicodeString(rules), parseErr, status
-            );
-         }
-         else {
-            switch (type) {
-            case UBRK_CHARACTER: // character
-               rbiterator = (BreakIterator*)BreakIterator::createCharacterInstance(loc, status);
-               break;
-            case UBRK_LINE: // line_break
-               rbiterator = (BreakIterator*)BreakIterator::createLineInstance(loc, status);
-               break;
-            case UBRK_SENTENCE: // sentence
-               rbiterator = (BreakIterator*)BreakIterator::createSentenceInstance(loc, status);
-               break;
-            case UBRK_WORD: // word
-               rbiterator = (BreakIterator*)BreakIterator::createWordInstance(loc, status);
-               break;
-            default:
-               throw StriException(MSG__INTERNAL_ERROR);
-            }
-         }
+         rbiterator = StriBrkIterCache::createInstance(type, locale, rules, status);
          STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+
+         asciiAllowed = (type == UBRK_WORD && rules.isEmpty() &&
+            StriBrkIterCache::hasDefaultRules(rbiterator, type) &&
+            checkAsciiWords());
       }
 
       bool ignoreBoundary();
 
+      static bool checkAsciiWords();
+
+      void setupAsciiWords();
+      R_len_t iterFirst();
+      R_len_t iterLast();
+      R_len_t iterNext();
+      R_len_t iterPrevious();
+
    public:
 
       StriRuleBasedBreakIterator()
@@ -275,7 +285,7 @@ class StriRuleBasedBreakIterator : public StriBrkIterOptions {
          }
       }
 
-      void setupMatcher(const char* searchStr, R_len_t searchLen);
+      void setupMatcher(const char* searchStr, R_len_t searchLen, bool isASCII=false);
 
       void first();
       bool next();
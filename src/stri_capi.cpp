@@ -0,0 +1,563 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#define STRINGI_CAPI_INTERNAL
+#include "stri_stringi.h"
+#include "stri_capi.h"
+#include "stri_bytesearch_matcher.h"
+#include "stri_container_charclass.h"
+#include <unicode/regex.h>
+#include <unicode/usearch.h>
+#include <unicode/ucol.h>
+#include <unicode/ucnv.h>
+#include <unicode/normalizer2.h>
+#include <unicode/bytestream.h>
+#include <R_ext/Rdynload.h>
+#include <string>
+#include <vector>
+#include <algorithm>
+#include <cstring>
+
+
+/* The functions in this file form stringi's C API (see stri_capi.h).
+ *
+ * They must not call any R API functions, nor let any exceptions
+ * escape: they may be called from threads other than R's main one
+ * and from C code.
+ */
+
+
+/** Copy an error message to a user-supplied buffer
+ *
+ * @param errbuf buffer, may be NULL
+ * @param errbuf_size buffer size
+ * @param msg message
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+static void stri__capi_set_error(char* errbuf, int errbuf_size, const char* msg)
+{
+   if (!errbuf || errbuf_size <= 0) return;
+   int k = 0;
+   for (; k < errbuf_size-1 && msg[k]; ++k)
+      errbuf[k] = msg[k];
+   errbuf[k] = '\0';
+}
+
+
+/** Convert a UTF-8 string to UTF-16 and record the UTF-16 -> UTF-8
+ *  index mapping
+ *
+ * @param s string
+ * @param n number of bytes in s
+ * @param out [out] UTF-16 string
+ * @param idx [out] idx[k] is the byte offset of the code point
+ *    the k-th UTF-16 code unit belongs to; idx[out.length()] == n
+ * @return false on invalid UTF-8
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+static bool stri__capi_utf8_to_utf16(const char* s, int n,
+   UnicodeString& out, std::vector<int>& idx)
+{
+   out.remove();
+   idx.clear();
+   idx.reserve(n+1);
+   int j = 0;
+   while (j < n) {
+      int jlast = j;
+      UChar32 c;
+      U8_NEXT(s, j, n, c);
+      if (c < 0) return false;
+      out.append(c);
+      idx.push_back(jlast);
+      if (U16_LENGTH(c) == 2) idx.push_back(jlast);
+   }
+   idx.push_back(n);
+   return true;
+}
+
+
+/** Is a string in valid UTF-8?
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+static bool stri__capi_utf8_valid(const char* s, int n)
+{
+   int j = 0;
+   while (j < n) {
+      if ((uint8_t)s[j] < 0x80) { ++j; continue; }
+      UChar32 c;
+      U8_NEXT(s, j, n, c);
+      if (c < 0) return false;
+   }
+   return true;
+}
+
+
+/**
+ * A compiled pattern, as seen by other packages via
+ * the opaque stri_capi_matcher type
+ *
+ * Fixed patterns and character classes are matched on UTF-8 directly.
+ * Regex- and collation-based matchers work on UTF-16;
+ * the last converted string is cached so that iterating over
+ * all the matches in a string converts it only once.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+struct stri_capi_matcher {
+
+   int type;
+   std::string pattern;
+
+   StriByteSearchMatcher* fixed;   // STRI_CAPI_FIXED
+   StriCharClass* charclass;       // STRI_CAPI_CHARCLASS
+   RegexMatcher* regex;            // STRI_CAPI_REGEX
+   UCollator* col;                 // STRI_CAPI_COLL
+   UStringSearch* search;          // STRI_CAPI_COLL, created on first use
+   UnicodeString pattern16;        // STRI_CAPI_COLL
+
+   // UTF-16 cache (regex, coll)
+   const char* last_s;
+   int last_n;
+   UnicodeString last16;
+   std::vector<int> last_idx;
+
+   stri_capi_matcher(int _type)
+      : type(_type), fixed(NULL), charclass(NULL), regex(NULL),
+        col(NULL), search(NULL), last_s(NULL), last_n(-1)
+   { }
+
+   ~stri_capi_matcher()
+   {
+      if (fixed) delete fixed;
+      if (charclass) delete charclass;
+      if (regex) delete regex;
+      if (search) usearch_close(search);
+      if (col) ucol_close(col);
+   }
+
+
+   /** make last16 a UTF-16 version of s
+    *
+    * @return false on invalid UTF-8
+    */
+   bool prepare16(const char* s, int n, int from)
+   {
+      if (from > 0 && s == last_s && n == last_n)
+         return true; // reuse
+      last_s = NULL;
+      if (!stri__capi_utf8_to_utf16(s, n, last16, last_idx))
+         return false;
+      last_s = s;
+      last_n = n;
+      return true;
+   }
+
+
+   /** UTF-8 byte offset -> UTF-16 index */
+   int to16(int from) const
+   {
+      return (int)(std::lower_bound(last_idx.begin(), last_idx.end(), from)
+         - last_idx.begin());
+   }
+};
+
+
+/** Get the C API version
+ *
+ * @return STRINGI_CAPI_VERSION
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+int stri_capi_version(void)
+{
+   return STRINGI_CAPI_VERSION;
+}
+
+
+/** Compile a search pattern
+ *
+ * See stri_capi.h for the description of the parameters.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+stri_capi_matcher* stri_capi_matcher_new(int type, const char* pattern,
+   int pattern_len, int flags, const char* locale, char* errbuf, int errbuf_size)
+{
+   if (!pattern || pattern_len <= 0) {
+      stri__capi_set_error(errbuf, errbuf_size, MSG__EMPTY_SEARCH_PATTERN_UNSUPPORTED);
+      return NULL;
+   }
+   if (!stri__capi_utf8_valid(pattern, pattern_len)) {
+      stri__capi_set_error(errbuf, errbuf_size, MSG__INVALID_UTF8);
+      return NULL;
+   }
+
+   stri_capi_matcher* m = NULL;
+   try {
+      m = new stri_capi_matcher(type);
+      m->pattern.assign(pattern, (size_t)pattern_len);
+      const char* p = m->pattern.c_str();
+      UErrorCode status = U_ZERO_ERROR;
+
+      switch (type) {
+         case STRI_CAPI_FIXED:
+            if (flags & STRI_CAPI_FIXED_CASE_INSENSITIVE)
+               m->fixed = new StriByteSearchMatcherKMPci(p, pattern_len, false);
+            else if (pattern_len == 1)
+               m->fixed = new StriByteSearchMatcher1(p, pattern_len, false);
+            else if (pattern_len < 16)
+               m->fixed = new StriByteSearchMatcherShort(p, pattern_len, false);
+            else
+               m->fixed = new StriByteSearchMatcherKMP(p, pattern_len, false);
+            break;
+
+         case STRI_CAPI_CHARCLASS:
+            m->charclass = new StriCharClass();
+            m->charclass->applyPattern(UnicodeString::fromUTF8(
+               StringPiece(p, pattern_len)), status);
+            break;
+
+         case STRI_CAPI_REGEX:
+            m->regex = new RegexMatcher(UnicodeString::fromUTF8(
+               StringPiece(p, pattern_len)), (uint32_t)flags, status);
+            break;
+
+         case STRI_CAPI_COLL:
+            m->pattern16 = UnicodeString::fromUTF8(StringPiece(p, pattern_len));
+            m->col = ucol_open(locale ? locale : "", &status);
+            if (U_SUCCESS(status) && flags >= 1 && flags <= 4)
+               ucol_setStrength(m->col, (UCollationStrength)(flags-1));
+            break;
+
+         default:
+            delete m;
+            stri__capi_set_error(errbuf, errbuf_size, MSG__INCORRECT_INTERNAL_ARG);
+            return NULL;
+      }
+
+      if (U_FAILURE(status)) {
+         delete m;
+         stri__capi_set_error(errbuf, errbuf_size, u_errorName(status));
+         return NULL;
+      }
+   }
+   catch (StriException& e) {
+      if (m) delete m;
+      stri__capi_set_error(errbuf, errbuf_size, e.getMessage());
+      return NULL;
+   }
+   catch (...) {
+      if (m) delete m;
+      stri__capi_set_error(errbuf, errbuf_size, MSG__MEM_ALLOC_ERROR);
+      return NULL;
+   }
+
+   return m;
+}
+
+
+/** Release a matcher
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+void stri_capi_matcher_free(stri_capi_matcher* m)
+{
+   if (m) delete m;
+}
+
+
+/** Find the next match
+ *
+ * See stri_capi.h for the description of the parameters.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+int stri_capi_matcher_find(stri_capi_matcher* m, const char* s, int n,
+   int from, int* start, int* end)
+{
+   if (!m || n < 0 || from < 0 || from > n || (!s && n > 0))
+      return STRI_CAPI_ERROR;
+
+   try {
+      UErrorCode status = U_ZERO_ERROR;
+      switch (m->type) {
+         case STRI_CAPI_FIXED: {
+            if (from >= n) return 0;
+            m->fixed->reset(s+from, n-from);
+            if (m->fixed->findFirst() == USEARCH_DONE) {
+               if (!stri__capi_utf8_valid(s+from, n-from)) return STRI_CAPI_ERROR;
+               return 0;
+            }
+            *start = from+m->fixed->getMatchedStart();
+            *end = *start+m->fixed->getMatchedLength();
+            // validate only what has been examined (keeps repeated calls linear)
+            if (!stri__capi_utf8_valid(s+from, *end-from)) return STRI_CAPI_ERROR;
+            return 1;
+         }
+
+         case STRI_CAPI_CHARCLASS: {
+            // span() throws on invalid UTF-8 in the bytes examined,
+            // including the matching code point
+            int j = from+m->charclass->span(s+from, n-from, false);
+            if (j >= n) return 0;
+            *start = j;
+            U8_FWD_1(s, j, n);
+            *end = j;
+            return 1;
+         }
+
+         case STRI_CAPI_REGEX: {
+            if (!m->prepare16(s, n, from)) return STRI_CAPI_ERROR;
+            m->regex->reset(m->last16);
+            if (!m->regex->find(m->to16(from), status)) {
+               if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+               return 0;
+            }
+            int start16 = m->regex->start(status);
+            int end16 = m->regex->end(status);
+            if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+            *start = m->last_idx[start16];
+            *end = m->last_idx[end16];
+            return 1;
+         }
+
+         case STRI_CAPI_COLL: {
+            if (from >= n) return 0;
+            if (!m->prepare16(s, n, from)) return STRI_CAPI_ERROR;
+            if (!m->search) {
+               m->search = usearch_openFromCollator(
+                  m->pattern16.getBuffer(), m->pattern16.length(),
+                  m->last16.getBuffer(), m->last16.length(),
+                  m->col, NULL, &status);
+            }
+            else {
+               usearch_setText(m->search,
+                  m->last16.getBuffer(), m->last16.length(), &status);
+            }
+            if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+            int start16 = usearch_following(m->search, m->to16(from), &status);
+            if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+            if (start16 == USEARCH_DONE) return 0;
+            *start = m->last_idx[start16];
+            *end = m->last_idx[start16+usearch_getMatchedLength(m->search)];
+            return 1;
+         }
+
+         default:
+            return STRI_CAPI_ERROR;
+      }
+   }
+   catch (...) {
+      return STRI_CAPI_ERROR;
+   }
+}
+
+
+/** Get a normalizer
+ *
+ * Unlike stri__normalizer_get(), never calls Rf_error()
+ *
+ * @param form one of STRI_CAPI_NF*
+ * @return normalizer or NULL
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+static const Normalizer2* stri__capi_normalizer_get(int form)
+{
+   UErrorCode status = U_ZERO_ERROR;
+   const Normalizer2* normalizer = NULL;
+   switch (form) {
+      case STRI_CAPI_NFC:     normalizer = Normalizer2::getNFCInstance(status); break;
+      case STRI_CAPI_NFD:     normalizer = Normalizer2::getNFDInstance(status); break;
+      case STRI_CAPI_NFKC:    normalizer = Normalizer2::getNFKCInstance(status); break;
+      case STRI_CAPI_NFKD:    normalizer = Normalizer2::getNFKDInstance(status); break;
+      case STRI_CAPI_NFKC_CF: normalizer = Normalizer2::getNFKCCasefoldInstance(status); break;
+      default:                return NULL;
+   }
+   return U_FAILURE(status) ? NULL : normalizer;
+}
+
+
+/**
+ * A ByteSink that forwards everything to a stri_capi_sink
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+class StriCapiByteSink : public ByteSink {
+
+   private:
+
+      stri_capi_sink sink;
+      void* ctx;
+
+   public:
+
+      StriCapiByteSink(stri_capi_sink _sink, void* _ctx)
+         : sink(_sink), ctx(_ctx) { }
+
+      virtual void Append(const char* data, int32_t n) {
+         if (n > 0) sink(ctx, data, (int)n);
+      }
+};
+
+
+/** Normalize a string
+ *
+ * See stri_capi.h for the description of the parameters.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+int stri_capi_normalize(int form, const char* s, int n,
+   stri_capi_sink sink, void* ctx)
+{
+   const Normalizer2* normalizer = stri__capi_normalizer_get(form);
+   if (!normalizer || !sink || n < 0 || (!s && n > 0)) return STRI_CAPI_ERROR;
+
+   try {
+      if (!stri__capi_utf8_valid(s, n)) return STRI_CAPI_ERROR;
+      UErrorCode status = U_ZERO_ERROR;
+#if U_ICU_VERSION_MAJOR_NUM>=60
+      StriCapiByteSink out(sink, ctx);
+      normalizer->normalizeUTF8(0, StringPiece(s, n), out, NULL, status);
+      if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+#else
+      UnicodeString out16 = normalizer->normalize(
+         UnicodeString::fromUTF8(StringPiece(s, n)), status);
+      if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+      std::string out;
+      out16.toUTF8String(out);
+      if (out.size() > 0) sink(ctx, out.data(), (int)out.size());
+#endif
+      return 0;
+   }
+   catch (...) {
+      return STRI_CAPI_ERROR;
+   }
+}
+
+
+/** Is a string normalized?
+ *
+ * See stri_capi.h for the description of the parameters.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+int stri_capi_is_normalized(int form, const char* s, int n)
+{
+   const Normalizer2* normalizer = stri__capi_normalizer_get(form);
+   if (!normalizer || n < 0 || (!s && n > 0)) return STRI_CAPI_ERROR;
+
+   try {
+      if (!stri__capi_utf8_valid(s, n)) return STRI_CAPI_ERROR;
+      UErrorCode status = U_ZERO_ERROR;
+#if U_ICU_VERSION_MAJOR_NUM>=60
+      bool ret = (bool)normalizer->isNormalizedUTF8(StringPiece(s, n), status);
+#else
+      bool ret = (bool)normalizer->isNormalized(
+         UnicodeString::fromUTF8(StringPiece(s, n)), status);
+#endif
+      if (U_FAILURE(status)) return STRI_CAPI_ERROR;
+      return (int)ret;
+   }
+   catch (...) {
+      return STRI_CAPI_ERROR;
+   }
+}
+
+
+/** Convert a string between encodings
+ *
+ * Unmappable and illegal input is an error (no substitution takes place).
+ * See stri_capi.h for the description of the parameters.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+int stri_capi_convert(const char* from_enc, const char* to_enc,
+   const char* s, int n, stri_capi_sink sink, void* ctx)
+{
+   if (!sink || n < 0 || (!s && n > 0)) return STRI_CAPI_ERROR;
+
+   UConverter* from_cnv = NULL;
+   UConverter* to_cnv = NULL;
+   int ret = STRI_CAPI_ERROR;
+   try {
+      UErrorCode status = U_ZERO_ERROR;
+      from_cnv = ucnv_open(from_enc ? from_enc : "UTF-8", &status);
+      if (U_SUCCESS(status))
+         to_cnv = ucnv_open(to_enc ? to_enc : "UTF-8", &status);
+      if (U_SUCCESS(status))
+         ucnv_setToUCallBack(from_cnv, UCNV_TO_U_CALLBACK_STOP, NULL, NULL, NULL, &status);
+      if (U_SUCCESS(status))
+         ucnv_setFromUCallBack(to_cnv, UCNV_FROM_U_CALLBACK_STOP, NULL, NULL, NULL, &status);
+
+      if (U_SUCCESS(status)) {
+         UnicodeString s16(s, n, from_cnv, status);
+         if (U_SUCCESS(status)) {
+            int32_t len = s16.extract(NULL, 0, to_cnv, status);
+            if (status == U_BUFFER_OVERFLOW_ERROR) status = U_ZERO_ERROR;
+            if (U_SUCCESS(status) && len > 0) {
+               std::vector<char> buf(len+1);
+               ucnv_resetFromUnicode(to_cnv);
+               s16.extract(&buf[0], len+1, to_cnv, status);
+               if (U_SUCCESS(status)) sink(ctx, &buf[0], (int)len);
+            }
+            if (U_SUCCESS(status)) ret = 0;
+         }
+      }
+   }
+   catch (...) {
+      ret = STRI_CAPI_ERROR;
+   }
+
+   if (from_cnv) ucnv_close(from_cnv);
+   if (to_cnv) ucnv_close(to_cnv);
+   return ret;
+}
+
+
+/** Make the C API available via R_GetCCallable()
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-11)
+ */
+void stri__capi_register()
+{
+   R_RegisterCCallable("stringi", "stri_capi_version",       (DL_FUNC)stri_capi_version);
+   R_RegisterCCallable("stringi", "stri_capi_matcher_new",   (DL_FUNC)stri_capi_matcher_new);
+   R_RegisterCCallable("stringi", "stri_capi_matcher_free",  (DL_FUNC)stri_capi_matcher_free);
+   R_RegisterCCallable("stringi", "stri_capi_matcher_find",  (DL_FUNC)stri_capi_matcher_find);
+   R_RegisterCCallable("stringi", "stri_capi_normalize",     (DL_FUNC)stri_capi_normalize);
+   R_RegisterCCallable("stringi", "stri_capi_is_normalized", (DL_FUNC)stri_capi_is_normalized);
+   R_RegisterCCallable("stringi", "stri_capi_convert",       (DL_FUNC)stri_capi_convert);
+}
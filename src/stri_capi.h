@@ -0,0 +1,286 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __stri_capi_h
+#define __stri_capi_h
+
+/*
+ * stringi's C API for other packages
+ *
+ * Gives access to stringi's search engines, normalizers,
+ * and encoding converters over (const char*, int) buffers,
+ * with no SEXP allocations. Strings are in UTF-8 (unless stated otherwise),
+ * all the offsets and lengths are given in bytes.
+ *
+ * Except for stri_capi_init(), none of these functions call R API functions,
+ * and none of them throw exceptions or call Rf_error(): failures are
+ * signalled via return values. Hence, once stri_capi_init() has been
+ * called (once, in R's main thread, before any other function),
+ * they may be called from any thread, as long as each matcher object
+ * is used by one thread at a time. If stri_capi_init() has not been
+ * called (successfully), they all fail (return NULL or STRI_CAPI_ERROR).
+ *
+ * Usage (add `LinkingTo: stringi` to your package's DESCRIPTION):
+ *
+ *    // in exactly one of your source files:
+ *    #define STRINGI_CAPI_DEFINE_TABLE
+ *    #include <stringi_capi.h>
+ *
+ *    // in all the other ones:
+ *    #include <stringi_capi.h>
+ *
+ *    // e.g., in R_init_yourpackage (in R's main thread):
+ *    if (stri_capi_init() != 0) Rf_error("stringi C API version mismatch");
+ *
+ *    char err[256];
+ *    stri_capi_matcher* m = stri_capi_matcher_new(STRI_CAPI_REGEX,
+ *       "[0-9]+", 6, 0, NULL, err, sizeof(err));
+ *    int start, end, from = 0;
+ *    while (stri_capi_matcher_find(m, buf, buflen, from, &start, &end) > 0) {
+ *       // ... buf[start..end) matches
+ *       from = (end > start) ? end : end+1;
+ *    }
+ *    stri_capi_matcher_free(m);
+ *
+ * Within stringi itself, define STRINGI_CAPI_INTERNAL
+ * before including this file.
+ */
+
+#define STRINGI_CAPI_VERSION 1
+
+
+/* return values */
+#define STRI_CAPI_ERROR -1
+
+/* matcher types (for stri_capi_matcher_new) */
+#define STRI_CAPI_FIXED      1  /* flags: STRI_CAPI_FIXED_CASE_INSENSITIVE */
+#define STRI_CAPI_REGEX      2  /* flags: ICU's URegexpFlag */
+#define STRI_CAPI_CHARCLASS  3  /* flags: unused */
+#define STRI_CAPI_COLL       4  /* flags: collation strength 1-4 (0=default) */
+
+#define STRI_CAPI_FIXED_CASE_INSENSITIVE 1
+
+/* normalization forms (for stri_capi_normalize) */
+#define STRI_CAPI_NFC     1
+#define STRI_CAPI_NFD     2
+#define STRI_CAPI_NFKC    3
+#define STRI_CAPI_NFKD    4
+#define STRI_CAPI_NFKC_CF 5
+
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/* an opaque compiled pattern */
+typedef struct stri_capi_matcher stri_capi_matcher;
+
+/* an output sink: called (possibly many times) with consecutive output chunks */
+typedef void (*stri_capi_sink)(void* ctx, const char* data, int len);
+
+
+#ifdef STRINGI_CAPI_INTERNAL
+
+/* @return STRINGI_CAPI_VERSION that stringi was compiled with */
+int stri_capi_version(void);
+
+/* Compile a search pattern
+ *
+ * @param type one of STRI_CAPI_FIXED, _REGEX, _CHARCLASS, _COLL
+ * @param pattern non-empty pattern (a charclass like "[a-z]" or "\\p{L}")
+ * @param pattern_len length of pattern
+ * @param flags see the STRI_CAPI_* matcher types
+ * @param locale collation locale (STRI_CAPI_COLL only); NULL for default
+ * @param errbuf [out] error message buffer, may be NULL
+ * @param errbuf_size size of errbuf
+ * @return a new matcher or NULL on error
+ */
+stri_capi_matcher* stri_capi_matcher_new(int type, const char* pattern,
+   int pattern_len, int flags, const char* locale, char* errbuf, int errbuf_size);
+
+/* Release a matcher; NULL is ignored */
+void stri_capi_matcher_free(stri_capi_matcher* m);
+
+/* Find the first match starting at byte `from` or further
+ *
+ * `from` must be a code point boundary; for regex and collation-based
+ * matchers, a call with from > 0 must refer to the same (unmodified)
+ * buffer as the previous call, which allows for reusing
+ * the buffer's UTF-16 version
+ *
+ * @param m matcher
+ * @param s UTF-8 string
+ * @param n length of s
+ * @param from byte offset to start the search at
+ * @param start [out] start of the match
+ * @param end [out] end of the match (exclusive)
+ * @return 1 if a match was found, 0 if not, STRI_CAPI_ERROR on error
+ *    (e.g., an invalid UTF-8 string; for fixed and charclass matchers,
+ *    only the bytes examined by the search, i.e., from `from` to the end
+ *    of the match or of the string, are validated)
+ */
+int stri_capi_matcher_find(stri_capi_matcher* m, const char* s, int n,
+   int from, int* start, int* end);
+
+/* Normalize a string
+ *
+ * @param form one of STRI_CAPI_NF*
+ * @return 0 on success, STRI_CAPI_ERROR on error
+ */
+int stri_capi_normalize(int form, const char* s, int n,
+   stri_capi_sink sink, void* ctx);
+
+/* Is a string normalized?
+ *
+ * @return 1 (yes), 0 (no), or STRI_CAPI_ERROR
+ */
+int stri_capi_is_normalized(int form, const char* s, int n);
+
+/* Convert between encodings
+ *
+ * @param from_enc,to_enc ICU converter names; NULL for UTF-8
+ * @return 0 on success, STRI_CAPI_ERROR on error
+ */
+int stri_capi_convert(const char* from_enc, const char* to_enc,
+   const char* s, int n, stri_capi_sink sink, void* ctx);
+
+#else /* STRINGI_CAPI_INTERNAL */
+
+#include <R_ext/Rdynload.h>
+
+typedef struct {
+   int (*version)(void);
+   stri_capi_matcher* (*matcher_new)(int, const char*, int, int, const char*, char*, int);
+   void (*matcher_free)(stri_capi_matcher*);
+   int (*matcher_find)(stri_capi_matcher*, const char*, int, int, int*, int*);
+   int (*normalize)(int, const char*, int, stri_capi_sink, void*);
+   int (*is_normalized)(int, const char*, int);
+   int (*convert)(const char*, const char*, const char*, int, stri_capi_sink, void*);
+} stri_capi_table;
+
+/* the API functions, shared by all the translation units */
+#ifdef STRINGI_CAPI_DEFINE_TABLE
+stri_capi_table stri__capi_table = { 0, 0, 0, 0, 0, 0, 0 };
+#else
+extern stri_capi_table stri__capi_table;
+#endif
+
+/* Resolve the API functions
+ *
+ * Call it once, in R's main thread, before any other function;
+ * calling it again is harmless
+ *
+ * @return 0 on success, STRI_CAPI_ERROR if stringi's API version is older
+ */
+static inline int stri_capi_init(void)
+{
+   if (!stri__capi_table.version) {
+      stri__capi_table.matcher_new = (stri_capi_matcher* (*)(int, const char*, int, int, const char*, char*, int))
+         R_GetCCallable("stringi", "stri_capi_matcher_new");
+      stri__capi_table.matcher_free = (void (*)(stri_capi_matcher*))
+         R_GetCCallable("stringi", "stri_capi_matcher_free");
+      stri__capi_table.matcher_find = (int (*)(stri_capi_matcher*, const char*, int, int, int*, int*))
+         R_GetCCallable("stringi", "stri_capi_matcher_find");
+      stri__capi_table.normalize = (int (*)(int, const char*, int, stri_capi_sink, void*))
+         R_GetCCallable("stringi", "stri_capi_normalize");
+      stri__capi_table.is_normalized = (int (*)(int, const char*, int))
+         R_GetCCallable("stringi", "stri_capi_is_normalized");
+      stri__capi_table.convert = (int (*)(const char*, const char*, const char*, int, stri_capi_sink, void*))
+         R_GetCCallable("stringi", "stri_capi_convert");
+      /* set last: a nonzero version marks the table as complete */
+      stri__capi_table.version = (int (*)(void))
+         R_GetCCallable("stringi", "stri_capi_version");
+   }
+   return (stri__capi_table.version() >= STRINGI_CAPI_VERSION) ? 0 : STRI_CAPI_ERROR;
+}
+
+/* @return stringi's API version or 0 if stri_capi_init() has not been called */
+static inline int stri_capi_version(void)
+{
+   if (!stri__capi_table.version) return 0;
+   return stri__capi_table.version();
+}
+
+static inline stri_capi_matcher* stri_capi_matcher_new(int type, const char* pattern,
+   int pattern_len, int flags, const char* locale, char* errbuf, int errbuf_size)
+{
+   if (!stri__capi_table.version) {
+      const char* msg = "stri_capi_init() has not been called";
+      int i;
+      for (i=0; errbuf && i < errbuf_size-1 && msg[i]; ++i) errbuf[i] = msg[i];
+      if (errbuf && errbuf_size > 0) errbuf[i] = '\0';
+      return 0;
+   }
+   return stri__capi_table.matcher_new(type, pattern, pattern_len, flags,
+      locale, errbuf, errbuf_size);
+}
+
+static inline void stri_capi_matcher_free(stri_capi_matcher* m)
+{
+   if (!stri__capi_table.version) return; /* no matcher could be created */
+   stri__capi_table.matcher_free(m);
+}
+
+static inline int stri_capi_matcher_find(stri_capi_matcher* m, const char* s, int n,
+   int from, int* start, int* end)
+{
+   if (!stri__capi_table.version) return STRI_CAPI_ERROR;
+   return stri__capi_table.matcher_find(m, s, n, from, start, end);
+}
+
+static inline int stri_capi_normalize(int form, const char* s, int n,
+   stri_capi_sink sink, void* ctx)
+{
+   if (!stri__capi_table.version) return STRI_CAPI_ERROR;
+   return stri__capi_table.normalize(form, s, n, sink, ctx);
+}
+
+static inline int stri_capi_is_normalized(int form, const char* s, int n)
+{
+   if (!stri__capi_table.version) return STRI_CAPI_ERROR;
+   return stri__capi_table.is_normalized(form, s, n);
+}
+
+static inline int stri_capi_convert(const char* from_enc, const char* to_enc,
+   const char* s, int n, stri_capi_sink sink, void* ctx)
+{
+   if (!stri__capi_table.version) return STRI_CAPI_ERROR;
+   return stri__capi_table.convert(from_enc, to_enc, s, n, sink, ctx);
+}
+
+#endif /* STRINGI_CAPI_INTERNAL */
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
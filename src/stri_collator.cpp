@@ -192,3 +192,22 @@ UCollator* stri__ucol_open(SEXP opts_collator)
 
    return col;
 }
+
+
+/**
+ * Should strings be compared code point-wise, with no Collator at all?
+ *
+ * This is the case if \code{opts_collator} is a single \code{NA}.
+ * For valid UTF-8 strings, code point order is the same as
+ * the byte order (as given by memcmp), which is much faster than collation.
+ *
+ * @param opts_collator R object
+ * @return bool
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ */
+bool stri__ucol_is_off(SEXP opts_collator)
+{
+   return (TYPEOF(opts_collator) == LGLSXP && LENGTH(opts_collator) == 1 &&
+      LOGICAL(opts_collator)[0] == NA_LOGICAL);
+}
@@ -326,3 +326,99 @@ int stri__match_arg(const char* option, const char** set) {
    }
    return which;
 }
+
+
+/** Is an object a plain factor?
+ *
+ * That is, an object of class \code{factor} or \code{c("ordered", "factor")},
+ * with character levels (for which \code{as.character()}
+ * is the same as expanding the levels through the codes).
+ *
+ * @param x R object
+ * @return bool
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-09)
+ */
+bool stri__factor_is_plain(SEXP x)
+{
+   if (!Rf_isFactor(x)) return false;
+   if (TYPEOF(Rf_getAttrib(x, R_LevelsSymbol)) != STRSXP) return false;
+   SEXP cls = Rf_getAttrib(x, R_ClassSymbol);
+   const char* cls1 = CHAR(STRING_ELT(cls, 0));
+   return (!strcmp(cls1, "factor") || (!strcmp(cls1, "ordered") &&
+      LENGTH(cls) == 2 && !strcmp(CHAR(STRING_ELT(cls, 1)), "factor")));
+}
+
+
+/** Should a vectorized function be evaluated on a factor's levels only?
+ *
+ * This is the case if \code{x} is a plain factor
+ * with no more levels than elements.
+ *
+ * @param x R object
+ * @return bool
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-09)
+ */
+bool stri__factor_use_levels(SEXP x)
+{
+   return (stri__factor_is_plain(x) &&
+      LENGTH(Rf_getAttrib(x, R_LevelsSymbol)) <= LENGTH(x));
+}
+
+
+/** Expand values determined for each level of a factor through its codes
+ *
+ * @param x a factor
+ * @param values an atomic vector of length nlevels(x)
+ *    (logical, integer, double, or character)
+ * @return a vector of the same type as \code{values}
+ *    and the same length as \code{x}; \code{NA} codes give \code{NA}s
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-09)
+ */
+SEXP stri__factor_expand(SEXP x, SEXP values)
+{
+   R_len_t n = LENGTH(x);
+   R_len_t nlevels = LENGTH(values);
+   const int* codes = INTEGER(x);
+   SEXP ret;
+   PROTECT(ret = Rf_allocVector(TYPEOF(values), n));
+   switch (TYPEOF(values)) {
+      case LGLSXP:
+      case INTSXP: {
+         const int* values_tab = (TYPEOF(values) == LGLSXP)?LOGICAL(values):INTEGER(values);
+         int* ret_tab = (TYPEOF(values) == LGLSXP)?LOGICAL(ret):INTEGER(ret);
+         for (R_len_t i=0; i<n; ++i) {
+            int k = codes[i];
+            ret_tab[i] = (k == NA_INTEGER || k < 1 || k > nlevels)?NA_INTEGER:values_tab[k-1];
+         }
+         break;
+      }
+
+      case REALSXP: {
+         const double* values_tab = REAL(values);
+         double* ret_tab = REAL(ret);
+         for (R_len_t i=0; i<n; ++i) {
+            int k = codes[i];
+            ret_tab[i] = (k == NA_INTEGER || k < 1 || k > nlevels)?NA_REAL:values_tab[k-1];
+         }
+         break;
+      }
+
+      case STRSXP: {
+         for (R_len_t i=0; i<n; ++i) {
+            int k = codes[i];
+            SET_STRING_ELT(ret, i,
+               (k == NA_INTEGER || k < 1 || k > nlevels)?NA_STRING:STRING_ELT(values, k-1));
+         }
+         break;
+      }
+
+      default:
+         UNPROTECT(1);
+         Rf_error(MSG__INTERNAL_ERROR); // allowed here
+   }
+   UNPROTECT(1);
+   return ret;
+}
@@ -40,51 +40,38 @@
 #include <set>
 
 
-// !!!! no longer used since stringi_0.2-3 !!!!
-///** Compare 2 strings in UTF8, codepoint-wise [internal]
-// *
-// * Used by stri_order_codepoints and stri_cmp_codepoints
-// *
-// * @param str1 string in UTF8
-// * @param str2 string in UTF8
-// * @param n1 length of str1
-// * @param n2 length of str2
-// * @return -1, 0, or 1, like in strcmp
-// *
-// * @version 0.1-?? (Marek Gagolewski)
-// *
-// * @version 0.2-1 (Marek Gagolewski, 2014-03-19)
-// *          BUGFIX: possibly incorrect results for strings of inequal number
-// *                  of codepoints
-// *
-// * @version 0.2-1 (Marek Gagolewski, 2014-04-02)
-// *          detect invalid UTF-8 byte stream
-// */
-//int stri__cmp_codepoints(const char* str1, R_len_t n1, const char* str2, R_len_t n2)
-//{
-//   // @NOTE: strangely, this is being outperformed by ucol_strcollUTF8
-//   //        in some UTF-8 benchmarks...
-//   int i1 = 0;
-//   int i2 = 0;
-//   UChar32 c1 = 0;
-//   UChar32 c2 = 0;
-//   while (c1 == c2 && i1 < n1 && i2 < n2) {
-//      U8_NEXT(str1, i1, n1, c1);
-//      U8_NEXT(str2, i2, n2, c2);
-//      if (c1 < 0 || c2 < 0)
-//         throw StriException(MSG__INVALID_UTF8);
-//   }
-//
-//   if (c1 < c2)
-//      return -1;
-//   else if (c1 > c2)
-//      return 1;
-//
-//   // reached here => first i1==i2 codepoints are the same
-//   if (i1 < n1)      return  1;
-//   else if (i2 < n2) return -1;
-//   else              return  0;
-//}
+/** Compare 2 strings in UTF8, codepoint-wise [internal]
+ *
+ * Used by stri_cmp, stri_order etc. when opts_collator is NA
+ *
+ * @param str1 string in UTF8
+ * @param str2 string in UTF8
+ * @param n1 length of str1
+ * @param n2 length of str2
+ * @return -1, 0, or 1, like in strcmp
+ *
+ * @version 0.1-?? (Marek Gagolewski)
+ *
+ * @version 0.2-1 (Marek Gagolewski, 2014-03-19)
+ *          BUGFIX: possibly incorrect results for strings of inequal number
+ *                  of codepoints
+ *
+ * @version 0.2-1 (Marek Gagolewski, 2014-04-02)
+ *          detect invalid UTF-8 byte stream
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *          back in use (opts_collator=NA); UTF-8 was designed so that
+ *          the byte order is the same as code point order,
+ *          hence a single memcmp call suffices (no decoding at all)
+ */
+int stri__cmp_codepoints(const char* str1, R_len_t n1, const char* str2, R_len_t n2)
+{
+   int ret = memcmp(str1, str2, (size_t)((n1 < n2)?n1:n2));
+   if (ret != 0)    return (ret < 0)?-1:1;
+   else if (n1 < n2) return -1;
+   else if (n1 > n2) return  1;
+   else              return  0;
+}
 
 
 /* *************************************************************************
@@ -210,6 +197,9 @@ SEXP stri_cmp_neq(SEXP e1, SEXP e2) {
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp (memcmp)
  */
 SEXP stri__cmp_logical(SEXP e1, SEXP e2, SEXP opts_collator, int _type, int _negate)
 {
@@ -224,7 +214,8 @@ SEXP stri__cmp_logical(SEXP e1, SEXP e2, SEXP opts_collator, int _type, int _neg
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
    STRI__ERROR_HANDLER_BEGIN(2)
 
@@ -249,12 +240,21 @@ SEXP stri__cmp_logical(SEXP e1, SEXP e2, SEXP opts_collator, int _type, int _neg
       R_len_t     cur2_n = e2_cont.get(i).length();
       const char* cur2_s = e2_cont.get(i).c_str();
 
-      // with collation
-      UErrorCode status = U_ZERO_ERROR;
-      ret_tab[i] = (_type == (int)ucol_strcollUTF8(col,
-         cur1_s, cur1_n, cur2_s, cur2_n, &status
-      ));
-      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      if (!col) {
+         // codepoint-wise cmp
+         if (_type == 0)
+            ret_tab[i] = (cur1_n == cur2_n && memcmp(cur1_s, cur2_s, cur1_n) == 0);
+         else
+            ret_tab[i] = (_type == stri__cmp_codepoints(cur1_s, cur1_n, cur2_s, cur2_n));
+      }
+      else {
+         // with collation
+         UErrorCode status = U_ZERO_ERROR;
+         ret_tab[i] = (_type == (int)ucol_strcollUTF8(col,
+            cur1_s, cur1_n, cur2_s, cur2_n, &status
+         ));
+         STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      }
 
       if (_negate)
          ret_tab[i] = !ret_tab[i];
@@ -408,6 +408,9 @@ SEXP stri_cmp_ge(SEXP e1, SEXP e2, SEXP opts_collator) {
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp (memcmp)
  */
 SEXP stri_cmp(SEXP e1, SEXP e2, SEXP opts_collator)
 {
@@ -417,7 +420,8 @@ SEXP stri_cmp(SEXP e1, SEXP e2, SEXP opts_collator)
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
    STRI__ERROR_HANDLER_BEGIN(2)
 
@@ -443,12 +447,18 @@ SEXP stri_cmp(SEXP e1, SEXP e2, SEXP opts_collator)
       R_len_t     cur2_n = e2_cont.get(i).length();
       const char* cur2_s = e2_cont.get(i).c_str();
 
-      // cmp with collation
-      UErrorCode status = U_ZERO_ERROR;
-      ret_int[i] = (int)ucol_strcollUTF8(col,
-         cur1_s, cur1_n, cur2_s, cur2_n, &status
-      );
-      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      if (!col) {
+         // codepoint-wise cmp
+         ret_int[i] = stri__cmp_codepoints(cur1_s, cur1_n, cur2_s, cur2_n);
+      }
+      else {
+         // cmp with collation
+         UErrorCode status = U_ZERO_ERROR;
+         ret_int[i] = (int)ucol_strcollUTF8(col,
+            cur1_s, cur1_n, cur2_s, cur2_n, &status
+         );
+         STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      }
    }
 
    if (col) {
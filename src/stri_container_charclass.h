@@ -38,6 +38,155 @@
 #include <unicode/uniset.h>
 
 
+/**
+ * A compiled character class
+ *
+ * A frozen UnicodeSet together with a 128-bit ASCII membership bitmap,
+ * so that ASCII code points may be tested without calling ICU.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-02)
+ */
+class StriCharClass {
+
+   private:
+
+      UnicodeSet uset;
+      uint32_t ascii[4]; // ASCII membership bitmap
+
+
+   public:
+
+      StriCharClass()
+      {
+         ascii[0] = ascii[1] = ascii[2] = ascii[3] = 0;
+      }
+
+      StriCharClass(const StriCharClass& cls)
+         : uset(cls.uset)
+      {
+         for (int k=0; k<4; ++k) ascii[k] = cls.ascii[k];
+      }
+
+      StriCharClass& operator=(const StriCharClass& cls)
+      {
+         uset = cls.uset;
+         for (int k=0; k<4; ++k) ascii[k] = cls.ascii[k];
+         return *this;
+      }
+
+
+      /** compile a UnicodeSet pattern
+       *
+       * @param pattern pattern
+       * @param status [out] ICU error status
+       */
+      void applyPattern(const UnicodeString& pattern, UErrorCode& status)
+      {
+         uset.applyPattern(pattern, status);
+         if (U_FAILURE(status)) return;
+         uset.freeze();
+         for (int k=0; k<4; ++k) ascii[k] = 0;
+         for (UChar32 c=0; c<0x80; ++c)
+            if (uset.contains(c)) ascii[c>>5] |= ((uint32_t)1)<<(c&31);
+      }
+
+      inline void setToBogus() { uset.setToBogus(); }
+
+      inline bool isBogus() const { return uset.isBogus(); }
+
+      inline const UnicodeSet& getUnicodeSet() const { return uset; }
+
+
+      /** does the class contain a given ASCII code point?
+       *
+       * @param c byte < 0x80
+       * @return 0 or 1
+       */
+      inline uint32_t containsASCII(uint8_t c) const
+      {
+         return (ascii[c>>5]>>(c&31))&1;
+      }
+
+
+      /** does the class contain a given code point?
+       *
+       * @param c valid code point
+       * @return logical value
+       */
+      inline bool contains(UChar32 c) const
+      {
+         if ((uint32_t)c < 0x80) return (bool)containsASCII((uint8_t)c);
+         return (bool)uset.contains(c);
+      }
+
+
+      /** get the length of the longest prefix of a UTF-8 string
+       * consisting only of code points (not) in the class
+       *
+       * ASCII runs are tested with the bitmap.
+       * Unlike UnicodeSet::spanUTF8(), this throws on invalid UTF-8 sequences.
+       *
+       * @param s string
+       * @param n number of bytes in s
+       * @param contained USET_SPAN_CONTAINED-like if true,
+       *    USET_SPAN_NOT_CONTAINED-like otherwise
+       * @return number of bytes
+       */
+      R_len_t span(const char* s, R_len_t n, bool contained) const
+      {
+         const uint32_t want = (uint32_t)contained;
+         R_len_t j = 0;
+         while (j < n) {
+            uint8_t b = (uint8_t)s[j];
+            if (b < 0x80) {
+               if (containsASCII(b) != want) return j;
+               ++j;
+            }
+            else {
+               R_len_t jlast = j;
+               UChar32 chr;
+               U8_NEXT(s, j, n, chr);
+               if (chr < 0) // invalid utf-8 sequence
+                  throw StriException(MSG__INVALID_UTF8);
+               if ((bool)uset.contains(chr) != contained) return jlast;
+            }
+         }
+         return n;
+      }
+
+
+      /** get the start of the longest suffix of a UTF-8 string
+       * consisting only of code points (not) in the class
+       *
+       * @param s string
+       * @param n number of bytes in s
+       * @param contained see span()
+       * @return byte index
+       */
+      R_len_t spanBack(const char* s, R_len_t n, bool contained) const
+      {
+         const uint32_t want = (uint32_t)contained;
+         R_len_t j = n;
+         while (j > 0) {
+            uint8_t b = (uint8_t)s[j-1];
+            if (b < 0x80) {
+               if (containsASCII(b) != want) return j;
+               --j;
+            }
+            else {
+               R_len_t jlast = j;
+               UChar32 chr;
+               U8_PREV(s, 0, j, chr);
+               if (chr < 0) // invalid utf-8 sequence
+                  throw StriException(MSG__INVALID_UTF8);
+               if ((bool)uset.contains(chr) != contained) return jlast;
+            }
+         }
+         return 0;
+      }
+};
+
+
 /**
  * A container handling charclass searches
  *
@@ -49,12 +198,15 @@
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-02)
  *          New method: locateAll
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-02)
+ *          Store StriCharClass objects (with ASCII bitmaps)
  */
 class StriContainerCharClass : public StriContainerBase {
 
    private:
 
-      UnicodeSet* data; // array
+      StriCharClass* data; // array
 
    public:
 
@@ -75,7 +227,7 @@ class StriContainerCharClass : public StriContainerBase {
          this->data = NULL;
          if (_n > 0) {
             StriContainerUTF8 rvec_cont(rvec, _n, true);
-            this->data = new UnicodeSet[_n];
+            this->data = new StriCharClass[_n];
             for (int i=0; i<_n; ++i) {
                if (rvec_cont.isNA(i))
                   this->data[i].setToBogus();
@@ -84,7 +236,6 @@ class StriContainerCharClass : public StriContainerBase {
                   this->data[i].applyPattern(
                      UnicodeString::fromUTF8(rvec_cont.get(i).c_str()), status);
                   STRI__CHECKICUSTATUS_THROW(status, {delete [] data; data = NULL;})
-                  this->data[i].freeze();
                }
             }
          }
@@ -94,7 +245,7 @@ class StriContainerCharClass : public StriContainerBase {
          :StriContainerBase((StriContainerBase&)container)
       {
          if (container.data) {
-            this->data = new UnicodeSet[container.n];
+            this->data = new StriCharClass[container.n];
             for (int i=0; i<container.n; ++i)
                this->data[i] = container.data[i];
          }
@@ -111,7 +262,7 @@ class StriContainerCharClass : public StriContainerBase {
          this->~StriContainerCharClass();
          (StriContainerBase&) (*this) = (StriContainerBase&)container;
          if (container.data) {
-            this->data = new UnicodeSet[container.n];
+            this->data = new StriCharClass[container.n];
             for (int i=0; i<container.n; ++i)
                this->data[i] = container.data[i];
          }
@@ -136,9 +287,9 @@ class StriContainerCharClass : public StriContainerBase {
 
       /** get the vectorized ith element
        * @param i index
-       * @return integer
+       * @return compiled character class
        */
-      inline const UnicodeSet& get(R_len_t i) const {
+      inline const StriCharClass& get(R_len_t i) const {
 #ifndef NDEBUG
          if (i < 0 || i >= nrecycle)
             throw StriException("StriContainerCharClass::get(): INDEX OUT OF BOUNDS");
@@ -155,7 +306,7 @@ class StriContainerCharClass : public StriContainerBase {
        * or total number of codepoints matched (idx_codepoint==true)
        */
       static R_len_t locateAll(deque< pair<R_len_t, R_len_t> >& occurrences,
-            const UnicodeSet* pattern_cur,
+            const StriCharClass* pattern_cur,
             const char* str_cur_s, R_len_t str_cur_n,
             bool merge_cur, bool idx_codepoint)
       {
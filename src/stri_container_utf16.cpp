@@ -73,6 +73,9 @@ StriContainerUTF16::StriContainerUTF16(R_len_t _nrecycle)
  *
  * @version 1.0.6 (Marek Gagolewski, 2017-05-25)
  *    #270 latin-1 is windows-1252 on Windows
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ *    read lazy stri_sub() results without materializing them
  */
 StriContainerUTF16::StriContainerUTF16(SEXP rstr, R_len_t _nrecycle, bool _shallowrecycle)
 {
@@ -105,7 +108,24 @@ StriContainerUTF16::StriContainerUTF16(SEXP rstr, R_len_t _nrecycle, bool _shall
 #endif
    StriUcnv ucnvNative(NULL);
 
+   SEXP sub_str = R_NilValue;
+   const int* sub_offsets = NULL;
+   if (!stri__sub_altrep_get(rstr, sub_str, sub_offsets))
+      sub_offsets = NULL;
+
    for (R_len_t i=0; i<nrstr; ++i) {
+      if (sub_offsets) {
+         // a lazy stri_sub() result - read the source string's bytes
+         if (sub_offsets[2*(R_xlen_t)i] == NA_INTEGER)
+            continue; // keep NA
+         SEXP subs = STRING_ELT(sub_str, i%LENGTH(sub_str));
+         R_len_t subs_from = sub_offsets[2*(R_xlen_t)i];
+         R_len_t subs_to   = sub_offsets[2*(R_xlen_t)i+1];
+         this->str[i].setTo(UnicodeString::fromUTF8(StringPiece(
+            CHAR(subs)+subs_from, subs_to-subs_from)));
+         continue;
+      }
+
       SEXP curs = STRING_ELT(rstr, i);
       if (curs == NA_STRING) {
          continue; // keep NA
@@ -384,3 +404,65 @@ void StriContainerUTF16::UChar16_to_UChar32_index(R_len_t i,
          throw StriException("DEBUG: stri__UChar16_to_UChar32_index 5");
 #endif
 }
+
+
+/** Convert Unicode16-Char indices to UTF-8 byte indices
+ *
+ * \code{i1} and \code{i2} must be sorted increasingly.
+ * The UTF-8 representation is not needed: the byte offsets
+ * are determined from the code points' UTF-8 lengths.
+ *
+ * @param i element index
+ * @param i1 indices, 0-based [in/out]
+ * @param i2 indices, 0-based [in/out]
+ * @param ni size of \code{i1} and \code{i2}
+ * @param adj1 adjust for \code{i1}
+ * @param adj2 adjust for \code{i2}
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ */
+void StriContainerUTF16::UChar16_to_UTF8_index(R_len_t i,
+   int* i1, int* i2, const int ni, int adj1, int adj2)
+{
+   const UnicodeString* str_data = &(this->get(i));
+   const UChar* cstr = str_data->getBuffer();
+   const int nstr = str_data->length();
+
+   int j1 = 0;
+   int j2 = 0;
+
+   int i16 = 0;
+   int i8 = 0;
+   while (i16 < nstr && (j1 < ni || j2 < ni)) {
+      while (j1 < ni && i1[j1] <= i16) {
+         i1[j1] = i8 + adj1;
+         ++j1;
+      }
+
+      while (j2 < ni && i2[j2] <= i16) {
+         i2[j2] = i8 + adj2;
+         ++j2;
+      }
+
+      // Next UChar32
+      UChar32 c;
+      U16_NEXT(cstr, i16, nstr, c);
+      i8 += U8_LENGTH(c);
+   }
+
+   // CONVERT LAST:
+   while (j1 < ni && i1[j1] <= nstr) {
+      i1[j1] = i8 + adj1;
+      ++j1;
+   }
+
+   while (j2 < ni && i2[j2] <= nstr) {
+      i2[j2] = i8 + adj2;
+      ++j2;
+   }
+
+#ifndef NDEBUG
+      if (i16 >= nstr && (j1 < ni || j2 < ni))
+         throw StriException("DEBUG: stri__UChar16_to_UTF8_index");
+#endif
+}
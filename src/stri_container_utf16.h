@@ -156,6 +156,7 @@ class StriContainerUTF16 : public StriContainerBase {
 
       // @QUESTION: separate StriContainerUTF16_indexable?
       void UChar16_to_UChar32_index(R_len_t i, int* i1, int* i2, const int ni, int adj1, int adj2);
+      void UChar16_to_UTF8_index(R_len_t i, int* i1, int* i2, const int ni, int adj1, int adj2);
 };
 
 #endif
@@ -55,6 +55,9 @@ StriContainerUTF8::StriContainerUTF8()
  *
  * @version 1.0.6 (Marek Gagolewski, 2017-05-25)
  *    #270 latin-1 is windows-1252 on Windows
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ *    read lazy stri_sub() results without materializing them
  */
 StriContainerUTF8::StriContainerUTF8(SEXP rstr, R_len_t _nrecycle, bool _shallowrecycle)
 {
@@ -91,8 +94,26 @@ StriContainerUTF8::StriContainerUTF8(SEXP rstr, R_len_t _nrecycle, bool _shallow
 //      int    tmpbufsize = -1;
 //      UChar* tmpbuf = NULL;
 
+   SEXP sub_str = R_NilValue;
+   const int* sub_offsets = NULL;
+   if (!stri__sub_altrep_get(rstr, sub_str, sub_offsets))
+      sub_offsets = NULL;
+
 
    for (R_len_t i=0; i<nrstr; ++i) {
+      if (sub_offsets) {
+         // a lazy stri_sub() result - read the source string's bytes
+         if (sub_offsets[2*(R_xlen_t)i] == NA_INTEGER)
+            continue; // keep NA
+         SEXP subs = STRING_ELT(sub_str, i%LENGTH(sub_str));
+         R_len_t subs_from = sub_offsets[2*(R_xlen_t)i];
+         R_len_t subs_to   = sub_offsets[2*(R_xlen_t)i+1];
+         this->str[i].initialize(CHAR(subs)+subs_from, subs_to-subs_from,
+            subs_to != LENGTH(subs) /* copy unless NUL-terminated */,
+            !IS_ASCII(subs)/*killbom*/, IS_ASCII(subs)/*isASCII*/);
+         continue;
+      }
+
       SEXP curs = STRING_ELT(rstr, i);
       if (curs == NA_STRING) {
          continue; // keep NA
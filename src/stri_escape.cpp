@@ -33,6 +33,108 @@
 #include "stri_stringi.h"
 #include "stri_container_utf8.h"
 #include "stri_container_utf16.h"
+#include "stri_string8buf.h"
+#include <unicode/ustring.h>
+
+
+/** Find the next byte that stri_escape_unicode() must not copy as-is [internal]
+ *
+ * These are: non-ASCII bytes, ASCII control characters,
+ * and the quotes and the backslash. Printable ASCII bytes
+ * are skipped 8 at a time.
+ *
+ * @param s string
+ * @param j byte index to start at
+ * @param n length of s
+ * @return byte index or n if there is no such byte
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ */
+static inline R_len_t stri__escape_unicode_next(const char* s, R_len_t j, R_len_t n)
+{
+   for (; j+8 <= n; j += 8) {
+      uint64_t x;
+      memcpy(&x, s+j, 8);
+      if ((x & STRI__SWAR_HIGHS) || STRI__SWAR_HAS_LESS(x, 32)
+            || STRI__SWAR_HAS_BYTE(x, 0x22) || STRI__SWAR_HAS_BYTE(x, 0x27)
+            || STRI__SWAR_HAS_BYTE(x, 0x5c) || STRI__SWAR_HAS_BYTE(x, 0x7f))
+         break; // there is a candidate byte in s[j..j+7]
+   }
+
+   for (; j < n; ++j) {
+      uint8_t b = (uint8_t)s[j];
+      if (b < 32 || b >= 127 || b == 0x22 || b == 0x27 || b == 0x5c)
+         return j;
+   }
+   return n;
+}
+
+
+/** Find the next backslash [internal]
+ *
+ * memchr() is vectorized in all the major C libraries.
+ *
+ * @param s string
+ * @param j byte index to start at
+ * @param n length of s
+ * @return byte index or n if there is no backslash
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ */
+static inline R_len_t stri__unescape_unicode_next(const char* s, R_len_t j, R_len_t n)
+{
+   const char* p = (const char*)memchr(s+j, '\\', (size_t)(n-j));
+   return p ? (R_len_t)(p-s) : n;
+}
+
+
+/** Escaped form of a code point [internal]
+ *
+ * @param c code point
+ * @param buf [out] at least 10 bytes
+ * @return number of bytes written to buf
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ */
+static inline R_len_t stri__escape_unicode_1(UChar32 c, char* buf)
+{
+   static const char* hex = "0123456789abcdef";
+   if (c <= ASCII_MAXCHARCODE) {
+      char e = 0;
+      switch ((char)c) {
+         case 0x07: e = 'a'; break;
+         case 0x08: e = 'b'; break;
+         case 0x09: e = 't'; break;
+         case 0x0a: e = 'n'; break;
+         case 0x0b: e = 'v'; break;
+         case 0x0c: e = 'f'; break;
+         case 0x0d: e = 'r'; break;
+//         case 0x1b: e = 'e'; break; // R doesn't know that
+         case 0x22: e = '"'; break;
+         case 0x27: e = '\''; break;
+         case 0x5c: e = '\\'; break;
+         default:
+            if ((char)c >= 32 && (char)c <= 126) { // printable characters
+               buf[0] = (char)c;
+               return 1;
+            }
+      }
+      if (e) {
+         buf[0] = '\\';
+         buf[1] = e;
+         return 2;
+      }
+   }
+
+   R_len_t k = (c <= 0xffff) ? 4 : 8;
+   buf[0] = '\\';
+   buf[1] = (k == 4) ? 'u' : 'U';
+   for (R_len_t l=k+1; l>=2; --l) {
+      buf[l] = hex[c & 0xf];
+      c >>= 4;
+   }
+   return k+2;
+}
 
 
 /**
@@ -51,6 +153,10 @@
  *
  * @version 1.1.6 (Steve Grubb, 2017-07-20)
  *          if ((char)c >= 32 || (char)c <= 126) should be &&
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ *    copy runs of printable ASCII characters as-is, found 8 bytes
+ *    at a time; write to a String8buf of the exact size
 */
 SEXP stri_escape_unicode(SEXP str)
 {
@@ -63,7 +169,8 @@ SEXP stri_escape_unicode(SEXP str)
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(STRSXP, str_length));
 
-   std::string out; // @TODO: estimate len a priori?
+   String8buf buf(0);
+   char esc[10];
 
    for (R_len_t i = str_cont.vectorize_init();
          i != str_cont.vectorize_end();
@@ -77,67 +184,43 @@ SEXP stri_escape_unicode(SEXP str)
       const char* str_cur_s = str_cont.get(i).c_str();
       R_len_t     str_cur_n = str_cont.get(i).length();
 
-      // estimate buf size
-      R_len_t bufsize = 0;
-      UChar32 c;
-      R_len_t j = 0;
+      R_len_t j = stri__escape_unicode_next(str_cur_s, 0, str_cur_n);
+      if (j == str_cur_n) { // nothing to escape
+         SET_STRING_ELT(ret, i, str_cont.toR(i));
+         continue;
+      }
 
+      // get the output size (and validate the string)
+      R_len_t bufsize = j;
+      UChar32 c;
       while (j < str_cur_n) {
          U8_NEXT(str_cur_s, j, str_cur_n, c);
          if (c < 0)
             throw StriException(MSG__INVALID_UTF8);
-         else if ((char)c >= 32 && (char)c <= 126)
-            bufsize += 1;
-         else if (c <= 0xff)
-            bufsize += 6; // for \a, \n this will be overestimated
-         else
-            bufsize += 10;
+         bufsize += stri__escape_unicode_1(c, esc);
+         R_len_t jnext = stri__escape_unicode_next(str_cur_s, j, str_cur_n);
+         bufsize += jnext-j;
+         j = jnext;
       }
-      out.clear();
-      if ((size_t)bufsize > (size_t)out.size())
-         out.reserve(bufsize);
+      buf.resize(bufsize, false);
+      char* out = buf.data();
 
       // do escape
+      R_len_t k = 0;
       j = 0;
-      char buf[11];
       while (j < str_cur_n) {
-         U8_NEXT(str_cur_s, j, str_cur_n, c);
-         /* if (c < 0)
-            throw StriException(MSG__INVALID_UTF8); // this has already been checked :)
-         else */ if (c <= ASCII_MAXCHARCODE) {
-            switch ((char)c) {
-               case 0x07: out.append("\\a"); break;
-               case 0x08: out.append("\\b"); break;
-               case 0x09: out.append("\\t"); break;
-               case 0x0a: out.append("\\n"); break;
-               case 0x0b: out.append("\\v"); break;
-               case 0x0c: out.append("\\f"); break;
-               case 0x0d: out.append("\\r"); break;
-//               case 0x1b: out.append("\\e"); break; // R doesn't know that
-               case 0x22: out.append("\\\""); break;
-               case 0x27: out.append("\\'"); break;
-               case 0x5c: out.append("\\\\"); break;
-               default:
-                  if ((char)c >= 32 && (char)c <= 126) // printable characters
-                     out.append(1, (char)c);
-                  else {
-                     sprintf(buf, "\\u%4.4x", (uint16_t)c);
-                     out.append(buf, 6);
-                  }
-            }
-         }
-         else if (c <= 0xffff) {
-            sprintf(buf, "\\u%4.4x", (uint16_t)c);
-            out.append(buf, 6);
-         }
-         else {
-            sprintf(buf, "\\U%8.8x", (uint32_t)c);
-            out.append(buf, 10);
+         R_len_t jnext = stri__escape_unicode_next(str_cur_s, j, str_cur_n);
+         memcpy(out+k, str_cur_s+j, (size_t)(jnext-j));
+         k += jnext-j;
+         j = jnext;
+         if (j < str_cur_n) {
+            U8_NEXT(str_cur_s, j, str_cur_n, c);
+            k += stri__escape_unicode_1(c, out+k);
          }
       }
 
       SET_STRING_ELT(ret, i,
-         Rf_mkCharLenCE(out.c_str(), (int)out.size(), (cetype_t)CE_UTF8)
+         Rf_mkCharLenCE(out, k, (cetype_t)CE_UTF8)
       );
    }
 
@@ -147,6 +230,19 @@ SEXP stri_escape_unicode(SEXP str)
 }
 
 
+/** A callback for u_unescapeAt() [internal]
+ *
+ * Escape sequences consist of ASCII characters only,
+ * hence the UTF-8 bytes may be passed as code units.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ */
+static UChar U_CALLCONV stri__unescape_unicode_charAt(int32_t offset, void* context)
+{
+   return (UChar)((const uint8_t*)context)[offset];
+}
+
+
 /**
  *  Unescape Unicode code points
  *
@@ -157,6 +253,13 @@ SEXP stri_escape_unicode(SEXP str)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-17)
+ *    work on UTF-8 directly: copy the runs between backslashes as-is,
+ *    unescape with u_unescapeAt() (as UnicodeString::unescape() does)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ *    keep a leading U+FEFF
 */
 SEXP stri_unescape_unicode(SEXP str)
 {
@@ -164,24 +267,103 @@ SEXP stri_unescape_unicode(SEXP str)
 
    STRI__ERROR_HANDLER_BEGIN(1)
    R_len_t str_length = LENGTH(str);
-   StriContainerUTF16 str_cont(str, str_length, false); // writable
+   StriContainerUTF8 str_cont(str, str_length);
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(STRSXP, str_length));
+
+   String8buf buf(0);
 
    for (R_len_t i = str_cont.vectorize_init();
          i != str_cont.vectorize_end();
          i = str_cont.vectorize_next(i))
    {
-      if (str_cont.isNA(i) || str_cont.get(i).length() == 0)
-         continue; // leave as-is
+      if (str_cont.isNA(i)) {
+         SET_STRING_ELT(ret, i, NA_STRING);
+         continue;
+      }
 
-      str_cont.getWritable(i).setTo(str_cont.get(i).unescape());
+      const char* str_cur_s = str_cont.get(i).c_str();
+      R_len_t     str_cur_n = str_cont.get(i).length();
+
+      // StriContainerUTF8 strips a leading BOM, but here U+FEFF
+      // is an ordinary code point that must be preserved
+      SEXP str_orig = STRING_ELT(str, i);
+      R_len_t str_orig_n = LENGTH(str_orig);
+      bool bom = (str_orig_n == str_cur_n+3 &&
+         (uint8_t)(CHAR(str_orig)[0]) == UTF8_BOM_BYTE1 &&
+         (uint8_t)(CHAR(str_orig)[1]) == UTF8_BOM_BYTE2 &&
+         (uint8_t)(CHAR(str_orig)[2]) == UTF8_BOM_BYTE3 &&
+         memcmp(CHAR(str_orig)+3, str_cur_s, (size_t)str_cur_n) == 0);
+
+      R_len_t j = stri__unescape_unicode_next(str_cur_s, 0, str_cur_n);
+      if (j == str_cur_n) { // no escape sequences (or an empty string)
+         SET_STRING_ELT(ret, i, bom ?
+            Rf_mkCharLenCE(CHAR(str_orig), str_orig_n, (cetype_t)CE_UTF8) :
+            str_cont.toR(i));
+         continue;
+      }
+
+      // an escape sequence is never shorter than its UTF-8 representation
+      buf.resize(str_orig_n, false);
+      char* out = buf.data();
+      R_len_t k = 0;
+      if (bom) {
+         memcpy(out, CHAR(str_orig), 3);
+         k = 3;
+      }
+      bool invalid = false;
+      bool surrogate = false;
+      j = 0;
+      while (j < str_cur_n) {
+         R_len_t jnext = stri__unescape_unicode_next(str_cur_s, j, str_cur_n);
+         memcpy(out+k, str_cur_s+j, (size_t)(jnext-j));
+         k += jnext-j;
+         j = jnext;
+         if (j >= str_cur_n) break;
 
-      if (str_cont.get(i).length() == 0) {
+         ++j; // skip the backslash
+         UChar32 c;
+         if (j < str_cur_n && (uint8_t)str_cur_s[j] > ASCII_MAXCHARCODE) {
+            // a backslash generically escapes the next code point
+            R_len_t jstart = j;
+            U8_FWD_1(str_cur_s, j, str_cur_n);
+            memcpy(out+k, str_cur_s+jstart, (size_t)(j-jstart));
+            k += j-jstart;
+            continue;
+         }
+         else if (j+1 < str_cur_n && str_cur_s[j] == 'c') {
+            // \cX is control-X (X might be non-ASCII)
+            ++j;
+            U8_NEXT(str_cur_s, j, str_cur_n, c);
+            if (c < 0) { invalid = true; break; }
+            c &= 0x1f;
+         }
+         else {
+            int32_t offset = j;
+            c = u_unescapeAt(stri__unescape_unicode_charAt, &offset, str_cur_n,
+               (void*)str_cur_s);
+            if (c < 0 || c > 0x10ffff) { invalid = true; break; }
+            j = offset;
+         }
+
+         if (U_IS_SURROGATE(c)) // unpaired, not representable in UTF-8
+            surrogate = true;
+         else
+            U8_APPEND_UNSAFE(out, k, c);
+      }
+
+      if (invalid) {
          Rf_warning(MSG__INVALID_ESCAPE);
-         str_cont.setNA(i); // something went wrong
+         SET_STRING_ELT(ret, i, NA_STRING);
       }
+      else if (surrogate)
+         throw StriException(U_INVALID_CHAR_FOUND);
+      else
+         SET_STRING_ELT(ret, i, Rf_mkCharLenCE(out, k, (cetype_t)CE_UTF8));
    }
 
    STRI__UNPROTECT_ALL
-   return str_cont.toR();
+   return ret;
    STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
 }
@@ -107,8 +107,9 @@ SEXP stri_trim_left(SEXP str, SEXP pattern);
 SEXP stri_trim_right(SEXP str, SEXP pattern);
 
 // random.cpp
-SEXP stri_rand_shuffle(SEXP str);
-SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern=Rf_mkString("[A-Za-z0-9]"));
+SEXP stri_rand_shuffle(SEXP str, SEXP rng=R_NilValue);
+SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern=Rf_mkString("[A-Za-z0-9]"),
+   SEXP rng=R_NilValue);
 
 // stats.cpp
 SEXP stri_stats_general(SEXP str);
@@ -117,6 +118,7 @@ SEXP stri_stats_latex(SEXP str);
 // trans_transliterate.cpp:
 SEXP stri_trans_list();
 SEXP stri_trans_general(SEXP str, SEXP id);
+SEXP stri_trans_general_clear_cache();
 
 // utils.cpp
 SEXP stri_list2matrix(SEXP x, SEXP byrow=Rf_ScalarLogical(FALSE),
@@ -177,15 +179,24 @@ SEXP stri_trans_isnfkc_casefold(SEXP s);
 // search
 SEXP stri_split_lines(SEXP str, SEXP omit_empty=Rf_ScalarLogical(FALSE));
 SEXP stri_split_lines1(SEXP str);
+SEXP stri_split_records(SEXP str, SEXP sep=Rf_mkString(","),
+   SEXP quote=Rf_mkString("\""), SEXP escape=Rf_mkString("\""));
 
 SEXP stri_replace_na(SEXP str, SEXP replacement=Rf_mkString("NA"));
 
+SEXP stri_in_fixed(SEXP str, SEXP table, SEXP nomatch=Rf_ScalarInteger(NA_INTEGER));
+SEXP stri_in_coll(SEXP str, SEXP table, SEXP nomatch=Rf_ScalarInteger(NA_INTEGER),
+   SEXP opts_collator=R_NilValue);
+
 SEXP stri_detect_coll(SEXP str, SEXP pattern, SEXP negate=Rf_ScalarLogical(FALSE), SEXP opts_collator=R_NilValue);
 SEXP stri_count_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue);
 SEXP stri_locate_all_coll(SEXP str, SEXP pattern,
-   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_collator=R_NilValue);
-SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue);
-SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue);
+   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_collator=R_NilValue,
+   SEXP units=R_NilValue, SEXP output=R_NilValue);
+SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue,
+   SEXP units=R_NilValue);
+SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue,
+   SEXP units=R_NilValue);
 SEXP stri_extract_first_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue);
 SEXP stri_extract_last_coll(SEXP str, SEXP pattern, SEXP opts_collator=R_NilValue);
 SEXP stri_extract_all_coll(SEXP str, SEXP pattern,
@@ -211,9 +222,12 @@ SEXP stri_subset_coll_replacement(SEXP str, SEXP pattern, SEXP negate, SEXP opts
 SEXP stri_detect_fixed(SEXP str, SEXP pattern, SEXP negate=Rf_ScalarLogical(FALSE), SEXP opts_fixed=R_NilValue);
 SEXP stri_count_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue);
 SEXP stri_locate_all_fixed(SEXP str, SEXP pattern,
-   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_fixed=R_NilValue);
-SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue);
-SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue);
+   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_fixed=R_NilValue,
+   SEXP units=R_NilValue, SEXP output=R_NilValue);
+SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue,
+   SEXP units=R_NilValue);
+SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue,
+   SEXP units=R_NilValue);
 SEXP stri_extract_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue);
 SEXP stri_extract_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed=R_NilValue);
 SEXP stri_extract_all_fixed(SEXP str, SEXP pattern,
@@ -234,14 +248,23 @@ SEXP stri_endswith_fixed(SEXP str, SEXP pattern, SEXP to=Rf_ScalarInteger(-1),
    SEXP opts_fixed=R_NilValue);
 SEXP stri_startswith_fixed(SEXP str, SEXP pattern, SEXP from=Rf_ScalarInteger(1),
    SEXP opts_fixed=R_NilValue);
+SEXP stri_endswith_which_fixed(SEXP str, SEXP pattern,
+   SEXP nomatch=Rf_ScalarInteger(NA_INTEGER), SEXP opts_fixed=R_NilValue);
+SEXP stri_startswith_which_fixed(SEXP str, SEXP pattern,
+   SEXP nomatch=Rf_ScalarInteger(NA_INTEGER), SEXP opts_fixed=R_NilValue);
 SEXP stri_subset_fixed_replacement(SEXP str, SEXP pattern, SEXP negate, SEXP opts_fixed, SEXP value);
 
 SEXP stri_detect_regex(SEXP str, SEXP pattern, SEXP negate=Rf_ScalarLogical(FALSE), SEXP opts_regex=R_NilValue);
+SEXP stri_detect_any_regex(SEXP str, SEXP pattern, SEXP negate=Rf_ScalarLogical(FALSE), SEXP opts_regex=R_NilValue);
+SEXP stri_detect_which_regex(SEXP str, SEXP pattern, SEXP mode=Rf_mkString("first"), SEXP opts_regex=R_NilValue);
 SEXP stri_count_regex(SEXP str, SEXP pattern, SEXP opts_regex=R_NilValue);
 SEXP stri_locate_all_regex(SEXP str, SEXP pattern,
-   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_regex=R_NilValue);
-SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex=R_NilValue);
-SEXP stri_locate_last_regex(SEXP str, SEXP pattern, SEXP opts_regex=R_NilValue);
+   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_regex=R_NilValue,
+   SEXP units=R_NilValue, SEXP output=R_NilValue);
+SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex=R_NilValue,
+   SEXP units=R_NilValue);
+SEXP stri_locate_last_regex(SEXP str, SEXP pattern, SEXP opts_regex=R_NilValue,
+   SEXP units=R_NilValue);
 SEXP stri_replace_all_regex(SEXP str, SEXP pattern, SEXP replacement,
    SEXP vectorize_all=Rf_ScalarLogical(FALSE), SEXP opts_regex=R_NilValue);
 SEXP stri_replace_first_regex(SEXP str, SEXP pattern, SEXP replacement,
@@ -274,10 +297,11 @@ SEXP stri_extract_last_charclass(SEXP str, SEXP pattern);
 SEXP stri_extract_all_charclass(SEXP str, SEXP pattern,
    SEXP merge=Rf_ScalarLogical(TRUE), SEXP simplify=Rf_ScalarLogical(FALSE),
    SEXP omit_no_match=Rf_ScalarLogical(FALSE));
-SEXP stri_locate_first_charclass(SEXP str, SEXP pattern);
-SEXP stri_locate_last_charclass(SEXP str, SEXP pattern);
+SEXP stri_locate_first_charclass(SEXP str, SEXP pattern, SEXP units=R_NilValue);
+SEXP stri_locate_last_charclass(SEXP str, SEXP pattern, SEXP units=R_NilValue);
 SEXP stri_locate_all_charclass(SEXP str, SEXP pattern,
-   SEXP merge=Rf_ScalarLogical(TRUE), SEXP omit_no_match=Rf_ScalarLogical(FALSE));
+   SEXP merge=Rf_ScalarLogical(TRUE), SEXP omit_no_match=Rf_ScalarLogical(FALSE),
+   SEXP units=R_NilValue, SEXP output=R_NilValue);
 SEXP stri_replace_last_charclass(SEXP str, SEXP pattern, SEXP replacement);
 SEXP stri_replace_first_charclass(SEXP str, SEXP pattern, SEXP replacement);
 SEXP stri_replace_all_charclass(SEXP str, SEXP pattern, SEXP replacement,
@@ -295,9 +319,12 @@ SEXP stri_extract_all_boundaries(SEXP str, SEXP simplify,
 SEXP stri_extract_first_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue);
 SEXP stri_extract_last_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue);
 SEXP stri_locate_all_boundaries(SEXP str,
-   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_brkiter=R_NilValue);
-SEXP stri_locate_first_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue);
-SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue);
+   SEXP omit_no_match=Rf_ScalarLogical(FALSE), SEXP opts_brkiter=R_NilValue,
+   SEXP units=R_NilValue, SEXP output=R_NilValue);
+SEXP stri_locate_first_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue,
+   SEXP units=R_NilValue);
+SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter=R_NilValue,
+   SEXP units=R_NilValue);
 SEXP stri_split_boundaries(SEXP str, SEXP n=Rf_ScalarInteger(-1),
    SEXP tokens_only=Rf_ScalarLogical(FALSE),
    SEXP simplify=Rf_ScalarLogical(FALSE), SEXP opts_brkiter=R_NilValue);
@@ -34,12 +34,165 @@
 #include "stri_container_base.h"
 #include "stri_container_utf8.h"
 #include "stri_container_integer.h"
-#include "stri_container_listutf8.h"
 #include "stri_string8buf.h"
 #include <vector>
 using namespace std;
 
 
+/**
+ * A read-only UTF-8 view of a character vector,
+ * used when joining many (and possibly long) vectors
+ *
+ * ASCII and UTF-8 strings are accessed directly via CHAR(),
+ * with no per-string bookkeeping; a StriContainerUTF8 is created
+ * only if some strings in the vector need re-encoding.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-05)
+ */
+class StriJoinColumn {
+
+   private:
+
+      SEXP vec;
+      R_len_t n;
+      StriContainerUTF8* conv; // NULL if all strings are ASCII/UTF-8/NA
+
+   public:
+
+      StriJoinColumn()
+      {
+         vec = R_NilValue;
+         n = 0;
+         conv = NULL;
+      }
+
+      StriJoinColumn(const StriJoinColumn& col)
+      {
+         // only default-constructed views may be copied
+#ifndef NDEBUG
+         if (col.conv)
+            throw StriException("DEBUG: StriJoinColumn copy");
+#endif
+         vec = col.vec;
+         n = col.n;
+         conv = NULL;
+      }
+
+      StriJoinColumn& operator=(const StriJoinColumn& col)
+      {
+         // as above; needed by std::vector
+#ifndef NDEBUG
+         if (col.conv)
+            throw StriException("DEBUG: StriJoinColumn operator=");
+#endif
+         if (this == &col) return *this;
+         if (conv) delete conv;
+         vec = col.vec;
+         n = col.n;
+         conv = NULL;
+         return *this;
+      }
+
+      ~StriJoinColumn()
+      {
+         if (conv) delete conv;
+      }
+
+
+      /** inspect the encodings in a character vector (once)
+       *
+       * @param _vec character vector of length > 0
+       * @param nrecycle extend length [vectorization]
+       */
+      void init(SEXP _vec, R_len_t nrecycle)
+      {
+         vec = _vec;
+         n = LENGTH(vec);
+         for (R_len_t i=0; i<n; ++i) {
+            SEXP curs = STRING_ELT(vec, i);
+            if (curs != NA_STRING && !IS_ASCII(curs) && !IS_UTF8(curs)) {
+               conv = new StriContainerUTF8(vec, nrecycle);
+               break;
+            }
+         }
+      }
+
+
+      /** get the vectorized ith element
+       *
+       * @param i index
+       * @param s [out] UTF-8 string
+       * @param len [out] number of bytes in s
+       * @return false if NA
+       */
+      inline bool get(R_len_t i, const char*& s, R_len_t& len) const
+      {
+         if (conv) {
+            if (conv->isNA(i)) return false;
+            s   = conv->get(i).c_str();
+            len = conv->get(i).length();
+            return true;
+         }
+
+         SEXP curs = STRING_ELT(vec, (i < n)?i:(i%n));
+         if (curs == NA_STRING) return false;
+         s   = CHAR(curs);
+         len = LENGTH(curs);
+         if (len >= 3 &&
+               (uint8_t)(s[0]) == UTF8_BOM_BYTE1 &&
+               (uint8_t)(s[1]) == UTF8_BOM_BYTE2 &&
+               (uint8_t)(s[2]) == UTF8_BOM_BYTE3) {
+            // has BOM - skip it (as StriContainerUTF8 does)
+            s   += 3;
+            len -= 3;
+         }
+         return true;
+      }
+
+
+      /** get the vectorized ith element's CHARSXP,
+       * provided that it is an ASCII/UTF-8 string viewed as-is
+       *
+       * @param i index
+       * @return CHARSXP or R_NilValue
+       */
+      inline SEXP getCHARSXP(R_len_t i) const
+      {
+         if (conv) return R_NilValue;
+         SEXP curs = STRING_ELT(vec, (i < n)?i:(i%n));
+         const char* s;
+         R_len_t len;
+         if (!get(i, s, len) || len != LENGTH(curs)) return R_NilValue;
+         return curs;
+      }
+};
+
+
+/** Prepare views of a list of character vectors
+ *
+ * @param cols [out]
+ * @param strlist list of character vectors of lengths > 0
+ * @param vectorize_length recycle all vectors to this length
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-05)
+ */
+static void stri__join_columns(std::vector<StriJoinColumn>& cols,
+   SEXP strlist, R_len_t vectorize_length)
+{
+   R_len_t strlist_length = LENGTH(strlist);
+   for (R_len_t j=0; j<strlist_length; ++j) {
+      if (vectorize_length % LENGTH(VECTOR_ELT(strlist, j)) != 0) {
+         Rf_warning(MSG__WARN_RECYCLING_RULE);
+         break;
+      }
+   }
+
+   cols.resize(strlist_length);
+   for (R_len_t j=0; j<strlist_length; ++j)
+      cols[j].init(VECTOR_ELT(strlist, j), vectorize_length);
+}
+
+
 /**
  * Prepare list argument -- ignore empty vectors if needed, used by stri_paste
  *
@@ -442,6 +595,11 @@ SEXP stri_join2_withcollapse(SEXP e1, SEXP e2, SEXP collapse)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-11-27)
  *    FR #116: ignore_null arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-05)
+ *    use StriJoinColumn views instead of StriContainerListUTF8;
+ *    NA rows are detected before any copying;
+ *    a single vector's ASCII/UTF-8 strings are not copied
  */
 SEXP stri_join_nocollapse(SEXP strlist, SEXP sep, SEXP ignore_null)
 {
@@ -487,7 +645,7 @@ SEXP stri_join_nocollapse(SEXP strlist, SEXP sep, SEXP ignore_null)
    // note that if 1 vector is given
    // we cannot return VECTOR_ELT(strlist, 0) directly
    // -- it needs to be converted to UTF8
-   // so we proceed
+   // so we proceed (but we reuse its ASCII/UTF-8 strings)
 
    SEXP ret;
    STRI__ERROR_HANDLER_BEGIN(2)
@@ -496,54 +654,58 @@ SEXP stri_join_nocollapse(SEXP strlist, SEXP sep, SEXP ignore_null)
    const char* sep_char = sep_cont.get(0).c_str();
    R_len_t     sep_len  = sep_cont.get(0).length();
 
-   StriContainerListUTF8 strlist_cont(strlist, vectorize_length);
+   std::vector<StriJoinColumn> cols;
+   stri__join_columns(cols, strlist, vectorize_length);
 
-
-   // 4. Get buf size and determine where NAs will occur
+   // 4. Get buf size; NA rows are skipped as soon as an NA is found
    R_len_t buf_maxbytes = 0;
-   vector<bool> whichNA(vectorize_length, false); // where are NAs in out?
+   const char* curstring_s;
+   R_len_t     curstring_n;
    for (R_len_t i=0; i<vectorize_length; ++i) {
-
       R_len_t curchar = 0;
-      for (R_len_t j=0; j<strlist_length; ++j) {
-         if (strlist_cont.get(j).isNA(i)) {
-            whichNA[i] = true;
-            break;
-         }
-         else {
-            curchar += strlist_cont.get(j).get(i).length()
-               + ((j>0)?sep_len:0);
-         }
+      R_len_t j;
+      for (j=0; j<strlist_length; ++j) {
+         if (!cols[j].get(i, curstring_s, curstring_n))
+            break; // NA
+         curchar += curstring_n + ((j>0)?sep_len:0);
       }
-      if (!whichNA[i] && curchar > buf_maxbytes)
+      if (j == strlist_length && curchar > buf_maxbytes)
          buf_maxbytes = curchar;
    }
 
    // 5. Create ret val
    String8buf buf(buf_maxbytes);
+   char* bufdata = buf.data();
    STRI__PROTECT(ret = Rf_allocVector(STRSXP, vectorize_length));
 
    for (R_len_t i=0; i<vectorize_length; ++i) {
-      if (whichNA[i]) {
-         SET_STRING_ELT(ret, i, NA_STRING);
-         continue;
+      if (strlist_length == 1) {
+         SEXP curs = cols[0].getCHARSXP(i);
+         if (curs != R_NilValue) {
+            SET_STRING_ELT(ret, i, curs);
+            continue;
+         }
       }
 
       R_len_t cursize = 0;
-      for (R_len_t j=0; j<strlist_length; ++j) {
+      R_len_t j;
+      for (j=0; j<strlist_length; ++j) {
+         if (!cols[j].get(i, curstring_s, curstring_n))
+            break; // NA
 
-         if (sep_len >= 0 && j > 0) {
-            memcpy(buf.data()+cursize, sep_char, (size_t)sep_len);
+         if (sep_len > 0 && j > 0) {
+            memcpy(bufdata+cursize, sep_char, (size_t)sep_len);
             cursize += sep_len;
          }
 
-         const String8* curstring = &(strlist_cont.get(j).get(i));
-         R_len_t curstring_n = curstring->length();
-         memcpy(buf.data()+cursize, curstring->c_str(), (size_t)curstring_n);
+         memcpy(bufdata+cursize, curstring_s, (size_t)curstring_n);
          cursize += curstring_n;
       }
 
-      SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), cursize, CE_UTF8));
+      if (j < strlist_length)
+         SET_STRING_ELT(ret, i, NA_STRING);
+      else
+         SET_STRING_ELT(ret, i, Rf_mkCharLenCE(bufdata, cursize, CE_UTF8));
    }
 
    // nothing more to do:
@@ -578,6 +740,9 @@ SEXP stri_join_nocollapse(SEXP strlist, SEXP sep, SEXP ignore_null)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-11-27)
  *    FR #116: ignore_null arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-05)
+ *    use StriJoinColumn views instead of StriContainerListUTF8
  */
 SEXP stri_join(SEXP strlist, SEXP sep, SEXP collapse, SEXP ignore_null)
 {
@@ -635,7 +800,8 @@ SEXP stri_join(SEXP strlist, SEXP sep, SEXP collapse, SEXP ignore_null)
 
    STRI__ERROR_HANDLER_BEGIN(3)
 
-   StriContainerListUTF8 strlist_cont(strlist, vectorize_length);
+   std::vector<StriJoinColumn> cols;
+   stri__join_columns(cols, strlist, vectorize_length);
 
    StriContainerUTF8 sep_cont(sep, 1); // definitely not NA
    const char* sep_s = sep_cont.get(0).c_str();
@@ -647,14 +813,16 @@ SEXP stri_join(SEXP strlist, SEXP sep, SEXP collapse, SEXP ignore_null)
 
    // Get required buffer size
    R_len_t buf_maxbytes = 0;
+   const char* curstring_s;
+   R_len_t     curstring_n;
    for (R_len_t i=0; i<vectorize_length; ++i) {   // for each vectorized string (vertically)
       for (R_len_t j=0; j<strlist_length; ++j) {  // for each character vector  (horizontally)
-         if (strlist_cont.get(j).isNA(i)) {
+         if (!cols[j].get(i, curstring_s, curstring_n)) {
             STRI__UNPROTECT_ALL
             return stri__vector_NA_strings(1);
          }
 
-         buf_maxbytes += strlist_cont.get(j).get(i).length()+ ((j>0)?sep_n:0);
+         buf_maxbytes += curstring_n + ((j>0)?sep_n:0);
       }
 
       if (i>0) buf_maxbytes += collapse_n;
@@ -679,9 +847,8 @@ SEXP stri_join(SEXP strlist, SEXP sep, SEXP collapse, SEXP ignore_null)
             last_buf_idx += sep_n;
          }
 
-         const String8* curstring = &(strlist_cont.get(j).get(i));
-         R_len_t curstring_n = curstring->length();
-         memcpy(buf.data()+last_buf_idx, curstring->c_str(), (size_t)curstring_n);
+         cols[j].get(i, curstring_s, curstring_n); // not NA
+         memcpy(buf.data()+last_buf_idx, curstring_s, (size_t)curstring_n);
          last_buf_idx += curstring_n;
       }
    }
@@ -32,6 +32,8 @@
 #include "stri_stringi.h"
 #include "stri_ucnv.h"
 #include "stri_container_utf8.h"
+#include <deque>
+#include <vector>
 
 
 /**
@@ -89,6 +91,9 @@ R_len_t stri__numbytes_max(SEXP str)
  */
 SEXP stri_length(SEXP str)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_length(str))
+
    PROTECT(str = stri_prepare_arg_string(str, "str"));
 
    STRI__ERROR_HANDLER_BEGIN(1)
@@ -231,7 +236,7 @@ SEXP stri_isempty(SEXP str)
 }
 
 
-/** Get width of a single character
+/** Get width of a single character (uncached)
  *
  * inspired by http://www.cl.cam.ac.uk/~mgk25/ucs/wcwidth.c
  *
@@ -240,10 +245,13 @@ SEXP stri_isempty(SEXP str)
  * @version 1.2.1 (Marek Gagolewski, 2018-04-20)
  *    add Variation Selectors support (width 0)
  *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-04)
+ *    renamed from stri__width_char; now used to fill the lookup table
+ *
  * @param c code point
  * @return 0, 1, or 2
  */
-int stri__width_char(UChar32 c) {
+static int stri__width_char_icu(UChar32 c) {
    if (c == (UChar32)0x00AD) return 1; /* SOFT HYPHEN  */
    if (c == (UChar32)0x200B) return 0; /* ZERO WIDTH SPACE */
 
@@ -272,11 +280,84 @@ int stri__width_char(UChar32 c) {
 }
 
 
+#define STRI__WIDTH_BLOCK_SHIFT 8
+#define STRI__WIDTH_BLOCK_SIZE  (1<<STRI__WIDTH_BLOCK_SHIFT)
+#define STRI__WIDTH_NBLOCKS     ((UCHAR_MAX_VALUE+1)>>STRI__WIDTH_BLOCK_SHIFT)
+
+
+/** Two-level code point width lookup table:
+ * stri__width_index[c>>8] points to the widths of 256 consecutive
+ * code points or is NULL if that block has not been needed yet.
+ *
+ * The blocks are computed on demand (with the ICU library we are linked
+ * against, so that the widths agree with its Unicode version);
+ * identical blocks (e.g., CJK ideographs or unassigned code points)
+ * are shared.
+ */
+static const uint8_t* stri__width_index[STRI__WIDTH_NBLOCKS];
+static std::deque< std::vector<uint8_t> > stri__width_blocks;
+
+
+/** Compute the widths of code points in a given block
+ *
+ * @param block block number, c>>STRI__WIDTH_BLOCK_SHIFT
+ * @return pointer to the block's widths
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-04)
+ */
+static const uint8_t* stri__width_block_get(UChar32 block)
+{
+   std::vector<uint8_t> widths(STRI__WIDTH_BLOCK_SIZE);
+   UChar32 c0 = block<<STRI__WIDTH_BLOCK_SHIFT;
+   for (int k=0; k<STRI__WIDTH_BLOCK_SIZE; ++k)
+      widths[k] = (uint8_t)stri__width_char_icu(c0+k);
+
+   const uint8_t* ret = NULL;
+   for (std::deque< std::vector<uint8_t> >::iterator it = stri__width_blocks.begin();
+         !ret && it != stri__width_blocks.end(); ++it) {
+      if (*it == widths) ret = &(*it)[0];
+   }
+
+   if (!ret) {
+      stri__width_blocks.push_back(widths);
+      ret = &stri__width_blocks.back()[0];
+   }
+
+   stri__width_index[block] = ret;
+   return ret;
+}
+
+
+/** Get width of a single character
+ *
+ * @param c code point
+ * @return 0, 1, or 2
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-04)
+ *    use a lookup table
+ */
+int stri__width_char(UChar32 c) {
+   if ((uint32_t)c < 0x80)
+      return (c >= 0x20 && c != 0x7F); /* Cc -> 0 */
+
+   if ((uint32_t)c > (uint32_t)UCHAR_MAX_VALUE)
+      return stri__width_char_icu(c);
+
+   const uint8_t* block = stri__width_index[c>>STRI__WIDTH_BLOCK_SHIFT];
+   if (!block)
+      block = stri__width_block_get(c>>STRI__WIDTH_BLOCK_SHIFT);
+   return (int)block[c&(STRI__WIDTH_BLOCK_SIZE-1)];
+}
+
+
 /** Get width of a single UTF-8 string
  *
  * @param str_cur_s string
  * @param str_cur_n number of bytes in str_cur_s
  * @return width
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-04)
+ *    ASCII fast path
  */
 int stri__width_string(const char* str_cur_s, int str_cur_n) {
    int cur_width = 0;
@@ -284,6 +365,13 @@ int stri__width_string(const char* str_cur_s, int str_cur_n) {
    UChar32 c;
    R_len_t j = 0;
    while (j < str_cur_n) {
+      uint8_t b = (uint8_t)str_cur_s[j];
+      if (b < 0x80) {
+         cur_width += (b >= 0x20 && b != 0x7F); /* Cc -> 0 */
+         ++j;
+         continue;
+      }
+
       U8_NEXT(str_cur_s, j, str_cur_n, c);
       if (c < 0)
          throw StriException(MSG__INVALID_UTF8);
@@ -304,6 +392,9 @@ int stri__width_string(const char* str_cur_s, int str_cur_n) {
   */
 SEXP stri_width(SEXP str)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_width(str))
+
    PROTECT(str = stri_prepare_arg_string(str, "str")); // prepare string argument
 
    STRI__ERROR_HANDLER_BEGIN(1)
@@ -0,0 +1,120 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __stri_locate_flat_h
+#define __stri_locate_flat_h
+
+#include "stri_stringi.h"
+#include <vector>
+
+
+/**
+ * Accumulates the results of stri_locate_all_*(..., output="flat")
+ *
+ * Instead of a list of 2-column matrices (one per string),
+ * three parallel integer vectors are built:
+ * the (1-based) index of the string, and the start and end positions.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ */
+class StriLocateFlat {
+
+   private:
+
+      std::vector<int> id;
+      std::vector<int> start;
+      std::vector<int> end;
+
+
+   public:
+
+      /** add a row of NAs (no match or missing input)
+       *
+       * @param i 0-based string index
+       */
+      inline void pushNA(R_len_t i)
+      {
+         id.push_back(i+1);
+         start.push_back(NA_INTEGER);
+         end.push_back(NA_INTEGER);
+      }
+
+
+      /** reserve room for n rows concerning the i-th string
+       *
+       * getStart(k) and getEnd(k) are valid until the next call
+       * to this method or pushNA()
+       *
+       * @param i 0-based string index
+       * @param n number of rows
+       * @return index k of the first row added
+       */
+      inline R_len_t append(R_len_t i, R_len_t n)
+      {
+         R_len_t k = (R_len_t)id.size();
+         id.resize(k+n, i+1);
+         start.resize(k+n);
+         end.resize(k+n);
+         return k;
+      }
+
+      /* k may equal the number of rows if append() added none,
+       * hence no operator[] here (it would index one past the end) */
+      inline int* getStart(R_len_t k) { return start.empty() ? NULL : &start[0]+k; }
+      inline int* getEnd(R_len_t k)   { return end.empty() ? NULL : &end[0]+k; }
+
+
+      /** @return a named list with 3 integer vectors: id, start, end */
+      SEXP toR() const
+      {
+         R_len_t n = (R_len_t)id.size();
+         SEXP ret, names, cur;
+         PROTECT(ret = Rf_allocVector(VECSXP, 3));
+         PROTECT(names = Rf_allocVector(STRSXP, 3));
+         SET_STRING_ELT(names, 0, Rf_mkChar("id"));
+         SET_STRING_ELT(names, 1, Rf_mkChar(MSG__LOCATE_DIM_START));
+         SET_STRING_ELT(names, 2, Rf_mkChar(MSG__LOCATE_DIM_END));
+         Rf_setAttrib(ret, R_NamesSymbol, names);
+
+         const std::vector<int>* src[3] = { &id, &start, &end };
+         for (int c = 0; c < 3; ++c) {
+            SET_VECTOR_ELT(ret, c, cur = Rf_allocVector(INTSXP, n));
+            int* cur_tab = INTEGER(cur);
+            for (R_len_t k = 0; k < n; ++k)
+               cur_tab[k] = (*src[c])[k];
+         }
+         UNPROTECT(2);
+         return ret;
+      }
+};
+
+#endif
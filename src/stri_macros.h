@@ -63,6 +63,25 @@
       }                                                                                          \
 
 
+/* Evaluate a vectorized function on a factor's levels only
+ * and expand the result through the factor's codes.
+ * Use at the beginning of a function (before prepare_arg):
+ * `str` is replaced by the levels and `call` (usually a recursive call)
+ * should give a vector of length LENGTH(str), see stri__factor_expand().
+ * `cond` tells whether the function is vectorized over `str` only.
+ */
+#define STRI__FACTOR_APPLY_TO_LEVELS(str, cond, call)                     \
+   if (stri__factor_use_levels(str) && (cond)) {                          \
+      SEXP stri__factor = (str);                                          \
+      SEXP stri__factor_ret;                                              \
+      PROTECT(str = Rf_getAttrib(stri__factor, R_LevelsSymbol));          \
+      PROTECT(stri__factor_ret = (call));                                 \
+      stri__factor_ret = stri__factor_expand(stri__factor, stri__factor_ret); \
+      UNPROTECT(2);                                                       \
+      return stri__factor_ret;                                            \
+   }
+
+
 #define STRI__GET_INT32_BE(input, index) \
    uint32_t(((uint8_t*)input)[index+0] << 24 | ((uint8_t*)input)[index+1] << 16 | ((uint8_t*)input)[index+2] << 8 | ((uint8_t*)input)[index+3])
 
@@ -172,4 +191,34 @@
 #define UCHAR_LS  0x2028
 #define UCHAR_PS  0x2029
 
+/* ************************************************************************ */
+
+/* SWAR helpers: 8 bytes at a time, in a uint64_t */
+#define STRI__SWAR_ONES  ((uint64_t)0x0101010101010101ULL)
+#define STRI__SWAR_HIGHS ((uint64_t)0x8080808080808080ULL)
+
+/* nonzero iff some byte of x is 0 */
+#define STRI__SWAR_HAS_ZERO(x) (((x)-STRI__SWAR_ONES) & ~(x) & STRI__SWAR_HIGHS)
+
+/* nonzero iff some byte of x is equal to b */
+#define STRI__SWAR_HAS_BYTE(x, b) STRI__SWAR_HAS_ZERO((x) ^ (STRI__SWAR_ONES*(uint8_t)(b)))
+
+/* nonzero iff some byte of x is < n, n <= 128 */
+#define STRI__SWAR_HAS_LESS(x, n) (((x)-STRI__SWAR_ONES*(n)) & ~(x) & STRI__SWAR_HIGHS)
+
+/* nonzero iff some byte of x is in (m, n), m and n < 128 */
+#define STRI__SWAR_HAS_BETWEEN(x, m, n) \
+   ((STRI__SWAR_ONES*(127+(n))-((x)&STRI__SWAR_ONES*127)) & ~(x) & \
+   (((x)&STRI__SWAR_ONES*127)+STRI__SWAR_ONES*(127-(m))) & STRI__SWAR_HIGHS)
+
+/* exact per-byte masks (the high bit of each byte) for ASCII-only x,
+   i.e., if (x & STRI__SWAR_HIGHS) == 0:
+   bytes equal to b < 128, bytes >= n, 0 < n <= 128 */
+#define STRI__SWAR_ASCII_EQ(x, b) \
+   (~(((x)^(STRI__SWAR_ONES*(b)))+STRI__SWAR_ONES*127) & STRI__SWAR_HIGHS)
+#define STRI__SWAR_ASCII_GE(x, n) (((x)+STRI__SWAR_ONES*(128-(n))) & STRI__SWAR_HIGHS)
+
+/* number of bytes with the high bit set in a mask as above */
+#define STRI__SWAR_COUNT(m) ((R_len_t)((((m) >> 7)*STRI__SWAR_ONES) >> 56))
+
 #endif
@@ -0,0 +1,184 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2017, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __stri_memo_h
+#define __stri_memo_h
+
+#include "stri_external.h"
+#include <vector>
+
+
+/* minimal number of elements for which memoization is attempted */
+#define STRI__MEMO_MIN_LENGTH 64
+
+/* number of lookups after which the hit rate is assessed */
+#define STRI__MEMO_PROBATION 1024
+
+/* hit rate (1/x) below which memoization is switched off */
+#define STRI__MEMO_MIN_HIT_RATE_INV 8
+
+
+/**
+ * A per-call memo table for expensive element-wise transforms
+ *
+ * R keeps a global cache of strings, so that equal strings
+ * (with the same declared encoding) share the same CHARSXP.
+ * Hence, the addresses of input CHARSXPs can serve as hash table keys.
+ *
+ * An open-addressing (linear probing) table, which grows as needed.
+ * Memoization is switched off automatically (and the memory is released)
+ * if the hit rate observed over the first STRI__MEMO_PROBATION lookups
+ * is low, as well as for short vectors.
+ *
+ * The values are not PROTECTed -- if T is SEXP, store only
+ * objects that are already referenced by the output vector.
+ * Neither are the keys: they must be elements of a character vector
+ * that keeps them alive. This is not the case for ALTREP vectors,
+ * which may create a new CHARSXP on each STRING_ELT() call (a key could
+ * be garbage collected and its address reused by another string),
+ * hence memoization is disabled for them.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-10)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ *    keys are not PROTECTed, so ALTREP vectors are not memoized
+ */
+template <class T>
+class StriMemo {
+
+   private:
+
+      struct Slot {
+         SEXP key; // NULL for an empty slot
+         T value;
+      };
+
+      std::vector<Slot> slots;
+      size_t mask;
+      size_t count;
+      R_len_t lookups;
+      R_len_t hits;
+      bool enabled;
+
+      static inline size_t hash(SEXP key) {
+         uint64_t h = (uint64_t)(uintptr_t)key;
+         h ^= h >> 33;
+         h *= 0xFF51AFD7ED558CCDULL;
+         h ^= h >> 33;
+         return (size_t)h;
+      }
+
+      inline size_t find(SEXP key) const {
+         size_t k = hash(key) & mask;
+         while (slots[k].key != NULL && slots[k].key != key)
+            k = (k+1) & mask;
+         return k;
+      }
+
+      void grow() {
+         std::vector<Slot> old;
+         old.swap(slots);
+         Slot empty;
+         empty.key = NULL;
+         slots.assign(2*old.size(), empty);
+         mask = slots.size()-1;
+         for (size_t j=0; j<old.size(); ++j) {
+            if (old[j].key != NULL)
+               slots[find(old[j].key)] = old[j];
+         }
+      }
+
+
+   public:
+
+      /**
+       * @param n number of elements to be processed
+       * @param x character vector whose elements serve as keys
+       */
+      StriMemo(R_len_t n, SEXP x) {
+         count = 0;
+         lookups = 0;
+         hits = 0;
+         mask = 0;
+         enabled = (n >= STRI__MEMO_MIN_LENGTH);
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 5, 0)
+         if (ALTREP(x)) enabled = false;
+#endif
+         if (enabled) {
+            Slot empty;
+            empty.key = NULL;
+            slots.assign(256, empty);
+            mask = slots.size()-1;
+         }
+      }
+
+
+      /** Fetch a memoized value
+       *
+       * @param key CHARSXP
+       * @param value [out]
+       * @return true if found
+       */
+      inline bool get(SEXP key, T& value) {
+         if (!enabled) return false;
+         if (++lookups == STRI__MEMO_PROBATION &&
+               hits < STRI__MEMO_PROBATION/STRI__MEMO_MIN_HIT_RATE_INV) {
+            enabled = false; // not worth it
+            std::vector<Slot>().swap(slots);
+            return false;
+         }
+         size_t k = find(key);
+         if (slots[k].key == NULL)
+            return false;
+         ++hits;
+         value = slots[k].value;
+         return true;
+      }
+
+
+      /** Memoize a value
+       *
+       * @param key CHARSXP
+       * @param value value
+       */
+      inline void set(SEXP key, const T& value) {
+         if (!enabled) return;
+         size_t k = find(key);
+         if (slots[k].key == NULL) {
+            slots[k].key = key;
+            slots[k].value = value;
+            if (2*(++count) > slots.size()) grow(); // load factor <= 0.5
+         }
+      }
+};
+
+#endif
@@ -125,6 +125,9 @@
 #define MSG__EXPECTED_ASCII \
    "incorrect argument: the string contains non-ASCII characters"
 
+#define MSG__EXPECTED_ASCII_CHAR \
+   "argument `%s`: expected a single ASCII character other than a newline"
+
 #define MSG__TIMEZONE_INCORRECT_ID \
    "incorrect time zone identifier"
 
@@ -197,6 +200,12 @@
 #define MSG__CHARCLASS_INCORRECT \
    "unknown charclass"
 
+#define MSG__CHARCLASS_EMPTY \
+   "cannot draw from an empty charclass"
+
+#define MSG__CHARCLASS_NOT_UTF8 \
+   "a surrogate or a string has been drawn from a charclass; exclude them, e.g., [[^a]-[\\p{Cs}]]"
+
 #define MSG__ARG_EXPECTED_NOT_NA \
    "missing value in argument `%s` is not supported"
 
@@ -209,13 +209,21 @@ SEXP stri_prepare_arg_list_string(SEXP x, const char* argname)
  *
  * @version 1.2.1 (Marek Gagolewski, 2018-04-21)
  *    #285: warn if coercing from a non-trivial list
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-09)
+ *    factors are expanded through their codes directly (no as.character
+ *    call); all the elements share the CHARSXPs of the levels
  */
 SEXP stri_prepare_arg_string(SEXP x, const char* argname)
 {
    if ((SEXP*)argname == (SEXP*)R_NilValue)
       argname = "<noname>";
 
-   if (Rf_isFactor(x))
+   if (stri__factor_is_plain(x))
+   {
+      return stri__factor_expand(x, Rf_getAttrib(x, R_LevelsSymbol));
+   }
+   else if (Rf_isFactor(x))
    {
       SEXP call;
       PROTECT(call = Rf_lang2(Rf_install("as.character"), x));
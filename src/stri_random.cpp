@@ -38,9 +38,225 @@
 #include "stri_container_charclass.h"
 
 
+/** Philox4x32-10, a counter-based pseudorandom number generator [internal]
+ *
+ * See J.K. Salmon et al., Parallel random numbers: As easy as 1, 2, 3,
+ * In: Proc. SC'11, 2011, doi:10.1145/2063384.2063405.
+ *
+ * The key is seeded from R's RNG. The i-th string is generated
+ * from its own stream (the counter is (block, i)), hence the result
+ * does not depend on the order in which the strings are generated.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ */
+class StriRandomPhilox {
+private:
+   uint32_t key[2];
+   uint32_t ctr[4];
+   uint32_t out[4];
+   int pos; // next unused word in out
+
+   static inline void mulhilo(uint32_t a, uint32_t b, uint32_t& hi, uint32_t& lo) {
+      uint64_t p = (uint64_t)a*(uint64_t)b;
+      hi = (uint32_t)(p >> 32);
+      lo = (uint32_t)p;
+   }
+
+   void generate() {
+      uint32_t c[4] = { ctr[0], ctr[1], ctr[2], ctr[3] };
+      uint32_t k[2] = { key[0], key[1] };
+      for (int r=0; r<10; ++r) {
+         if (r > 0) {
+            k[0] += 0x9E3779B9U;
+            k[1] += 0xBB67AE85U;
+         }
+         uint32_t hi0, lo0, hi1, lo1;
+         mulhilo(0xD2511F53U, c[0], hi0, lo0);
+         mulhilo(0xCD9E8D57U, c[2], hi1, lo1);
+         uint32_t t[4] = { hi1^c[1]^k[0], lo1, hi0^c[3]^k[1], lo0 };
+         c[0] = t[0]; c[1] = t[1]; c[2] = t[2]; c[3] = t[3];
+      }
+      out[0] = c[0]; out[1] = c[1]; out[2] = c[2]; out[3] = c[3];
+      pos = 0;
+      if (++ctr[0] == 0) ++ctr[1];
+   }
+
+public:
+   /** call between GetRNGstate() and PutRNGstate() */
+   StriRandomPhilox() {
+      key[0] = (uint32_t)floor(unif_rand()*4294967296.0);
+      key[1] = (uint32_t)floor(unif_rand()*4294967296.0);
+      setStream(0);
+   }
+
+   /** start the i-th stream */
+   void setStream(R_len_t i) {
+      ctr[0] = ctr[1] = 0;
+      ctr[2] = (uint32_t)i;
+      ctr[3] = 0;
+      pos = 4;
+   }
+
+   /** @return a uniform number in [0,1) with 53 random bits */
+   inline double unif() {
+      if (pos > 2) generate();
+      uint64_t x = ((uint64_t)out[pos] << 21) ^ (uint64_t)(out[pos+1] >> 11);
+      pos += 2;
+      return (double)x*(1.0/9007199254740992.0); // 2^-53
+   }
+};
+
+
+/** A source of uniform random numbers: either R's RNG or Philox [internal]
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ */
+class StriRandom {
+private:
+   StriRandomPhilox* philox;
+
+   StriRandom(const StriRandom&); /* not copy-able */
+   StriRandom& operator=(const StriRandom&);
+
+public:
+   /** call between GetRNGstate() and PutRNGstate() */
+   StriRandom(bool use_philox) {
+      philox = (use_philox)?(new StriRandomPhilox()):NULL;
+   }
+
+   ~StriRandom() {
+      if (philox) delete philox;
+   }
+
+   /** start generating the i-th string (matters only for Philox) */
+   inline void setStream(R_len_t i) {
+      if (philox) philox->setStream(i);
+   }
+
+   /** @return a random integer in 0..n-1 */
+   inline R_len_t draw(R_len_t n) {
+      double u = (philox)?philox->unif():unif_rand();
+      return (R_len_t)floor(u*(double)n);
+   }
+};
+
+
+/** Get the `rng` argument [internal]
+ *
+ * @param rng \code{"R"} or \code{"philox"}; \code{NULL} for the former
+ * @return whether Philox is to be used
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ */
+static bool stri__rand_get_rng_philox(SEXP rng)
+{
+   if (Rf_isNull(rng)) return false;
+   const char* rng_val = stri__prepare_arg_string_1_notNA(rng, "rng");
+   const char* rng_opts[] = {"R", "philox", NULL};
+   int rng_cur = stri__match_arg(rng_val, rng_opts);
+   if (rng_cur < 0)
+      Rf_error(MSG__INCORRECT_MATCH_OPTION, "rng");
+   return (rng_cur == 1);
+}
+
+
+/** Draws code points from a charclass [internal]
+ *
+ * Drawing the k-th element of a UnicodeSet with charAt()
+ * walks its range list each time; optionally, the UTF-8 encodings
+ * of all its code points are precomputed and drawing is a table lookup.
+ * Either way, the k-th element is the same, and surrogates
+ * and multi-code point strings (which cannot be output)
+ * are only reported when drawn.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ *    tabulation is optional; surrogates are not rejected in advance
+ */
+class StriRandomCharTable {
+private:
+   const UnicodeSet* uset;
+   R_len_t n;                  // number of elements in uset
+   bool tabulated;
+   bool ascii;
+   std::vector<char> bytes;    // 4 bytes per code point (1 if ascii)
+   std::vector<uint8_t> lens;  // UTF-8 lengths; 0 if not representable
+
+public:
+   StriRandomCharTable() : uset(NULL), n(0), tabulated(false), ascii(false) { }
+
+   /** @param uset must be valid as long as generate() is called
+    *  @param tabulate whether to precompute the UTF-8 encodings;
+    *     pays off if many code points are to be drawn */
+   void set(const UnicodeSet& uset, bool tabulate) {
+      this->uset = &uset;
+      n = uset.size();
+      tabulated = tabulate;
+      if (!tabulated) return;
+
+      int32_t nranges = uset.getRangeCount();
+      R_len_t ncodepoints = 0;
+      ascii = true;
+      for (int32_t r=0; r<nranges; ++r) {
+         ncodepoints += (R_len_t)(uset.getRangeEnd(r)-uset.getRangeStart(r)+1);
+         if (uset.getRangeEnd(r) >= 0x80) ascii = false;
+      }
+      if (ncodepoints != n) // multi-code point strings, e.g., [{fi}], come last
+         ascii = false;
+
+      bytes.resize(ascii?n:(4*(size_t)n));
+      if (!ascii) lens.assign(n, 0);
+      R_len_t k = 0;
+      for (int32_t r=0; r<nranges; ++r) {
+         for (UChar32 c=uset.getRangeStart(r); c<=uset.getRangeEnd(r); ++c, ++k) {
+            if (ascii)
+               bytes[k] = (char)c;
+            else if (!U_IS_SURROGATE(c)) { // not representable in UTF-8
+               R_len_t j = 0;
+               U8_APPEND_UNSAFE(&bytes[4*(size_t)k], j, c);
+               lens[k] = (uint8_t)j;
+            }
+         }
+      }
+   }
+
+   /** write `length` random code points to buf
+    *  (of size >= 4*length); @return number of bytes written;
+    *  may throw StriException */
+   R_len_t generate(char* buf, R_len_t length, StriRandom& rnd) const {
+      if (length <= 0) return 0;
+      if (n <= 0) throw StriException(MSG__CHARCLASS_EMPTY);
+
+      if (tabulated && ascii) {
+         for (R_len_t k=0; k<length; ++k)
+            buf[k] = bytes[rnd.draw(n)];
+         return length;
+      }
+
+      R_len_t j = 0;
+      for (R_len_t k=0; k<length; ++k) {
+         R_len_t idx = rnd.draw(n);
+         if (tabulated) {
+            if (lens[idx] == 0) throw StriException(MSG__CHARCLASS_NOT_UTF8);
+            memcpy(buf+j, &bytes[4*(size_t)idx], 4); // buf is large enough
+            j += lens[idx];
+         }
+         else {
+            UChar32 c = uset->charAt(idx);
+            if (c < 0 || U_IS_SURROGATE(c)) throw StriException(MSG__CHARCLASS_NOT_UTF8);
+            U8_APPEND_UNSAFE(buf, j, c);
+         }
+      }
+      return j;
+   }
+};
+
+
 /** Generate random permutations of code points in each string
  *
  * @param str character vector
+ * @param rng single string
  * @return character vector
  *
  * @version 0.2-1 (Marek Gagolewski, 2014-04-04)
@@ -50,15 +266,20 @@
  *
  * @version 1.2.5 (Marek Gagolewski, 2019-07-23)
  *    #319: Fixed overflow in `stri_rand_shuffle()`.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ *    rng arg added; shuffle ASCII strings in place
  */
-SEXP stri_rand_shuffle(SEXP str)
+SEXP stri_rand_shuffle(SEXP str, SEXP rng)
 {
+   bool use_philox = stri__rand_get_rng_philox(rng);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    R_len_t n = LENGTH(str);
 
    GetRNGstate();
    STRI__ERROR_HANDLER_BEGIN(1)
    StriContainerUTF8 str_cont(str, n);
+   StriRandom rnd(use_philox);
 
    R_len_t bufsize = 0;
    for (R_len_t i=0; i<n; ++i) {
@@ -79,10 +300,26 @@ SEXP stri_rand_shuffle(SEXP str)
          continue;
       }
 
-      // fill buf1
-      UChar32 c = (UChar32)0;
+      rnd.setStream(i);
       const char* s = str_cont.get(i).c_str();
       R_len_t sn = str_cont.get(i).length();
+      char* buf2data = buf2.data();
+
+      if (str_cont.get(i).isASCII()) {
+         // shuffle the bytes directly, the same permutation as below
+         memcpy(buf2data, s, (size_t)sn);
+         for (R_len_t j=0; j<sn-1; ++j) {
+            R_len_t r = j+rnd.draw(sn-j); // rand from j to sn-1
+            char tmp = buf2data[r];
+            buf2data[r] = buf2data[j];
+            buf2data[j] = tmp;
+         }
+         SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf2data, sn, CE_UTF8));
+         continue;
+      }
+
+      // fill buf1
+      UChar32 c = (UChar32)0;
       R_len_t j = 0;
       R_len_t k = 0;
       while (c >= 0 && j < sn) {
@@ -99,15 +336,13 @@ SEXP stri_rand_shuffle(SEXP str)
       // do shuffle buf1 at pos 0..k-1: (Fisher-Yates shuffle)
       R_len_t cur_n = k;
       for (j=0; j<cur_n-1; ++j) {
-         // rand from i to cur_n-1
-         R_len_t r = (R_len_t)floor(unif_rand()*(double)(cur_n-j)+(double)j);
+         R_len_t r = j+rnd.draw(cur_n-j); // rand from j to cur_n-1
          UChar32 tmp = buf1[r];
          buf1[r] = buf1[j];
          buf1[j] = tmp;
       }
 
       // create string:
-      char* buf2data = buf2.data();
       c = (UChar32)0;
       j = 0;
       k = 0;
@@ -136,6 +371,7 @@ SEXP stri_rand_shuffle(SEXP str)
  * @param n single integer
  * @param length integer vector
  * @param pattern character vector
+ * @param rng single string
  * @return character vector
  *
  * @version 0.2-1 (Marek Gagolewski, 2014-04-04)
@@ -146,10 +382,17 @@ SEXP stri_rand_shuffle(SEXP str)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-16)
+ *    rng arg added; draw from StriRandomCharTable, not UnicodeSet::charAt()
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ *    tabulate a single pattern only; surrogates are reported only when drawn
  */
-SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern)
+SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern, SEXP rng)
 {
    int n_val = stri__prepare_arg_integer_1_notNA(n, "n");
+   bool use_philox = stri__rand_get_rng_philox(rng);
    PROTECT(length    = stri_prepare_arg_integer(length, "length"));
    PROTECT(pattern   = stri_prepare_arg_string(pattern, "pattern"));
 
@@ -176,6 +419,7 @@ SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern)
 
    StriContainerCharClass pattern_cont(pattern, max(n_val, pattern_len));
    StriContainerInteger   length_cont(length, max(n_val, length_len));
+   StriRandom rnd(use_philox);
 
    // get max required bufsize
    int*    length_tab = INTEGER(length);
@@ -188,6 +432,22 @@ SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern)
    String8buf buf(bufsize);
    char* bufdata = buf.data();
 
+   // a lookup table pays off only for a single pattern
+   // from which many code points are to be drawn
+   bool tabulate = false;
+   if (pattern_len == 1 && !pattern_cont.isNA(0)) {
+      double ndraws = 0.0;
+      for (R_len_t i=0; i<n_val; ++i) {
+         if (!length_cont.isNA(i) && length_cont.get(i) > 0)
+            ndraws += length_cont.get(i);
+      }
+      tabulate = (ndraws >= 0.125*pattern_cont.get(0).getUnicodeSet().size());
+   }
+
+   // the most recently used pattern
+   StriRandomCharTable table;
+   R_len_t table_idx = -1;
+
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(STRSXP, n_val));
 
@@ -200,20 +460,13 @@ SEXP stri_rand_strings(SEXP n, SEXP length, SEXP pattern)
       int length_cur = length_cont.get(i);
       if (length_cur < 0) length_cur = 0;
 
-      const UnicodeSet* uset = &(pattern_cont.get(i));
-      int32_t uset_size = uset->size();
-
-      // generate string:
-      R_len_t j = 0;
-      UBool err = FALSE;
-      for (R_len_t k=0; k<length_cur; ++k) {
-         int32_t idx = (int32_t)floor(unif_rand()*(double)uset_size); /* 0..uset_size-1 */
-         UChar32 c = uset->charAt(idx);
-         if (c < 0) throw StriException(MSG__INTERNAL_ERROR);
-
-         U8_APPEND((uint8_t*)bufdata, j, bufsize, c, err);
-         if (err) throw StriException(MSG__INTERNAL_ERROR);
+      if (table_idx != i % pattern_len) {
+         table.set(pattern_cont.get(i).getUnicodeSet(), tabulate);
+         table_idx = i % pattern_len;
       }
+
+      rnd.setStream(i);
+      R_len_t j = table.generate(bufdata, length_cur, rnd);
       SET_STRING_ELT(ret, i, Rf_mkCharLenCE(bufdata, j, CE_UTF8));
    }
 
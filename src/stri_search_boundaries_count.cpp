@@ -70,7 +70,8 @@ SEXP stri_count_boundaries(SEXP str, SEXP opts_brkiter)
          continue;
       }
 
-      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length());
+      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length(),
+         str_cont.get(i).isASCII());
       brkiter.first();
 
       R_len_t cur_count = 0;
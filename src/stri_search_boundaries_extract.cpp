@@ -31,6 +31,7 @@
 
 
 #include "stri_stringi.h"
+#include "stri_tokens_output.h"
 #include "stri_container_utf8_indexable.h"
 #include "stri_container_integer.h"
 #include "stri_brkiter.h"
@@ -65,7 +66,8 @@ SEXP stri__extract_firstlast_boundaries(SEXP str, SEXP opts_brkiter, bool first)
 
       if (str_cont.isNA(i) || str_cont.get(i).length() == 0) continue;
 
-      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length());
+      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length(),
+         str_cont.get(i).isASCII());
       pair<R_len_t,R_len_t> curpair;
 
       if (first) {
@@ -125,30 +127,34 @@ SEXP stri_extract_last_boundaries(SEXP str, SEXP opts_brkiter)
  * @return list or matrix
  *
  * @version 0.5-1 (Marek Gagolewski, 2014-12-19)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ *    use StriTokensOutput (no intermediate list if simplify=TRUE);
+ *    allow simplify="flat"
  */
 SEXP stri_extract_all_boundaries(SEXP str, SEXP simplify, SEXP omit_no_match, SEXP opts_brkiter)
 {
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
-   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, "simplify"));
+   StriTokensOutput::Mode simplify_mode = StriTokensOutput::getMode(simplify);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    StriBrkIterOptions opts_brkiter2(opts_brkiter, "line_break");
 
-   STRI__ERROR_HANDLER_BEGIN(2)
+   STRI__ERROR_HANDLER_BEGIN(1)
       R_len_t str_length = LENGTH(str);
    StriContainerUTF8_indexable str_cont(str, str_length);
    StriRuleBasedBreakIterator brkiter(opts_brkiter2);
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, str_length));
+   StriTokensOutput ret_cont(str_length, simplify_mode);
 
    for (R_len_t i = 0; i < str_length; ++i)
    {
       if (str_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(1));
+         ret_cont.setNA(i);
          continue;
       }
 
-      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length());
+      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length(),
+         str_cont.get(i).isASCII());
       brkiter.first();
 
       deque< pair<R_len_t,R_len_t> > occurrences;
@@ -158,31 +164,21 @@ SEXP stri_extract_all_boundaries(SEXP str, SEXP simplify, SEXP omit_no_match, SE
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
       if (noccurrences <= 0) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(omit_no_match1?0:1));
+         ret_cont.setNA(i, omit_no_match1?0:1);
          continue;
       }
 
       const char* str_cur_s = str_cont.get(i).c_str();
-      SEXP cur_res;
-      STRI__PROTECT(cur_res = Rf_allocVector(STRSXP, noccurrences));
+      ret_cont.set(i);
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
-      for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
+      for (; iter != occurrences.end(); ++iter) {
          pair<R_len_t, R_len_t> curo = *iter;
-         SET_STRING_ELT(cur_res, j,
-                        Rf_mkCharLenCE(str_cur_s+curo.first, curo.second-curo.first, CE_UTF8));
+         ret_cont.add(str_cur_s+curo.first, curo.second-curo.first);
       }
-      SET_VECTOR_ELT(ret, i, cur_res);
-      STRI__UNPROTECT(1);
    }
 
-   if (LOGICAL(simplify)[0] == NA_LOGICAL) {
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-                                           stri__vector_NA_strings(1), Rf_ScalarInteger(0)))
-   }
-   else if (LOGICAL(simplify)[0]) {
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-                                           stri__vector_empty_strings(1), Rf_ScalarInteger(0)))
-   }
+   SEXP ret;
+   STRI__PROTECT(ret = ret_cont.toR());
 
    STRI__UNPROTECT_ALL
       return ret;
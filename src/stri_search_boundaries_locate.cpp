@@ -34,6 +34,7 @@
 #include "stri_container_utf8_indexable.h"
 #include "stri_container_integer.h"
 #include "stri_brkiter.h"
+#include "stri_locate_flat.h"
 
 
 /**
@@ -41,13 +42,18 @@
  *
  * @param str character vector
  * @param opts_brkiter list
+ * @param units single string; "chars" or "bytes"
  * @param first looking for first or last match?
  * @return integer matrix (2 columns)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-05)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri__locate_firstlast_boundaries(SEXP str, SEXP opts_brkiter, bool first)
+SEXP stri__locate_firstlast_boundaries(SEXP str, SEXP opts_brkiter, SEXP units, bool first)
 {
+   bool units_bytes = stri__locate_get_units_bytes(units);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    StriBrkIterOptions opts_brkiter2(opts_brkiter, "line_break");
 
@@ -68,7 +74,8 @@ SEXP stri__locate_firstlast_boundaries(SEXP str, SEXP opts_brkiter, bool first)
 
       if (str_cont.isNA(i) || str_cont.get(i).length() == 0) continue;
 
-      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length());
+      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length(),
+         str_cont.get(i).isASCII());
       pair<R_len_t,R_len_t> curpair;
 
       if (first) {
@@ -83,12 +90,14 @@ SEXP stri__locate_firstlast_boundaries(SEXP str, SEXP opts_brkiter, bool first)
       ret_tab[i]            = curpair.first;
       ret_tab[i+str_length] = curpair.second;
 
-      // Adjust UTF8 byte index -> UChar32 index
-      str_cont.UTF8_to_UChar32_index(i,
-            ret_tab+i, ret_tab+i+str_length, 1,
-            1, // 0-based index -> 1-based
-            0  // end returns position of next character after match
-      );
+      if (units_bytes) // 0-based index -> 1-based
+         ret_tab[i]++;
+      else // Adjust UTF8 byte index -> UChar32 index
+         str_cont.UTF8_to_UChar32_index(i,
+               ret_tab+i, ret_tab+i+str_length, 1,
+               1, // 0-based index -> 1-based
+               0  // end returns position of next character after match
+         );
    }
 
    STRI__UNPROTECT_ALL
@@ -102,13 +111,17 @@ SEXP stri__locate_firstlast_boundaries(SEXP str, SEXP opts_brkiter, bool first)
  *
  * @param str character vector
  * @param opts_brkiter list
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-05)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_first_boundaries(SEXP str, SEXP opts_brkiter)
+SEXP stri_locate_first_boundaries(SEXP str, SEXP opts_brkiter, SEXP units)
 {
-   return stri__locate_firstlast_boundaries(str, opts_brkiter, true);
+   return stri__locate_firstlast_boundaries(str, opts_brkiter, units, true);
 }
 
 
@@ -117,13 +130,17 @@ SEXP stri_locate_first_boundaries(SEXP str, SEXP opts_brkiter)
  *
  * @param str character vector
  * @param opts_brkiter list
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-05)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter)
+SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter, SEXP units)
 {
-   return stri__locate_firstlast_boundaries(str, opts_brkiter, false);
+   return stri__locate_firstlast_boundaries(str, opts_brkiter, units, false);
 }
 
 
@@ -132,7 +149,10 @@ SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter)
  * @param str character vector
  * @param omit_no_match logical
  * @param opts_brkiter named list
- * @return list
+ * @param units single string; "chars" or "bytes"
+ * @param output single string; "list" or "flat"
+ * @return list of integer matrices (2 columns) or, for output="flat",
+ *    a list of 3 integer vectors (id, start, end)
  *
  * @version 0.2-2 (Marek Gagolewski, 2014-04-22)
  *
@@ -151,10 +171,16 @@ SEXP stri_locate_last_boundaries(SEXP str, SEXP opts_brkiter)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-02)
  *          use StriRuleBasedBreakIterator
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units and output args added
  */
-SEXP stri_locate_all_boundaries(SEXP str, SEXP omit_no_match, SEXP opts_brkiter)
+SEXP stri_locate_all_boundaries(SEXP str, SEXP omit_no_match, SEXP opts_brkiter,
+   SEXP units, SEXP output)
 {
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
+   bool units_bytes = stri__locate_get_units_bytes(units);
+   bool output_flat = stri__locate_get_output_flat(output);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    StriBrkIterOptions opts_brkiter2(opts_brkiter, "line_break");
 
@@ -164,16 +190,19 @@ SEXP stri_locate_all_boundaries(SEXP str, SEXP omit_no_match, SEXP opts_brkiter)
    StriRuleBasedBreakIterator brkiter(opts_brkiter2);
 
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, str_length));
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, output_flat?0:str_length));
+   StriLocateFlat flat;
 
    for (R_len_t i = 0; i < str_length; ++i)
    {
       if (str_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));
+         if (output_flat) flat.pushNA(i);
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));
          continue;
       }
 
-      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length());
+      brkiter.setupMatcher(str_cont.get(i).c_str(), str_cont.get(i).length(),
+         str_cont.get(i).isASCII());
       brkiter.first();
 
       deque< pair<R_len_t,R_len_t> > occurrences;
@@ -183,28 +212,50 @@ SEXP stri_locate_all_boundaries(SEXP str, SEXP omit_no_match, SEXP opts_brkiter)
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
       if (noccurrences <= 0) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
          continue;
       }
 
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
-      int* ans_tab = INTEGER(ans);
+      SEXP ans = R_NilValue;
+      int* ans_start;
+      int* ans_end;
+      if (output_flat) {
+         R_len_t k = flat.append(i, noccurrences);
+         ans_start = flat.getStart(k);
+         ans_end   = flat.getEnd(k);
+      }
+      else {
+         STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
+         ans_start = INTEGER(ans);
+         ans_end   = ans_start+noccurrences;
+      }
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
       for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
          pair<R_len_t, R_len_t> cur_match = *iter;
-         ans_tab[j]             = cur_match.first;
-         ans_tab[j+noccurrences] = cur_match.second;
+         ans_start[j] = cur_match.first;
+         ans_end[j]   = cur_match.second;
+      }
+
+      if (units_bytes) { // 0-based index -> 1-based
+         for (R_len_t j = 0; j < noccurrences; ++j)
+            ans_start[j]++;
       }
+      else // Adjust UTF8 byte index -> UChar32 index
+         str_cont.UTF8_to_UChar32_index(i, ans_start, ans_end, noccurrences,
+               1, // 0-based index -> 1-based
+               0  // end returns position of next character after match
+         );
+
+      if (!output_flat) {
+         SET_VECTOR_ELT(ret, i, ans);
+         STRI__UNPROTECT(1);
+      }
+   }
 
-      // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-      str_cont.UTF8_to_UChar32_index(i, ans_tab,
-            ans_tab+noccurrences, noccurrences,
-            1, // 0-based index -> 1-based
-            0  // end returns position of next character after match
-      );
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1);
+   if (output_flat) {
+      STRI__UNPROTECT_ALL
+      return flat.toR();
    }
 
    stri__locate_set_dimnames_list(ret);
@@ -31,6 +31,7 @@
 
 
 #include "stri_stringi.h"
+#include "stri_tokens_output.h"
 #include "stri_container_utf8_indexable.h"
 #include "stri_container_integer.h"
 #include "stri_brkiter.h"
@@ -65,35 +66,38 @@
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-04)
  *    allow `simplify=NA`; FR #126: pass n to stri_list2matrix
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ *    use StriTokensOutput (no intermediate list if simplify=TRUE);
+ *    allow simplify="flat"
  */
 SEXP stri_split_boundaries(SEXP str, SEXP n, SEXP tokens_only, SEXP simplify, SEXP opts_brkiter)
 {
    bool tokens_only1 = stri__prepare_arg_logical_1_notNA(tokens_only, "tokens_only");
-   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, "simplify"));
+   StriTokensOutput::Mode simplify_mode = StriTokensOutput::getMode(simplify);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(n = stri_prepare_arg_integer(n, "n"));
    StriBrkIterOptions opts_brkiter2(opts_brkiter, "line_break");
 
-   STRI__ERROR_HANDLER_BEGIN(3)
+   STRI__ERROR_HANDLER_BEGIN(2)
    R_len_t vectorize_length = stri__recycling_rule(true, 2,
       LENGTH(str), LENGTH(n));
    StriContainerUTF8_indexable str_cont(str, vectorize_length);
    StriContainerInteger n_cont(n, vectorize_length);
    StriRuleBasedBreakIterator brkiter(opts_brkiter2);
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   StriTokensOutput ret_cont(vectorize_length, simplify_mode);
 
    for (R_len_t i = 0; i < vectorize_length; ++i)
    {
       if (n_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(1));
+         ret_cont.setNA(i);
          continue;
       }
       int  n_cur = n_cont.get(i);
 
       if (str_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(1));
+         ret_cont.setNA(i);
          continue;
       }
 
@@ -102,14 +106,14 @@ SEXP stri_split_boundaries(SEXP str, SEXP n, SEXP tokens_only, SEXP simplify, SE
       else if (n_cur < 0)
          n_cur = INT_MAX;
       else if (n_cur == 0) {
-         SET_VECTOR_ELT(ret, i, Rf_allocVector(STRSXP, 0));
+         ret_cont.set(i);
          continue;
       }
 
       R_len_t str_cur_n = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
       deque< pair<R_len_t,R_len_t> > occurrences;
-      brkiter.setupMatcher(str_cur_s, str_cur_n);
+      brkiter.setupMatcher(str_cur_s, str_cur_n, str_cont.get(i).isASCII());
       brkiter.first();
 
       pair<R_len_t,R_len_t> curpair;
@@ -122,37 +126,30 @@ SEXP stri_split_boundaries(SEXP str, SEXP n, SEXP tokens_only, SEXP simplify, SE
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
       if (noccurrences <= 0) {
-         SET_VECTOR_ELT(ret, i, stri__vector_empty_strings(0)); // @TODO: Should it be a NA? Hard to say...
+         ret_cont.set(i); // @TODO: Should it be a NA? Hard to say...
          continue;
       }
       if (k == n_cur && !tokens_only1)
          occurrences.back().second = str_cur_n;
 
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocVector(STRSXP, noccurrences));
+      ret_cont.set(i);
       deque< pair<R_len_t,R_len_t> >::iterator iter = occurrences.begin();
-      for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
-         SET_STRING_ELT(ans, j, Rf_mkCharLenCE(str_cur_s+(*iter).first,
-            (*iter).second-(*iter).first, CE_UTF8));
+      for (; iter != occurrences.end(); ++iter) {
+         ret_cont.add(str_cur_s+(*iter).first, (*iter).second-(*iter).first);
       }
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1);
    }
 
-   if (LOGICAL(simplify)[0] == NA_LOGICAL || LOGICAL(simplify)[0]) {
-      R_len_t n_min = 0;
-      R_len_t n_length = LENGTH(n);
-      int* n_tab = INTEGER(n);
-      for (R_len_t i=0; i<n_length; ++i) {
-         if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
-            n_min = n_tab[i];
-      }
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-         (LOGICAL(simplify)[0] == NA_LOGICAL)?stri__vector_NA_strings(1)
-                                             :stri__vector_empty_strings(1),
-         Rf_ScalarInteger(n_min)))
+   R_len_t n_min = 0; // FR #126: min. number of matrix columns
+   R_len_t n_length = LENGTH(n);
+   int* n_tab = INTEGER(n);
+   for (R_len_t i=0; i<n_length; ++i) {
+      if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
+         n_min = n_tab[i];
    }
 
+   SEXP ret;
+   STRI__PROTECT(ret = ret_cont.toR(n_min));
+
    STRI__UNPROTECT_ALL
    return ret;
    STRI__ERROR_HANDLER_END({ /* no action */ })
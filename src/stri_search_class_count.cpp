@@ -58,9 +58,15 @@
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-02)
+ *    count ASCII code points with the class' bitmap
  */
 SEXP stri_count_charclass(SEXP str, SEXP pattern)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1,
+      stri_count_charclass(str, pattern))
+
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
    R_len_t vectorize_length =
@@ -83,13 +89,20 @@ SEXP stri_count_charclass(SEXP str, SEXP pattern)
          continue;
       }
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       R_len_t     str_cur_n = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
 
       UChar32 chr   = 0;
       R_len_t count = 0;
       for (R_len_t j=0; j<str_cur_n; ) {
+         if ((uint8_t)str_cur_s[j] < 0x80) { // ASCII run, branch-free
+            uint32_t count_ascii = 0;
+            for (; j<str_cur_n && (uint8_t)str_cur_s[j] < 0x80; ++j)
+               count_ascii += pattern_cur->containsASCII((uint8_t)str_cur_s[j]);
+            count += (R_len_t)count_ascii;
+            continue;
+         }
          U8_NEXT(str_cur_s, j, str_cur_n, chr);
          if (chr < 0) // invalid utf-8 sequence
             throw StriException(MSG__INVALID_UTF8);
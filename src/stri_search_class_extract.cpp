@@ -30,6 +30,7 @@
  */
 
 #include "stri_stringi.h"
+#include "stri_tokens_output.h"
 #include "stri_container_utf8.h"
 #include "stri_container_charclass.h"
 #include "stri_container_logical.h"
@@ -84,7 +85,7 @@ SEXP stri__extract_firstlast_charclass(SEXP str, SEXP pattern, bool first)
       if (str_cont.isNA(i) || pattern_cont.isNA(i))
          continue;
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       R_len_t     str_cur_n = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
       R_len_t j, jlast;
@@ -192,30 +193,33 @@ SEXP stri_extract_last_charclass(SEXP str, SEXP pattern)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-04)
  *    allow `simplify=NA`
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ *    use StriTokensOutput (no intermediate list if simplify=TRUE);
+ *    allow simplify="flat"
  */
 SEXP stri_extract_all_charclass(SEXP str, SEXP pattern, SEXP merge, SEXP simplify, SEXP omit_no_match)
 {
    bool merge_cur = stri__prepare_arg_logical_1_notNA(merge, "merge");
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
-   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, "simplify"));
+   StriTokensOutput::Mode simplify_mode = StriTokensOutput::getMode(simplify);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
    R_len_t vectorize_length = stri__recycling_rule(true, 2,
       LENGTH(str), LENGTH(pattern));
 
-   STRI__ERROR_HANDLER_BEGIN(3)
+   STRI__ERROR_HANDLER_BEGIN(2)
    StriContainerUTF8 str_cont(str, vectorize_length);
    StriContainerCharClass pattern_cont(pattern, vectorize_length);
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   StriTokensOutput ret_cont(vectorize_length, simplify_mode);
 
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
    {
       if (pattern_cont.isNA(i) || str_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(1));
+         ret_cont.setNA(i);
          continue;
       }
 
@@ -230,30 +234,20 @@ SEXP stri_extract_all_charclass(SEXP str, SEXP pattern, SEXP merge, SEXP simplif
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
       if (noccurrences == 0) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(omit_no_match1?0:1));
+         ret_cont.setNA(i, omit_no_match1?0:1);
          continue;
       }
 
-      SEXP cur_res;
-      STRI__PROTECT(cur_res = Rf_allocVector(STRSXP, noccurrences));
+      ret_cont.set(i);
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
-      for (R_len_t f = 0; iter != occurrences.end(); ++iter, ++f) {
+      for (; iter != occurrences.end(); ++iter) {
          pair<R_len_t, R_len_t> curo = *iter;
-         SET_STRING_ELT(cur_res, f,
-            Rf_mkCharLenCE(str_cur_s+curo.first, curo.second-curo.first, CE_UTF8));
+         ret_cont.add(str_cur_s+curo.first, curo.second-curo.first);
       }
-      SET_VECTOR_ELT(ret, i, cur_res);
-      STRI__UNPROTECT(1)
    }
 
-   if (LOGICAL(simplify)[0] == NA_LOGICAL) {
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-         stri__vector_NA_strings(1), Rf_ScalarInteger(0)))
-   }
-   else if (LOGICAL(simplify)[0]) {
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-         stri__vector_empty_strings(1), Rf_ScalarInteger(0)))
-   }
+   SEXP ret;
+   STRI__PROTECT(ret = ret_cont.toR());
 
    STRI__UNPROTECT_ALL
    return ret;
@@ -34,6 +34,7 @@
 #include "stri_container_utf8.h"
 #include "stri_container_charclass.h"
 #include "stri_container_logical.h"
+#include "stri_locate_flat.h"
 #include <deque>
 #include <utility>
 using namespace std;
@@ -44,6 +45,8 @@ using namespace std;
  *
  * @param str character vector
  * @param pattern character vector
+ * @param units single string; "chars" or "bytes"
+ * @param first looking for first or last match?
  * @return matrix with 2 columns
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-04)
@@ -62,9 +65,13 @@ using namespace std;
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri__locate_firstlast_charclass(SEXP str, SEXP pattern, bool first)
+SEXP stri__locate_firstlast_charclass(SEXP str, SEXP pattern, SEXP units, bool first)
 {
+   bool units_bytes = stri__locate_get_units_bytes(units);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
    R_len_t vectorize_length =
@@ -89,25 +96,30 @@ SEXP stri__locate_firstlast_charclass(SEXP str, SEXP pattern, bool first)
       if (str_cont.isNA(i) || pattern_cont.isNA(i))
          continue;
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       R_len_t     str_cur_n = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
-      R_len_t j;
+      R_len_t j, jlast;
       R_len_t k = 0;
       UChar32 chr;
 
       for (j=0; j<str_cur_n; ) {
+         jlast = j;
          U8_NEXT(str_cur_s, j, str_cur_n, chr);
          if (chr < 0) // invalid utf-8 sequence
             throw StriException(MSG__INVALID_UTF8);
          k++; // 1-based index
          if (pattern_cur->contains(chr)) {
-            ret_tab[i]      = k;
+            if (units_bytes) {
+               ret_tab[i]                  = jlast+1; // 1-based index
+               ret_tab[i+vectorize_length] = j;
+            }
+            else
+               ret_tab[i] = ret_tab[i+vectorize_length] = k;
             if (first) break; // that's enough for first
             // note that for last, we can't go backwards from the end, as we need a proper index!
          }
       }
-      ret_tab[i+vectorize_length] = ret_tab[i];
    }
 
    STRI__UNPROTECT_ALL
@@ -121,13 +133,17 @@ SEXP stri__locate_firstlast_charclass(SEXP str, SEXP pattern, bool first)
  *
  * @param str character vector
  * @param pattern character vector
+ * @param units single string; "chars" or "bytes"
  * @return matrix with 2 columns
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-04)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_first_charclass(SEXP str, SEXP pattern)
+SEXP stri_locate_first_charclass(SEXP str, SEXP pattern, SEXP units)
 {
-   return stri__locate_firstlast_charclass(str, pattern, true);
+   return stri__locate_firstlast_charclass(str, pattern, units, true);
 }
 
 
@@ -136,22 +152,31 @@ SEXP stri_locate_first_charclass(SEXP str, SEXP pattern)
  *
  * @param str character vector
  * @param pattern character vector
+ * @param units single string; "chars" or "bytes"
  * @return matrix with 2 columns
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-04)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_last_charclass(SEXP str, SEXP pattern)
+SEXP stri_locate_last_charclass(SEXP str, SEXP pattern, SEXP units)
 {
-   return stri__locate_firstlast_charclass(str, pattern, false);
+   return stri__locate_firstlast_charclass(str, pattern, units, false);
 }
 
 
 /**
- * Locate first or last occurrences of a character class in each string
+ * Locate all occurrences of a character class in each string
  *
  * @param str character vector
  * @param pattern character vector
- * @return list of matrices with 2 columns
+ * @param merge single logical value
+ * @param omit_no_match single logical value
+ * @param units single string; "chars" or "bytes"
+ * @param output single string; "list" or "flat"
+ * @return list of matrices with 2 columns or, for output="flat",
+ *    a list of 3 integer vectors (id, start, end)
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-04)
  *
@@ -180,10 +205,16 @@ SEXP stri_locate_last_charclass(SEXP str, SEXP pattern)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-11-27)
  *    FR #117: omit_no_match arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units and output args added
  */
-SEXP stri_locate_all_charclass(SEXP str, SEXP pattern, SEXP merge, SEXP omit_no_match)
+SEXP stri_locate_all_charclass(SEXP str, SEXP pattern, SEXP merge, SEXP omit_no_match,
+   SEXP units, SEXP output)
 {
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
+   bool units_bytes = stri__locate_get_units_bytes(units);
+   bool output_flat = stri__locate_get_output_flat(output);
       bool merge_cur = stri__prepare_arg_logical_1_notNA(merge, "merge");
    PROTECT(str     = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
@@ -195,41 +226,63 @@ SEXP stri_locate_all_charclass(SEXP str, SEXP pattern, SEXP merge, SEXP omit_no_
    StriContainerCharClass pattern_cont(pattern, vectorize_length);
 
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, output_flat?0:vectorize_length));
+   StriLocateFlat flat;
 
+   deque< pair<R_len_t, R_len_t> > occurrences;
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
    {
       if (pattern_cont.isNA(i) || str_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));
+         if (output_flat) flat.pushNA(i);
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));
          continue;
       }
 
-      deque< pair<R_len_t, R_len_t> > occurrences;
+      occurrences.clear();
       StriContainerCharClass::locateAll(
          occurrences, &pattern_cont.get(i),
          str_cont.get(i).c_str(), str_cont.get(i).length(), merge_cur,
-         true /* code point-based indices */
+         !units_bytes /* code point- or byte-based indices */
       );
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
       if (noccurrences == 0) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
          continue;
       }
 
-      SEXP cur_res;
-      STRI__PROTECT(cur_res = Rf_allocMatrix(INTSXP, noccurrences, 2));
-      int* cur_res_int = INTEGER(cur_res);
+      SEXP cur_res = R_NilValue;
+      int* cur_res_start;
+      int* cur_res_end;
+      if (output_flat) {
+         R_len_t k = flat.append(i, noccurrences);
+         cur_res_start = flat.getStart(k);
+         cur_res_end   = flat.getEnd(k);
+      }
+      else {
+         STRI__PROTECT(cur_res = Rf_allocMatrix(INTSXP, noccurrences, 2));
+         cur_res_start = INTEGER(cur_res);
+         cur_res_end   = cur_res_start+noccurrences;
+      }
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
       for (R_len_t f = 0; iter != occurrences.end(); ++iter, ++f) {
          pair<R_len_t, R_len_t> curoccur = *iter;
-         cur_res_int[f] = curoccur.first+1; // 0-based => 1-based
-         cur_res_int[f+noccurrences] = curoccur.second;
+         cur_res_start[f] = curoccur.first+1; // 0-based => 1-based
+         cur_res_end[f]   = curoccur.second;
+      }
+
+      if (!output_flat) {
+         SET_VECTOR_ELT(ret, i, cur_res);
+         STRI__UNPROTECT(1)
       }
-      SET_VECTOR_ELT(ret, i, cur_res);
-      STRI__UNPROTECT(1)
+   }
+
+   if (output_flat) {
+      STRI__UNPROTECT_ALL
+      return flat.toR();
    }
 
    stri__locate_set_dimnames_list(ret);
@@ -259,6 +259,9 @@ SEXP stri__replace_all_charclass_no_vectorize_all(SEXP str, SEXP pattern, SEXP r
  */
 SEXP stri_replace_all_charclass(SEXP str, SEXP pattern, SEXP replacement, SEXP merge, SEXP vectorize_all)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_all_charclass(str, pattern, replacement, merge, vectorize_all))
+
    if (stri__prepare_arg_logical_1_notNA(vectorize_all, "vectorize_all"))
       return stri__replace_all_charclass_yes_vectorize_all(str, pattern, replacement, merge);
    else
@@ -320,7 +323,7 @@ SEXP stri__replace_firstlast_charclass(SEXP str, SEXP pattern, SEXP replacement,
          continue;
       }
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       R_len_t str_cur_n     = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
       R_len_t j, jlast;
@@ -390,6 +393,9 @@ SEXP stri__replace_firstlast_charclass(SEXP str, SEXP pattern, SEXP replacement,
  */
 SEXP stri_replace_first_charclass(SEXP str, SEXP pattern, SEXP replacement)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_first_charclass(str, pattern, replacement))
+
    return stri__replace_firstlast_charclass(str, pattern, replacement, true);
 }
 
@@ -407,5 +413,8 @@ SEXP stri_replace_first_charclass(SEXP str, SEXP pattern, SEXP replacement)
  */
 SEXP stri_replace_last_charclass(SEXP str, SEXP pattern, SEXP replacement)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_last_charclass(str, pattern, replacement))
+
    return stri__replace_firstlast_charclass(str, pattern, replacement, false);
 }
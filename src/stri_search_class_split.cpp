@@ -31,6 +31,7 @@
 
 
 #include "stri_stringi.h"
+#include "stri_tokens_output.h"
 #include "stri_container_utf8.h"
 #include "stri_container_charclass.h"
 #include "stri_container_integer.h"
@@ -81,6 +82,10 @@ using namespace std;
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-04)
  *    allow `simplify=NA`; FR #126: pass n to stri_list2matrix
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ *    use StriTokensOutput (no intermediate list if simplify=TRUE);
+ *    allow simplify="flat"
  */
 SEXP stri_split_charclass(SEXP str, SEXP pattern, SEXP n,
                           SEXP omit_empty, SEXP tokens_only, SEXP simplify)
@@ -90,29 +95,28 @@ SEXP stri_split_charclass(SEXP str, SEXP pattern, SEXP n,
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
    PROTECT(n = stri_prepare_arg_integer(n, "n"));
    PROTECT(omit_empty = stri_prepare_arg_logical(omit_empty, "omit_empty"));
-   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, "simplify"));
+   StriTokensOutput::Mode simplify_mode = StriTokensOutput::getMode(simplify);
    R_len_t vectorize_length = stri__recycling_rule(true, 4,
       LENGTH(str), LENGTH(pattern), LENGTH(n), LENGTH(omit_empty));
 
-   STRI__ERROR_HANDLER_BEGIN(5)
+   STRI__ERROR_HANDLER_BEGIN(4)
    StriContainerUTF8      str_cont(str, vectorize_length);
    StriContainerInteger   n_cont(n, vectorize_length);
    StriContainerLogical   omit_empty_cont(omit_empty, vectorize_length);
    StriContainerCharClass pattern_cont(pattern, vectorize_length);
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   StriTokensOutput ret_cont(vectorize_length, simplify_mode);
 
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
    {
       if (str_cont.isNA(i) || pattern_cont.isNA(i) || n_cont.isNA(i)) {
-         SET_VECTOR_ELT(ret, i, stri__vector_NA_strings(1));
+         ret_cont.setNA(i);
          continue;
       }
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       int  n_cur            = n_cont.get(i);
       int  omit_empty_cur   = !omit_empty_cont.isNA(i) && omit_empty_cont.get(i);
 
@@ -121,7 +125,7 @@ SEXP stri_split_charclass(SEXP str, SEXP pattern, SEXP n,
       else if (n_cur < 0)
          n_cur = INT_MAX;
       else if (n_cur == 0) {
-         SET_VECTOR_ELT(ret, i, Rf_allocVector(STRSXP, 0));
+         ret_cont.set(i);
          continue;
       }
       else if (tokens_only1)
@@ -161,38 +165,29 @@ SEXP stri_split_charclass(SEXP str, SEXP pattern, SEXP n,
             fields.pop_back(); // get rid of the remainder
       }
 
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocVector(STRSXP, fields.size()));
-
+      ret_cont.set(i);
       deque< pair<R_len_t, R_len_t> >::iterator iter = fields.begin();
-      for (k = 0; iter != fields.end(); ++iter, ++k) {
+      for (; iter != fields.end(); ++iter) {
          pair<R_len_t, R_len_t> curoccur = *iter;
          if (curoccur.second == curoccur.first && omit_empty_cont.isNA(i))
-            SET_STRING_ELT(ans, k, NA_STRING);
+            ret_cont.addNA();
          else
-            SET_STRING_ELT(ans, k,
-               Rf_mkCharLenCE(str_cur_s+curoccur.first,
-                           curoccur.second-curoccur.first, CE_UTF8));
+            ret_cont.add(str_cur_s+curoccur.first,
+               curoccur.second-curoccur.first);
       }
-
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1)
    }
 
-   if (LOGICAL(simplify)[0] == NA_LOGICAL || LOGICAL(simplify)[0]) {
-      R_len_t n_min = 0;
-      R_len_t n_length = LENGTH(n);
-      int* n_tab = INTEGER(n);
-      for (R_len_t i=0; i<n_length; ++i) {
-         if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
-            n_min = n_tab[i];
-      }
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-         (LOGICAL(simplify)[0] == NA_LOGICAL)?stri__vector_NA_strings(1)
-                                             :stri__vector_empty_strings(1),
-         Rf_ScalarInteger(n_min)))
+   R_len_t n_min = 0; // FR #126: min. number of matrix columns
+   R_len_t n_length = LENGTH(n);
+   int* n_tab = INTEGER(n);
+   for (R_len_t i=0; i<n_length; ++i) {
+      if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
+         n_min = n_tab[i];
    }
 
+   SEXP ret;
+   STRI__PROTECT(ret = ret_cont.toR(n_min));
+
    STRI__UNPROTECT_ALL
    return ret;
    STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
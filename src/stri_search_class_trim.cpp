@@ -60,6 +60,9 @@
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-02)
+ *    use StriCharClass::span() and spanBack()
 */
 SEXP stri__trim_leftright(SEXP str, SEXP pattern, bool left, bool right)
 {
@@ -84,37 +87,17 @@ SEXP stri__trim_leftright(SEXP str, SEXP pattern, bool left, bool right)
          continue;
       }
 
-      const UnicodeSet* pattern_cur = &pattern_cont.get(i);
+      const StriCharClass* pattern_cur = &pattern_cont.get(i);
       R_len_t     str_cur_n = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
       R_len_t jlast1 = 0;
       R_len_t jlast2 = str_cur_n;
 
-      if (left) {
-         UChar32 chr;
-         for (R_len_t j=0; j<str_cur_n; ) {
-            U8_NEXT(str_cur_s, j, str_cur_n, chr); // "look ahead"
-            if (chr < 0) // invalid utf-8 sequence
-               throw StriException(MSG__INVALID_UTF8);
-            if (pattern_cur->contains(chr)) {
-               break; // break at first occurrence
-            }
-            jlast1 = j;
-         }
-      }
+      if (left) // skip until the first occurrence
+         jlast1 = pattern_cur->span(str_cur_s, str_cur_n, false);
 
-      if (right && jlast1 < str_cur_n) {
-         UChar32 chr;
-         for (R_len_t j=str_cur_n; j>0; ) {
-            U8_PREV(str_cur_s, 0, j, chr); // "look behind"
-            if (chr < 0) // invalid utf-8 sequence
-               throw StriException(MSG__INVALID_UTF8);
-            if (pattern_cur->contains(chr)) {
-               break; // break at first occurrence
-            }
-            jlast2 = j;
-         }
-      }
+      if (right && jlast1 < str_cur_n) // skip back until the last occurrence
+         jlast2 = pattern_cur->spanBack(str_cur_s, str_cur_n, false);
 
       // now jlast is the index, from which we start copying
       SET_STRING_ELT(ret, i,
@@ -61,6 +61,9 @@
  */
 SEXP stri_count_coll(SEXP str, SEXP pattern, SEXP opts_collator)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1,
+      stri_count_coll(str, pattern, opts_collator))
+
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
 
@@ -64,6 +64,9 @@
  */
 SEXP stri_detect_coll(SEXP str, SEXP pattern, SEXP negate, SEXP opts_collator)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1,
+      stri_detect_coll(str, pattern, negate, opts_collator))
+
    bool negate_1 = stri__prepare_arg_logical_1_notNA(negate, "negate");
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
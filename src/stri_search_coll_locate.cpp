@@ -33,6 +33,7 @@
 #include "stri_stringi.h"
 #include "stri_container_utf16.h"
 #include "stri_container_usearch.h"
+#include "stri_locate_flat.h"
 #include <deque>
 #include <utility>
 using namespace std;
@@ -45,6 +46,7 @@ using namespace std;
  * @param pattern character vector
  * @param opts_collator passed to stri__ucol_open(),
  * if \code{NA}, then \code{stri__locate_firstlast_fixed_byte} is called
+ * @param units single string; "chars" or "bytes"
  * @param first looking for first or last match?
  * @return integer matrix (2 columns)
  *
@@ -61,9 +63,13 @@ using namespace std;
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri__locate_firstlast_coll(SEXP str, SEXP pattern, SEXP opts_collator, bool first)
+SEXP stri__locate_firstlast_coll(SEXP str, SEXP pattern, SEXP opts_collator, SEXP units, bool first)
 {
+   bool units_bytes = stri__locate_get_units_bytes(units);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
 
@@ -106,12 +112,18 @@ SEXP stri__locate_firstlast_coll(SEXP str, SEXP pattern, SEXP opts_collator, boo
          ret_tab[i]                  = start;
          ret_tab[i+vectorize_length] = start + usearch_getMatchedLength(matcher);
 
-         // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-         str_cont.UChar16_to_UChar32_index(i,
-               ret_tab+i, ret_tab+i+vectorize_length, 1,
-               1, // 0-based index -> 1-based
-               0  // end returns position of next character after match
-         );
+         if (units_bytes) // Adjust UChar index -> UTF-8 byte index
+            str_cont.UChar16_to_UTF8_index(i,
+                  ret_tab+i, ret_tab+i+vectorize_length, 1,
+                  1, // 0-based index -> 1-based
+                  0  // end returns position of next byte after match
+            );
+         else // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
+            str_cont.UChar16_to_UChar32_index(i,
+                  ret_tab+i, ret_tab+i+vectorize_length, 1,
+                  1, // 0-based index -> 1-based
+                  0  // end returns position of next character after match
+            );
       }
    }
 
@@ -130,6 +142,7 @@ SEXP stri__locate_firstlast_coll(SEXP str, SEXP pattern, SEXP opts_collator, boo
  * @param str character vector
  * @param pattern character vector
  * @param opts_collator list
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.1-?? (Bartlomiej Tartanus)
@@ -142,10 +155,13 @@ SEXP stri__locate_firstlast_coll(SEXP str, SEXP pattern, SEXP opts_collator, boo
  *
  * @version 0.2-3 (Marek Gagolewski, 2014-05-08)
  *          new fun: stri_locate_first_coll (opts_collator == NA not allowed)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator)
+SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator, SEXP units)
 {
-   return stri__locate_firstlast_coll(str, pattern, opts_collator, true);
+   return stri__locate_firstlast_coll(str, pattern, opts_collator, units, true);
 }
 
 
@@ -155,6 +171,7 @@ SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator)
  * @param str character vector
  * @param pattern character vector
  * @param opts_collator list
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.1-?? (Bartlomiej Tartanus)
@@ -167,10 +184,13 @@ SEXP stri_locate_first_coll(SEXP str, SEXP pattern, SEXP opts_collator)
  *
  * @version 0.2-3 (Marek Gagolewski, 2014-05-08)
  *          new fun: stri_locate_last_coll (opts_collator == NA not allowed)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator)
+SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator, SEXP units)
 {
-   return stri__locate_firstlast_coll(str, pattern, opts_collator, false);
+   return stri__locate_firstlast_coll(str, pattern, opts_collator, units, false);
 }
 
 
@@ -181,7 +201,11 @@ SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator)
  * @param pattern character vector
  * @param opts_collator passed to stri__ucol_open(),
  * if \code{NA}, then \code{stri__locate_all_fixed_byte} is called
- * @return list of integer matrices (2 columns)
+ * @param omit_no_match single logical value
+ * @param units single string; "chars" or "bytes"
+ * @param output single string; "list" or "flat"
+ * @return list of integer matrices (2 columns) or, for output="flat",
+ *    a list of 3 integer vectors (id, start, end)
  *
  * @version 0.1-?? (Bartlomiej Tartanus)
  *
@@ -200,10 +224,16 @@ SEXP stri_locate_last_coll(SEXP str, SEXP pattern, SEXP opts_collator)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-11-27)
  *    FR #117: omit_no_match arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units and output args added
  */
-SEXP stri_locate_all_coll(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_collator)
+SEXP stri_locate_all_coll(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_collator,
+   SEXP units, SEXP output)
 {
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
+   bool units_bytes = stri__locate_get_units_bytes(units);
+   bool output_flat = stri__locate_get_output_flat(output);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
 
@@ -216,15 +246,18 @@ SEXP stri_locate_all_coll(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_
    StriContainerUStringSearch pattern_cont(pattern, vectorize_length, collator);  // collator is not owned by pattern_cont
 
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, output_flat?0:vectorize_length));
+   StriLocateFlat flat;
 
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
    {
       STRI__CONTINUE_ON_EMPTY_OR_NA_STR_PATTERN(str_cont, pattern_cont,
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));,
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));)
+         if (output_flat) flat.pushNA(i);
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));,
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));)
 
       UStringSearch *matcher = pattern_cont.getMatcher(i, str_cont.get(i));
       usearch_reset(matcher);
@@ -234,7 +267,8 @@ SEXP stri_locate_all_coll(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_
       STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
       if (start == USEARCH_DONE) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
          continue;
       }
 
@@ -246,28 +280,50 @@ SEXP stri_locate_all_coll(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_
       }
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
-      int* ans_tab = INTEGER(ans);
+      SEXP ans = R_NilValue;
+      int* ans_start;
+      int* ans_end;
+      if (output_flat) {
+         R_len_t k = flat.append(i, noccurrences);
+         ans_start = flat.getStart(k);
+         ans_end   = flat.getEnd(k);
+      }
+      else {
+         STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
+         ans_start = INTEGER(ans);
+         ans_end   = ans_start+noccurrences;
+      }
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
       for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
          pair<R_len_t, R_len_t> match = *iter;
-         ans_tab[j]             = match.first;
-         ans_tab[j+noccurrences] = match.second;
+         ans_start[j] = match.first;
+         ans_end[j]   = match.second;
       }
 
-      // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-      str_cont.UChar16_to_UChar32_index(i, ans_tab,
-            ans_tab+noccurrences, noccurrences,
+      if (units_bytes) // Adjust UChar index -> UTF-8 byte index
+         str_cont.UChar16_to_UTF8_index(i, ans_start, ans_end, noccurrences,
+            1, // 0-based index -> 1-based
+            0  // end returns position of next byte after match
+         );
+      else // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
+         str_cont.UChar16_to_UChar32_index(i, ans_start, ans_end, noccurrences,
             1, // 0-based index -> 1-based
             0  // end returns position of next character after match
-      );
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1);
+         );
+
+      if (!output_flat) {
+         SET_VECTOR_ELT(ret, i, ans);
+         STRI__UNPROTECT(1);
+      }
    }
 
-   stri__locate_set_dimnames_list(ret);
    if (collator) { ucol_close(collator); collator=NULL; }
+   if (output_flat) {
+      STRI__UNPROTECT_ALL
+      return flat.toR();
+   }
+
+   stri__locate_set_dimnames_list(ret);
    STRI__UNPROTECT_ALL
    return ret;
    STRI__ERROR_HANDLER_END(
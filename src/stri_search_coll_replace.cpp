@@ -307,6 +307,9 @@ SEXP stri__replace_all_coll_no_vectorize_all(SEXP str, SEXP pattern, SEXP replac
  */
 SEXP stri_replace_all_coll(SEXP str, SEXP pattern, SEXP replacement, SEXP vectorize_all, SEXP opts_collator)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_all_coll(str, pattern, replacement, vectorize_all, opts_collator))
+
    if (stri__prepare_arg_logical_1_notNA(vectorize_all, "vectorize_all"))
       return stri__replace_allfirstlast_coll(str, pattern, replacement, opts_collator, 0);
    else
@@ -333,6 +336,9 @@ SEXP stri_replace_all_coll(SEXP str, SEXP pattern, SEXP replacement, SEXP vector
  */
 SEXP stri_replace_last_coll(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_collator)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_last_coll(str, pattern, replacement, opts_collator))
+
    return stri__replace_allfirstlast_coll(str, pattern, replacement, opts_collator, -1);
 }
 
@@ -356,5 +362,8 @@ SEXP stri_replace_last_coll(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_
  */
 SEXP stri_replace_first_coll(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_collator)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_first_coll(str, pattern, replacement, opts_collator))
+
    return stri__replace_allfirstlast_coll(str, pattern, replacement, opts_collator, 1);
 }
@@ -31,6 +31,7 @@
 
 
 #include "stri_stringi.h"
+#include "stri_tokens_output.h"
 #include "stri_container_utf16.h"
 #include "stri_container_usearch.h"
 #include "stri_container_integer.h"
@@ -83,6 +84,9 @@ using namespace std;
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-04)
  *    allow `simplify=NA`; FR #126: pass n to stri_list2matrix
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ *    allow simplify="flat"
  */
 SEXP stri_split_coll(SEXP str, SEXP pattern, SEXP n, SEXP omit_empty,
                      SEXP tokens_only, SEXP simplify, SEXP opts_collator)
@@ -92,12 +96,12 @@ SEXP stri_split_coll(SEXP str, SEXP pattern, SEXP n, SEXP omit_empty,
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
    PROTECT(n = stri_prepare_arg_integer(n, "n"));
    PROTECT(omit_empty = stri_prepare_arg_logical(omit_empty, "omit_empty"));
-   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, "simplify"));
+   StriTokensOutput::Mode simplify_mode = StriTokensOutput::getMode(simplify);
 
    UCollator* collator = NULL;
    collator = stri__ucol_open(opts_collator);
 
-   STRI__ERROR_HANDLER_BEGIN(5)
+   STRI__ERROR_HANDLER_BEGIN(4)
    R_len_t vectorize_length = stri__recycling_rule(true, 4,
       LENGTH(str), LENGTH(pattern), LENGTH(n), LENGTH(omit_empty));
    StriContainerUTF16 str_cont(str, vectorize_length);
@@ -185,19 +189,14 @@ SEXP stri_split_coll(SEXP str, SEXP pattern, SEXP n, SEXP omit_empty,
 
    if (collator) { ucol_close(collator); collator=NULL; }
 
-   if (LOGICAL(simplify)[0] == NA_LOGICAL || LOGICAL(simplify)[0]) {
-      R_len_t n_min = 0;
-      R_len_t n_length = LENGTH(n);
-      int* n_tab = INTEGER(n);
-      for (R_len_t i=0; i<n_length; ++i) {
-         if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
-            n_min = n_tab[i];
-      }
-      STRI__PROTECT(ret = stri_list2matrix(ret, Rf_ScalarLogical(TRUE),
-         (LOGICAL(simplify)[0] == NA_LOGICAL)?stri__vector_NA_strings(1)
-                                             :stri__vector_empty_strings(1),
-         Rf_ScalarInteger(n_min)))
+   R_len_t n_min = 0; // FR #126: min. number of matrix columns
+   R_len_t n_length = LENGTH(n);
+   int* n_tab = INTEGER(n);
+   for (R_len_t i=0; i<n_length; ++i) {
+      if (n_tab[i] != NA_INTEGER && n_min < n_tab[i])
+         n_min = n_tab[i];
    }
+   STRI__PROTECT(ret = StriTokensOutput::listToR(ret, simplify_mode, n_min));
 
    STRI__UNPROTECT_ALL
    return ret;
@@ -81,6 +81,46 @@ void stri__locate_set_dimnames_list(SEXP list) {
 }
 
 
+/**
+ * Get the value of the `units` argument of stri_locate_*
+ *
+ * @param units single string, "chars" or "bytes"; NULL for the default
+ * @return true for "bytes"
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ */
+bool stri__locate_get_units_bytes(SEXP units)
+{
+   if (Rf_isNull(units)) return false;
+   const char* units_val = stri__prepare_arg_string_1_notNA(units, "units");
+   const char* units_opts[] = {"chars", "bytes", NULL};
+   int units_cur = stri__match_arg(units_val, units_opts);
+   if (units_cur < 0)
+      Rf_error(MSG__INCORRECT_MATCH_OPTION, "units");
+   return (units_cur == 1);
+}
+
+
+/**
+ * Get the value of the `output` argument of stri_locate_all_*
+ *
+ * @param output single string, "list" or "flat"; NULL for the default
+ * @return true for "flat"
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ */
+bool stri__locate_get_output_flat(SEXP output)
+{
+   if (Rf_isNull(output)) return false;
+   const char* output_val = stri__prepare_arg_string_1_notNA(output, "output");
+   const char* output_opts[] = {"list", "flat", NULL};
+   int output_cur = stri__match_arg(output_val, output_opts);
+   if (output_cur < 0)
+      Rf_error(MSG__INCORRECT_MATCH_OPTION, "output");
+   return (output_cur == 1);
+}
+
+
 // I really love macros /MG/ :)
 #define stri__subset_by_logical__MACRO \
    SEXP ret; \
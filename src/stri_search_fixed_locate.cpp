@@ -33,6 +33,7 @@
 #include "stri_stringi.h"
 #include "stri_container_utf8_indexable.h"
 #include "stri_container_bytesearch.h"
+#include "stri_locate_flat.h"
 #include <deque>
 #include <utility>
 using namespace std;
@@ -43,6 +44,8 @@ using namespace std;
  *
  * @param str character vector
  * @param pattern character vector
+ * @param opts_fixed list
+ * @param units single string; "chars" or "bytes"
  * @param first looking for first or last match?
  * @return integer matrix (2 columns)
  *
@@ -65,9 +68,13 @@ using namespace std;
  *
  * @version 0.5-1 (Marek Gagolewski, 2015-02-14)
  *    use StriByteSearchMatcher
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri__locate_firstlast_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, bool first)
+SEXP stri__locate_firstlast_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, SEXP units, bool first)
 {
+   bool units_bytes = stri__locate_get_units_bytes(units);
    uint32_t pattern_flags = StriContainerByteSearch::getByteSearchFlags(opts_fixed);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
@@ -104,12 +111,14 @@ SEXP stri__locate_firstlast_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, bool
          ret_tab[i]                  = start;
          ret_tab[i+vectorize_length] = start+matcher->getMatchedLength();
 
-         // Adjust UTF8 byte index -> UChar32 index
-         str_cont.UTF8_to_UChar32_index(i,
-               ret_tab+i, ret_tab+i+vectorize_length, 1,
-               1, // 0-based index -> 1-based
-               0  // end returns position of next character after match
-         );
+         if (units_bytes) // 0-based index -> 1-based
+            ret_tab[i]++;
+         else // Adjust UTF8 byte index -> UChar32 index
+            str_cont.UTF8_to_UChar32_index(i,
+                  ret_tab+i, ret_tab+i+vectorize_length, 1,
+                  1, // 0-based index -> 1-based
+                  0  // end returns position of next character after match
+            );
       }
    }
 
@@ -124,6 +133,7 @@ SEXP stri__locate_firstlast_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, bool
  *
  * @param str character vector
  * @param pattern character vector
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.1-?? (Bartlomiej Tartanus)
@@ -139,10 +149,13 @@ SEXP stri__locate_firstlast_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, bool
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-07)
  *    FR #110, #23: opts_fixed arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
+SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, SEXP units)
 {
-   return stri__locate_firstlast_fixed(str, pattern, opts_fixed, true);
+   return stri__locate_firstlast_fixed(str, pattern, opts_fixed, units, true);
 }
 
 
@@ -151,6 +164,7 @@ SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
  *
  * @param str character vector
  * @param pattern character vector
+ * @param units single string; "chars" or "bytes"
  * @return integer matrix (2 columns)
  *
  * @version 0.1-?? (Bartlomiej Tartanus)
@@ -166,10 +180,13 @@ SEXP stri_locate_first_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
  *
  * @version 0.4-1 (Marek Gagolewski, 2014-12-07)
  *    FR #110, #23: opts_fixed arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
+SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed, SEXP units)
 {
-   return stri__locate_firstlast_fixed(str, pattern, opts_fixed, false);
+   return stri__locate_firstlast_fixed(str, pattern, opts_fixed, units, false);
 }
 
 
@@ -177,7 +194,12 @@ SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
  *
  * @param str character vector
  * @param pattern character vector
- * @return list of integer matrices (2 columns)
+ * @param omit_no_match single logical value
+ * @param opts_fixed list
+ * @param units single string; "chars" or "bytes"
+ * @param output single string; "list" or "flat"
+ * @return list of integer matrices (2 columns) or, for output="flat",
+ *    a list of 3 integer vectors (id, start, end)
  *
  * @version 0.1-?? (Bartek Tartanus)
  *
@@ -201,11 +223,17 @@ SEXP stri_locate_last_fixed(SEXP str, SEXP pattern, SEXP opts_fixed)
  *
  * @version 0.5-1 (Marek Gagolewski, 2015-02-14)
  *    use StriByteSearchMatcher
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units and output args added
  */
-SEXP stri_locate_all_fixed(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_fixed)
+SEXP stri_locate_all_fixed(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_fixed,
+   SEXP units, SEXP output)
 {
    uint32_t pattern_flags = StriContainerByteSearch::getByteSearchFlags(opts_fixed, /*allow_overlap*/true);
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
+   bool units_bytes = stri__locate_get_units_bytes(units);
+   bool output_flat = stri__locate_get_output_flat(output);
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
 
@@ -215,22 +243,26 @@ SEXP stri_locate_all_fixed(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
    StriContainerByteSearch pattern_cont(pattern, vectorize_length, pattern_flags);
 
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, output_flat?0:vectorize_length));
+   StriLocateFlat flat;
 
    for (R_len_t i = pattern_cont.vectorize_init();
       i != pattern_cont.vectorize_end();
       i = pattern_cont.vectorize_next(i))
    {
       STRI__CONTINUE_ON_EMPTY_OR_NA_STR_PATTERN(str_cont, pattern_cont,
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));,
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));)
+         if (output_flat) flat.pushNA(i);
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));,
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));)
 
       StriByteSearchMatcher* matcher = pattern_cont.getMatcher(i);
       matcher->reset(str_cont.get(i).c_str(), str_cont.get(i).length());
 
       int start = matcher->findFirst();
       if (start == USEARCH_DONE) { // no matches at all
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
          continue;
       }
 
@@ -241,24 +273,45 @@ SEXP stri_locate_all_fixed(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
       }
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
-      int* ans_tab = INTEGER(ans);
+      SEXP ans = R_NilValue;
+      int* ans_start;
+      int* ans_end;
+      if (output_flat) {
+         R_len_t k = flat.append(i, noccurrences);
+         ans_start = flat.getStart(k);
+         ans_end   = flat.getEnd(k);
+      }
+      else {
+         STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
+         ans_start = INTEGER(ans);
+         ans_end   = ans_start+noccurrences;
+      }
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
       for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
          pair<R_len_t, R_len_t> match = *iter;
-         ans_tab[j]              = match.first;
-         ans_tab[j+noccurrences] = match.second;
+         ans_start[j] = match.first;
+         ans_end[j]   = match.second;
       }
 
-      // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-      str_cont.UTF8_to_UChar32_index(i, ans_tab,
-            ans_tab+noccurrences, noccurrences,
-            1, // 0-based index -> 1-based
-            0  // end returns position of next character after match
-      );
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1);
+      if (units_bytes) { // 0-based index -> 1-based
+         for (R_len_t j = 0; j < noccurrences; ++j)
+            ans_start[j]++;
+      }
+      else // Adjust UTF8 byte index -> UChar32 index
+         str_cont.UTF8_to_UChar32_index(i, ans_start, ans_end, noccurrences,
+               1, // 0-based index -> 1-based
+               0  // end returns position of next character after match
+         );
+
+      if (!output_flat) {
+         SET_VECTOR_ELT(ret, i, ans);
+         STRI__UNPROTECT(1);
+      }
+   }
+
+   if (output_flat) {
+      STRI__UNPROTECT_ALL
+      return flat.toR();
    }
 
    stri__locate_set_dimnames_list(ret);
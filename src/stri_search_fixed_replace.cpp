@@ -536,6 +536,9 @@ SEXP stri__replace_all_fixed_no_vectorize_all(SEXP str, SEXP pattern, SEXP repla
  */
 SEXP stri_replace_all_fixed(SEXP str, SEXP pattern, SEXP replacement, SEXP vectorize_all, SEXP opts_fixed)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_all_fixed(str, pattern, replacement, vectorize_all, opts_fixed))
+
    if (stri__prepare_arg_logical_1_notNA(vectorize_all, "vectorize_all"))
       return stri__replace_allfirstlast_fixed(str, pattern, replacement, opts_fixed, 0);
    else
@@ -564,6 +567,9 @@ SEXP stri_replace_all_fixed(SEXP str, SEXP pattern, SEXP replacement, SEXP vecto
  */
 SEXP stri_replace_last_fixed(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_fixed)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_last_fixed(str, pattern, replacement, opts_fixed))
+
    return stri__replace_allfirstlast_fixed(str, pattern, replacement, opts_fixed, -1);
 }
 
@@ -589,5 +595,8 @@ SEXP stri_replace_last_fixed(SEXP str, SEXP pattern, SEXP replacement, SEXP opts
  */
 SEXP stri_replace_first_fixed(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_fixed)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_first_fixed(str, pattern, replacement, opts_fixed))
+
    return stri__replace_allfirstlast_fixed(str, pattern, replacement, opts_fixed, 1);
 }
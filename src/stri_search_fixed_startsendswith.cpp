@@ -34,6 +34,8 @@
 #include "stri_container_utf8_indexable.h"
 #include "stri_container_bytesearch.h"
 #include "stri_container_integer.h"
+#include <string>
+#include <vector>
 
 
 /**
@@ -175,3 +177,264 @@ SEXP stri_endswith_fixed(SEXP str, SEXP pattern, SEXP to, SEXP opts_fixed)
    return ret;
    STRI__ERROR_HANDLER_END( ;/* do nothing special on error */ )
 }
+
+
+/** A byte trie of many search patterns [internal]
+ *
+ * The edges are kept in a single open-addressing (linear probing)
+ * hash table keyed by (parent node, byte), so that following an edge
+ * takes O(1) time regardless of a node's fan-out.
+ * Node 0 is the root.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-14)
+ */
+class StriByteTrie {
+private:
+   struct Slot {
+      uint64_t key;  // (parent << 8) | byte
+      R_len_t child; // < 0 for an empty slot
+   };
+
+   std::vector<Slot> slots;
+   size_t mask;
+   std::vector<R_len_t> leaf; // pattern index for each node or -1
+
+   static inline size_t hash(uint64_t key) {
+      key *= 0x9E3779B97F4A7C15ULL;
+      return (size_t)(key ^ (key >> 32));
+   }
+
+   inline size_t find(uint64_t key) const {
+      size_t k = hash(key) & mask;
+      while (slots[k].child >= 0 && slots[k].key != key)
+         k = (k+1) & mask;
+      return k;
+   }
+
+public:
+   /** @param max_nodes upper bound for the number of nodes (edges+1) */
+   StriByteTrie(size_t max_nodes) {
+      size_t capacity = 16;
+      while (capacity < 2*max_nodes) capacity *= 2; // load factor <= 0.5
+      Slot empty = { 0, -1 };
+      slots.assign(capacity, empty);
+      mask = capacity-1;
+      leaf.reserve(max_nodes);
+      leaf.push_back(-1); // the root
+   }
+
+   /** add a non-empty key unless it is already there (the first occurrence wins) */
+   void insert(const char* s, size_t n, R_len_t idx) {
+      R_len_t node = 0;
+      for (size_t j=0; j<n; ++j) {
+         uint64_t key = ((uint64_t)node << 8) | (uint8_t)s[j];
+         size_t k = find(key);
+         if (slots[k].child < 0) {
+            slots[k].key = key;
+            slots[k].child = (R_len_t)leaf.size();
+            leaf.push_back(-1);
+         }
+         node = slots[k].child;
+      }
+      if (leaf[node] < 0) leaf[node] = idx;
+   }
+
+   /** @return child node or -1 */
+   inline R_len_t next(R_len_t node, uint8_t b) const {
+      return slots[find(((uint64_t)node << 8) | b)].child;
+   }
+
+   /** @return index of the key ending at a given node or -1 */
+   inline R_len_t getIndex(R_len_t node) const {
+      return leaf[node];
+   }
+};
+
+
+/** Prepare a trie key [internal]
+ *
+ * In the case-insensitive mode, each code point is mapped with
+ * \code{u_toupper()}, just like in \code{StriByteSearchMatcherKMPci}.
+ *
+ * @param key [out]
+ * @param s UTF-8 string
+ * @param n length of s
+ * @param caseInsensitive
+ * @param reverse reverse the bytes (for suffix matching)?
+ * @return false if s is not a valid UTF-8 string
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-14)
+ */
+static bool stri__startsendswith_which_key(std::string& key,
+   const char* s, R_len_t n, bool caseInsensitive, bool reverse)
+{
+   if (!caseInsensitive)
+      key.assign(s, (size_t)n);
+   else {
+      key.clear();
+      R_len_t j = 0;
+      UChar32 c;
+      char buf[U8_MAX_LENGTH];
+      while (j < n) {
+         U8_NEXT(s, j, n, c);
+         if (c < 0) return false;
+         R_len_t k = 0;
+         U8_APPEND_UNSAFE(buf, k, u_toupper(c));
+         key.append(buf, (size_t)k);
+      }
+   }
+
+   if (reverse)
+      key.assign(key.rbegin(), key.rend());
+   return true;
+}
+
+
+/** Find the longest pattern a string starts or ends with [internal]
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param nomatch single integer value
+ * @param opts_fixed list
+ * @param suffix match at the end of the strings?
+ * @return integer vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-14)
+ */
+static SEXP stri__startsendswith_which_fixed(SEXP str, SEXP pattern, SEXP nomatch,
+   SEXP opts_fixed, bool suffix)
+{
+   uint32_t pattern_flags = StriContainerByteSearch::getByteSearchFlags(opts_fixed);
+   PROTECT(str = stri_prepare_arg_string(str, "str"));
+   PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
+   PROTECT(nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch"));
+   R_len_t str_length = LENGTH(str);
+   R_len_t pattern_length = LENGTH(pattern);
+   int nomatch_cur = INTEGER(nomatch)[0];
+
+   STRI__ERROR_HANDLER_BEGIN(3)
+   StriContainerUTF8 str_cont(str, str_length);
+   StriContainerByteSearch pattern_cont(pattern, pattern_length, pattern_flags);
+   bool caseInsensitive = pattern_cont.isCaseInsensitive();
+
+   std::vector<std::string> keys(pattern_length);
+   size_t max_nodes = 1;
+   bool warn_empty = false;
+   for (R_len_t j=0; j<pattern_length; ++j) {
+      if (pattern_cont.isNA(j)) continue; // never matched
+      if (pattern_cont.get(j).length() <= 0) {
+         warn_empty = true;
+         continue;
+      }
+      if (!stri__startsendswith_which_key(keys[j], pattern_cont.get(j).c_str(),
+            pattern_cont.get(j).length(), caseInsensitive, suffix))
+         keys[j].clear(); // an invalid pattern cannot be matched
+      max_nodes += keys[j].size();
+   }
+   if (warn_empty) Rf_warning(MSG__EMPTY_SEARCH_PATTERN_UNSUPPORTED);
+
+   StriByteTrie trie(max_nodes);
+   for (R_len_t j=0; j<pattern_length; ++j) {
+      if (keys[j].size() > 0)
+         trie.insert(keys[j].data(), keys[j].size(), j);
+   }
+   keys.clear();
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
+   int* ret_tab = INTEGER(ret);
+
+   for (R_len_t i = 0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         ret_tab[i] = NA_INTEGER;
+         continue;
+      }
+
+      const char* s = str_cont.get(i).c_str();
+      R_len_t n = str_cont.get(i).length();
+      R_len_t best = -1;
+      R_len_t node = 0;
+
+      if (!caseInsensitive) {
+         // walk down the trie byte by byte, remember the deepest key seen
+         if (!suffix) {
+            for (R_len_t j=0; j<n; ++j) {
+               node = trie.next(node, (uint8_t)s[j]);
+               if (node < 0) break;
+               if (trie.getIndex(node) >= 0) best = trie.getIndex(node);
+            }
+         }
+         else {
+            for (R_len_t j=n-1; j>=0; --j) {
+               node = trie.next(node, (uint8_t)s[j]);
+               if (node < 0) break;
+               if (trie.getIndex(node) >= 0) best = trie.getIndex(node);
+            }
+         }
+      }
+      else {
+         // the same, but code point by code point, after u_toupper()
+         R_len_t j = suffix?n:0;
+         UChar32 c;
+         uint8_t buf[U8_MAX_LENGTH];
+         while (node >= 0 && (suffix?(j > 0):(j < n))) {
+            if (!suffix) {
+               U8_NEXT(s, j, n, c);
+            }
+            else {
+               U8_PREV(s, 0, j, c);
+            }
+            if (c < 0) break;
+            R_len_t k = 0;
+            U8_APPEND_UNSAFE(buf, k, u_toupper(c));
+            for (R_len_t l=0; node >= 0 && l<k; ++l)
+               node = trie.next(node, buf[suffix?(k-l-1):l]);
+            if (node >= 0 && trie.getIndex(node) >= 0) best = trie.getIndex(node);
+         }
+      }
+
+      ret_tab[i] = (best >= 0)?(best+1):nomatch_cur; // 0-based index -> 1-based
+   }
+
+   STRI__UNPROTECT_ALL
+   return ret;
+   STRI__ERROR_HANDLER_END( ;/* do nothing special on error */ )
+}
+
+
+/** Find the longest pattern a string starts with
+ *
+ * The patterns are compiled into a byte trie, hence the run time
+ * does not depend on the number of patterns.
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param nomatch single integer value
+ * @param opts_fixed list
+ * @return integer vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-14)
+ */
+SEXP stri_startswith_which_fixed(SEXP str, SEXP pattern, SEXP nomatch, SEXP opts_fixed)
+{
+   return stri__startsendswith_which_fixed(str, pattern, nomatch, opts_fixed, false);
+}
+
+
+/** Find the longest pattern a string ends with
+ *
+ * The patterns are compiled into a byte trie over reversed keys,
+ * hence the run time does not depend on the number of patterns.
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param nomatch single integer value
+ * @param opts_fixed list
+ * @return integer vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-14)
+ */
+SEXP stri_endswith_which_fixed(SEXP str, SEXP pattern, SEXP nomatch, SEXP opts_fixed)
+{
+   return stri__startsendswith_which_fixed(str, pattern, nomatch, opts_fixed, true);
+}
@@ -30,211 +30,257 @@
  */
 
 
-//// VERSION III: naive O(n*m) - damn slower
-//#include "stri_stringi.h"
-//#include "stri_container_utf8.h"
-//
-//
-///** Value Matching
-// *
-// * @param str character vector
-// * @param table character vector
-// * @nomatch single integer value
-// *
-// * @return integer vector
-// *
-// * @version 0.3-1 (Marek Gagolewski, 2014-06-06)
-// */
-//SEXP stri_in_fixed(SEXP str, SEXP table, SEXP nomatch)
-//{
-//   str = stri_prepare_arg_string(str, "str");
-//   table = stri_prepare_arg_string(table, "table");
-//   nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch");
-//   R_len_t str_length = LENGTH(str);
-//   R_len_t table_length = LENGTH(table);
-//
-//   R_len_t nomatch_cur = INTEGER(nomatch)[0];
-//
-//   STRI__ERROR_HANDLER_BEGIN
-//   StriContainerUTF8 str_cont(str, str_length);
-//   StriContainerUTF8 table_cont(table, table_length);
-//
-//   SEXP ret;
-//   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
-//   int* ret_tab = INTEGER(ret);
-//
-//   for (R_len_t i = 0; i<str_length; ++i) {
-//      if (str_cont.isNA(i)) {
-//         ret_tab[i] = NA_INTEGER;
-//         continue;
-//      }
-//
-//      const char* str_cur = str_cont.get(i).c_str();
-//
-//      ret_tab[i] = nomatch_cur;
-//      for (int j=0; j<table_length; ++j) {
-//         if (table_cont.isNA(j)) continue;
-//         if (!strcmp(str_cur, table_cont.get(j).c_str())) {
-//            ret_tab[i] = j+1;
-//            break;
-//         }
-//      }
-//
-//      // ... and so on
-//      // it's already slower than match() for n <= 100000
-//
-////      if (it != dict.end())
-////         ret_tab[i] = (*it).second;
-////      else
-////         ret_tab[i] = nomatch_cur;
-//   }
-//
-//   STRI__UNPROTECT_ALL
-//   return ret;
-//   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
-//}
-
-
-//// VERSION II: sort() table, then (*unfinished*) bin search
-//#include "stri_stringi.h"
-//#include "stri_container_utf8.h"
-//#include <algorithm>
-//#include <vector>
-//
-///** helper struct (comparer) for stri_in_fixed
-// *
-// */
-//struct cmp_str
-//{
-//   StriContainerUTF8* cont;
-//
-//   cmp_str(StriContainerUTF8* _cont) {
-//      cont = _cont;
-//   }
-//
-//   bool operator()(int i, int j)
-//   {
-//      if (cont->isNA(i)) return false;
-//      else if (cont->isNA(j)) return true;
-//      else return strcmp(cont->get(i).c_str(), cont->get(j).c_str()) < 0;
-//   }
-//};
-//
-//
-///** Value Matching
-// *
-// * @param str character vector
-// * @param table character vector
-// * @nomatch single integer value
-// *
-// * @return integer vector
-// *
-// * @version 0.3-1 (Marek Gagolewski, 2014-06-06)
-// */
-//SEXP stri_in_fixed(SEXP str, SEXP table, SEXP nomatch)
-//{
-//   str = stri_prepare_arg_string(str, "str");
-//   table = stri_prepare_arg_string(table, "table");
-//   nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch");
-//   R_len_t str_length = LENGTH(str);
-//   R_len_t table_length = LENGTH(table);
-//
-//   R_len_t nomatch_cur = INTEGER(nomatch)[0];
-//
-//   STRI__ERROR_HANDLER_BEGIN
-//   StriContainerUTF8 str_cont(str, str_length);
-//   StriContainerUTF8 table_cont(table, table_length);
-//
-//   cmp_str comparer(&str_cont);
-//   std::vector<int> idx(table_length);
-//   for (int i=0; i<table_length; ++i) {
-//      idx[i] = i;
-//   }
-//
-//   std::sort(idx.begin(), idx.end(), comparer);
-//
-//   SEXP ret;
-//   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
-//   int* ret_tab = INTEGER(ret);
-//
-//   for (R_len_t i = 0; i<str_length; ++i) {
-//      if (str_cont.isNA(i)) {
-//         ret_tab[i] = NA_INTEGER;
-//         continue;
-//      }
-//
-//      // ... and so on
-//      // it's already slower than match() for n <= 100000
-//
-////      if (it != dict.end())
-////         ret_tab[i] = (*it).second;
-////      else
-////         ret_tab[i] = nomatch_cur;
-//   }
-//
-//   STRI__UNPROTECT_ALL
-//   return ret;
-//   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
-//}
-
-
-// // VERSION I: using boost's unordered_map
-//
-//#include "stri_stringi.h"
-//#include "stri_container_utf8.h"
-//#include <boost/unordered/unordered_map.hpp>
-//#include <string>
-//
-//
-///** Value Matching
-// *
-// * @param str character vector
-// * @param table character vector
-// * @nomatch single integer value
-// *
-// * @return integer vector
-// *
-// * @version 0.3-1 (Marek Gagolewski, 2014-06-06)
-// */
-//SEXP stri_in_fixed(SEXP str, SEXP table, SEXP nomatch)
-//{
-//   str = stri_prepare_arg_string(str, "str");
-//   table = stri_prepare_arg_string(table, "table");
-//   nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch");
-//   R_len_t str_length = LENGTH(str);
-//   R_len_t table_length = LENGTH(table);
-//
-//   R_len_t nomatch_cur = INTEGER(nomatch)[0];
-//
-//   STRI__ERROR_HANDLER_BEGIN
-//   StriContainerUTF8 str_cont(str, str_length);
-//   StriContainerUTF8 table_cont(table, table_length);
-//
-//   boost::unordered_map<std::string, R_len_t> dict(table_length);
-//   for (R_len_t i=table_length-1; i>=0; --i) {
-//      if (table_cont.isNA(i)) continue;
-//      dict[std::string(table_cont.get(i).c_str())] = i+1; // 0-based index -> 1-based
-//   }
-//
-//   SEXP ret;
-//   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
-//   int* ret_tab = INTEGER(ret);
-//
-//   for (R_len_t i = 0; i<str_length; ++i) {
-//      if (str_cont.isNA(i)) {
-//         ret_tab[i] = NA_INTEGER;
-//         continue;
-//      }
-//
-//      std::string str_cur(str_cont.get(i).c_str());
-//      boost::unordered_map<std::string, R_len_t>::iterator it = dict.find(str_cur);
-//      if (it != dict.end())
-//         ret_tab[i] = (*it).second;
-//      else
-//         ret_tab[i] = nomatch_cur;
-//   }
-//
-//   STRI__UNPROTECT_ALL
-//   return ret;
-//   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
-//}
+#include "stri_stringi.h"
+#include "stri_container_utf8.h"
+#include "stri_container_utf16.h"
+#include <unicode/ucol.h>
+#include <vector>
+
+
+/** A 64-bit hash of a byte string [internal]
+ *
+ * Reads 8 bytes at a time; the hash values depend on the platform's
+ * endianness, which is fine, as they are never stored.
+ *
+ * @param s byte string
+ * @param n length of s
+ * @return hash value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-08)
+ */
+static inline uint64_t stri__in_hash(const char* s, R_len_t n)
+{
+   uint64_t h = 0x9E3779B97F4A7C15ULL ^ (uint64_t)n;
+   R_len_t i = 0;
+   uint64_t w;
+   for (; i+8 <= n; i += 8) {
+      memcpy(&w, s+i, 8);
+      h = (h ^ w) * 0xFF51AFD7ED558CCDULL;
+      h ^= h >> 32;
+   }
+   w = 0;
+   memcpy(&w, s+i, (size_t)(n-i));
+   h = (h ^ w) * 0xC4CEB9FE1A85EC53ULL;
+   h ^= h >> 29;
+   h *= 0xFF51AFD7ED558CCDULL;
+   h ^= h >> 32;
+   return h;
+}
+
+
+/** An open-addressing (linear probing) hash table of byte strings [internal]
+ *
+ * Maps byte strings (UTF-8 strings or collation sort keys)
+ * to the index of their first occurrence in a table.
+ * The keys are not copied; they must outlive the object.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-08)
+ */
+class StriInHashTable {
+private:
+   struct Slot {
+      uint64_t hash;
+      const char* s;
+      R_len_t n;
+      R_len_t idx; // < 0 for an empty slot
+   };
+
+   std::vector<Slot> slots;
+   size_t mask;
+
+   inline size_t find(const char* s, R_len_t n, uint64_t h) const {
+      size_t k = (size_t)h & mask;
+      while (slots[k].idx >= 0) {
+         if (slots[k].hash == h && slots[k].n == n &&
+               memcmp(slots[k].s, s, (size_t)n) == 0)
+            break;
+         k = (k+1) & mask;
+      }
+      return k;
+   }
+
+public:
+   StriInHashTable(R_len_t n) {
+      size_t capacity = 16;
+      while (capacity < 2*(size_t)n) capacity *= 2; // load factor <= 0.5
+      Slot empty = { 0, NULL, 0, -1 };
+      slots.assign(capacity, empty);
+      mask = capacity-1;
+   }
+
+   /** add a key unless it is already there (the first occurrence wins) */
+   inline void insert(const char* s, R_len_t n, R_len_t idx) {
+      uint64_t h = stri__in_hash(s, n);
+      size_t k = find(s, n, h);
+      if (slots[k].idx < 0) {
+         slots[k].hash = h;
+         slots[k].s = s;
+         slots[k].n = n;
+         slots[k].idx = idx;
+      }
+   }
+
+   /** @return index of the first occurrence of a key or -1 */
+   inline R_len_t get(const char* s, R_len_t n) const {
+      return slots[find(s, n, stri__in_hash(s, n))].idx;
+   }
+};
+
+
+/** Get a collation sort key [internal]
+ *
+ * @param col collator
+ * @param str string
+ * @param buf [out] buffer, resized if necessary
+ * @return sort key length (without the trailing NUL)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-08)
+ */
+static R_len_t stri__in_sortkey(const UCollator* col, const UnicodeString& str,
+   std::vector<uint8_t>& buf)
+{
+   if (buf.size() < 64) buf.resize(64);
+   int32_t n = ucol_getSortKey(col, str.getBuffer(), str.length(),
+      &buf[0], (int32_t)buf.size());
+   if (n > (int32_t)buf.size()) {
+      buf.resize(n);
+      n = ucol_getSortKey(col, str.getBuffer(), str.length(),
+         &buf[0], (int32_t)buf.size());
+   }
+   if (n <= 0) throw StriException(MSG__INTERNAL_ERROR);
+   return (R_len_t)(n-1);
+}
+
+
+/** Value Matching
+ *
+ * The strings are compared in UTF-8 (whatever their declared encodings)
+ * via a hash table built over \code{table}.
+ *
+ * @param str character vector
+ * @param table character vector
+ * @param nomatch single integer value
+ *
+ * @return integer vector
+ *
+ * @version 0.3-1 (Marek Gagolewski, 2014-06-06)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-08)
+ *    revived: an open-addressing hash table of UTF-8 strings
+ */
+SEXP stri_in_fixed(SEXP str, SEXP table, SEXP nomatch)
+{
+   PROTECT(str = stri_prepare_arg_string(str, "str"));
+   PROTECT(table = stri_prepare_arg_string(table, "table"));
+   PROTECT(nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch"));
+   R_len_t str_length = LENGTH(str);
+   R_len_t table_length = LENGTH(table);
+   int nomatch_cur = INTEGER(nomatch)[0];
+
+   STRI__ERROR_HANDLER_BEGIN(3)
+   StriContainerUTF8 str_cont(str, str_length);
+   StriContainerUTF8 table_cont(table, table_length);
+
+   StriInHashTable dict(table_length);
+   for (R_len_t j=0; j<table_length; ++j) {
+      if (table_cont.isNA(j)) continue;
+      dict.insert(table_cont.get(j).c_str(), table_cont.get(j).length(), j);
+   }
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
+   int* ret_tab = INTEGER(ret);
+
+   for (R_len_t i = 0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         ret_tab[i] = NA_INTEGER;
+         continue;
+      }
+
+      R_len_t j = dict.get(str_cont.get(i).c_str(), str_cont.get(i).length());
+      ret_tab[i] = (j >= 0)?(j+1):nomatch_cur; // 0-based index -> 1-based
+   }
+
+   STRI__UNPROTECT_ALL
+   return ret;
+   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
+}
+
+
+/** Value Matching, with collation
+ *
+ * Two strings are canonically equivalent iff their sort keys are equal,
+ * hence a hash table of the sort keys of \code{table} is used.
+ *
+ * @param str character vector
+ * @param table character vector
+ * @param nomatch single integer value
+ * @param opts_collator passed to stri__ucol_open()
+ *
+ * @return integer vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-08)
+ */
+SEXP stri_in_coll(SEXP str, SEXP table, SEXP nomatch, SEXP opts_collator)
+{
+   PROTECT(str = stri_prepare_arg_string(str, "str"));
+   PROTECT(table = stri_prepare_arg_string(table, "table"));
+   PROTECT(nomatch = stri_prepare_arg_integer_1(nomatch, "nomatch"));
+   R_len_t str_length = LENGTH(str);
+   R_len_t table_length = LENGTH(table);
+   int nomatch_cur = INTEGER(nomatch)[0];
+
+   // call stri__ucol_open after prepare_arg:
+   // if prepare_arg had failed, we would have a mem leak
+   UCollator* col = NULL;
+   col = stri__ucol_open(opts_collator);
+
+   STRI__ERROR_HANDLER_BEGIN(3)
+   StriContainerUTF16 str_cont(str, str_length);
+   StriContainerUTF16 table_cont(table, table_length);
+
+   // all the sort keys are stored in a single buffer
+   std::vector<uint8_t> buf;
+   std::vector<char> keys;
+   std::vector<R_len_t> keys_off(table_length+1, 0);
+   for (R_len_t j=0; j<table_length; ++j) {
+      keys_off[j+1] = keys_off[j];
+      if (table_cont.isNA(j)) continue;
+      R_len_t n = stri__in_sortkey(col, table_cont.get(j), buf);
+      keys.insert(keys.end(), (const char*)&buf[0], (const char*)&buf[0]+n);
+      keys_off[j+1] += n;
+   }
+
+   StriInHashTable dict(table_length);
+   for (R_len_t j=0; j<table_length; ++j) {
+      if (table_cont.isNA(j)) continue;
+      R_len_t n = keys_off[j+1]-keys_off[j];
+      dict.insert((n > 0)?&keys[keys_off[j]]:"", n, j);
+   }
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(INTSXP, str_length));
+   int* ret_tab = INTEGER(ret);
+
+   for (R_len_t i = 0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         ret_tab[i] = NA_INTEGER;
+         continue;
+      }
+
+      R_len_t n = stri__in_sortkey(col, str_cont.get(i), buf);
+      R_len_t j = dict.get((const char*)&buf[0], n);
+      ret_tab[i] = (j >= 0)?(j+1):nomatch_cur; // 0-based index -> 1-based
+   }
+
+   if (col) {
+      ucol_close(col);
+      col = NULL;
+   }
+
+   STRI__UNPROTECT_ALL
+   return ret;
+   STRI__ERROR_HANDLER_END({
+      if (col) { ucol_close(col); col = NULL; }
+   })
+}
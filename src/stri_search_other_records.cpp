@@ -0,0 +1,326 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "stri_stringi.h"
+#include "stri_container_utf8.h"
+#include <string>
+#include <vector>
+
+
+#define STRI__RECORDS_OTHER 0
+#define STRI__RECORDS_SEP   1
+#define STRI__RECORDS_EOL   2
+
+
+/**
+ * A single field as located by StriRecordsScanner
+ *
+ * If \code{quoted} is true, then \code{[from, to)} gives the contents
+ * of the quoted part (without the enclosing quotes) and \code{[tail_from, tail_to)}
+ * is whatever follows the closing quote up to the field delimiter.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-27)
+ */
+struct StriRecordsField {
+   R_len_t from;
+   R_len_t to;
+   R_len_t tail_from;
+   R_len_t tail_to;
+   bool quoted;
+   bool escaped;
+};
+
+
+/**
+ * Table-driven scanner of delimited text records
+ *
+ * All the special characters are ASCII, so we may safely
+ * operate on UTF-8 bytes.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-27)
+ */
+class StriRecordsScanner {
+private:
+   unsigned char byte_class[256];
+   int quote;   ///< -1 if quoting is disabled
+   int escape;  ///< -1 if escaping is disabled; == quote for doubled quotes
+
+public:
+   StriRecordsScanner(int sep, int quote, int escape)
+   {
+      this->quote = quote;
+      this->escape = escape;
+      for (int c=0; c<256; ++c)
+         byte_class[c] = STRI__RECORDS_OTHER;
+      byte_class[(unsigned char)sep] = STRI__RECORDS_SEP;
+      byte_class[(unsigned char)ASCII_CR] = STRI__RECORDS_EOL;
+      byte_class[(unsigned char)ASCII_LF] = STRI__RECORDS_EOL;
+   }
+
+
+   /** skips any empty lines at \code{s[i]}
+    *
+    * @return true if there is a record to be read
+    */
+   inline bool skipEmptyLines(const char* s, R_len_t n, R_len_t& i) const
+   {
+      while (i < n && byte_class[(unsigned char)s[i]] == STRI__RECORDS_EOL)
+         ++i;
+      return (i < n);
+   }
+
+
+   /** locates the next field starting at \code{s[i]}
+    *
+    * on return, \code{i} is positioned after the field's terminator
+    *
+    * @return true if the field is followed by another one
+    *    in the same record
+    */
+   bool nextField(const char* s, R_len_t n, R_len_t& i, StriRecordsField& field) const
+   {
+      field.escaped = false;
+      if (quote >= 0 && i < n && s[i] == (char)quote) {
+         field.quoted = true;
+         field.from = ++i;
+         while (true) {
+            while (i < n && s[i] != (char)quote && s[i] != (char)escape)
+               ++i;
+
+            if (i >= n) { // unterminated quote - take all that is left
+               field.to = n;
+               break;
+            }
+
+            if (s[i] == (char)escape && escape != quote) {
+               field.escaped = true;
+               i = (i+1 < n) ? i+2 : n;
+            }
+            else if (escape == quote && i+1 < n && s[i+1] == (char)quote) {
+               field.escaped = true;
+               i += 2;
+            }
+            else { // closing quote
+               field.to = i++;
+               break;
+            }
+         }
+         field.tail_from = i;
+         while (i < n && byte_class[(unsigned char)s[i]] == STRI__RECORDS_OTHER)
+            ++i;
+         field.tail_to = i;
+      }
+      else {
+         field.quoted = false;
+         field.from = i;
+         while (i < n && byte_class[(unsigned char)s[i]] == STRI__RECORDS_OTHER)
+            ++i;
+         field.to = i;
+      }
+
+      if (i >= n)
+         return false;
+      else if (byte_class[(unsigned char)s[i]] == STRI__RECORDS_SEP) {
+         ++i;
+         return true;
+      }
+      else { // EOL: LF, CR, or CRLF
+         if (s[i] == ASCII_CR && i+1 < n && s[i+1] == ASCII_LF)
+            ++i;
+         ++i;
+         return false;
+      }
+   }
+
+
+   /** creates a CHARSXP representing a given field,
+    *  removing escape characters if necessary
+    */
+   SEXP mkField(const char* s, const StriRecordsField& field, std::string& buf) const
+   {
+      if (!field.quoted || (!field.escaped && field.tail_from == field.tail_to))
+         return Rf_mkCharLenCE(s+field.from, field.to-field.from, CE_UTF8);
+
+      buf.clear();
+      if (field.escaped) {
+         for (R_len_t j=field.from; j<field.to; ++j) {
+            // either an escape char or the first of two quotes - skip it
+            if (s[j] == (char)escape && j+1 < field.to)
+               ++j;
+            buf.push_back(s[j]);
+         }
+      }
+      else
+         buf.append(s+field.from, (size_t)(field.to-field.from));
+      buf.append(s+field.tail_from, (size_t)(field.tail_to-field.tail_from));
+      return Rf_mkCharLenCE(buf.data(), (int)buf.size(), CE_UTF8);
+   }
+};
+
+
+/**
+ * Get a single ASCII character argument
+ *
+ * WARNING: this fuction is allowed to call the error() function.
+ * Use before STRI__ERROR_HANDLER_BEGIN (with other prepareargs).
+ *
+ * @param x R object to be checked/coerced
+ * @param argname argument name (message formatting)
+ * @param allowna do we allow \code{NA}? (then -1 is returned)
+ * @return character code
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-27)
+ */
+int stri__prepare_arg_records_char(SEXP x, const char* argname, bool allowna)
+{
+   PROTECT(x = stri_prepare_arg_string_1(x, argname));
+   SEXP cx = STRING_ELT(x, 0);
+   UNPROTECT(1);
+
+   if (cx == NA_STRING) {
+      if (!allowna)
+         Rf_error(MSG__ARG_EXPECTED_NOT_NA, argname); // allowed here
+      return -1;
+   }
+
+   if (LENGTH(cx) != 1 || (unsigned char)(CHAR(cx)[0]) >= 128
+         || CHAR(cx)[0] == ASCII_CR || CHAR(cx)[0] == ASCII_LF)
+      Rf_error(MSG__EXPECTED_ASCII_CHAR, argname); // allowed here
+
+   return (int)CHAR(cx)[0];
+}
+
+
+/**
+ * Split delimited text records into columns
+ *
+ * Each string may consist of many records separated by LF, CR, or CRLF.
+ * Quoted fields may include field delimiters and newlines.
+ *
+ * The input is scanned twice: first we determine the number of records
+ * and columns, and then we fill the preallocated columns.
+ *
+ * @param str character vector
+ * @param sep single ASCII character; field delimiter
+ * @param quote single ASCII character or NA; quote character
+ * @param escape single ASCII character or NA; escape character,
+ *    quote to indicate that quotes are doubled
+ *
+ * @return list of character vectors
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-27)
+ */
+SEXP stri_split_records(SEXP str, SEXP sep, SEXP quote, SEXP escape)
+{
+   int sep_c    = stri__prepare_arg_records_char(sep, "sep", false);
+   int quote_c  = stri__prepare_arg_records_char(quote, "quote", true);
+   int escape_c = stri__prepare_arg_records_char(escape, "escape", true);
+   if (sep_c == quote_c)
+      Rf_error(MSG__ARG_EXCLUSIVE, "sep", "quote");
+   if (sep_c == escape_c)
+      Rf_error(MSG__ARG_EXCLUSIVE, "sep", "escape");
+   if (quote_c < 0)
+      escape_c = -1;
+
+   PROTECT(str = stri_prepare_arg_string(str, "str"));
+   R_len_t str_length = LENGTH(str);
+
+   STRI__ERROR_HANDLER_BEGIN(1)
+   StriContainerUTF8 str_cont(str, str_length);
+   StriRecordsScanner scanner(sep_c, quote_c, escape_c);
+   StriRecordsField field;
+
+   // 1st pass: count records and fields
+   R_len_t nrecords = 0;
+   R_len_t ncolumns = 0;
+   for (R_len_t i=0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         ++nrecords;
+         continue;
+      }
+
+      const char* str_cur_s = str_cont.get(i).c_str();
+      R_len_t str_cur_n = str_cont.get(i).length();
+      R_len_t j = 0;
+      while (scanner.skipEmptyLines(str_cur_s, str_cur_n, j)) {
+         R_len_t k = 1;
+         while (scanner.nextField(str_cur_s, str_cur_n, j, field))
+            ++k;
+         if (k > ncolumns) ncolumns = k;
+         ++nrecords;
+      }
+   }
+
+   if (nrecords > 0 && ncolumns == 0)
+      ncolumns = 1; // all strings are NA
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, ncolumns));
+   std::vector<SEXP> columns(ncolumns);
+   for (R_len_t k=0; k<ncolumns; ++k) {
+      SEXP col;
+      SET_VECTOR_ELT(ret, k, col = Rf_allocVector(STRSXP, nrecords));
+      columns[k] = col;
+   }
+
+   // 2nd pass: fill the columns
+   std::string buf;
+   R_len_t r = 0;
+   for (R_len_t i=0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         for (R_len_t k=0; k<ncolumns; ++k)
+            SET_STRING_ELT(columns[k], r, NA_STRING);
+         ++r;
+         continue;
+      }
+
+      const char* str_cur_s = str_cont.get(i).c_str();
+      R_len_t str_cur_n = str_cont.get(i).length();
+      R_len_t j = 0;
+      while (scanner.skipEmptyLines(str_cur_s, str_cur_n, j)) {
+         R_len_t k = 0;
+         bool more;
+         do {
+            more = scanner.nextField(str_cur_s, str_cur_n, j, field);
+            SET_STRING_ELT(columns[k++], r, scanner.mkField(str_cur_s, field, buf));
+         } while (more);
+         for (; k<ncolumns; ++k) // missing trailing fields
+            SET_STRING_ELT(columns[k], r, NA_STRING);
+         ++r;
+      }
+   }
+
+   STRI__UNPROTECT_ALL
+   return ret;
+
+   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
+}
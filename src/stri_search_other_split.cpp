@@ -37,13 +37,72 @@
 #include "stri_container_bytesearch.h"
 #include "stri_container_integer.h"
 #include "stri_container_logical.h"
-#include <deque>
+#include <vector>
+#include <cstring>
 #include <utility>
 #include <unicode/brkiter.h>
 #include <unicode/rbbi.h>
 using namespace std;
 
 
+/**
+ * Find the next line terminator in a UTF-8 string
+ *
+ * Recognized terminators: LF, CR, CRLF, VT, FF, NEL, LS, PS.
+ * Only bytes 0x0A-0x0D, 0xC2 (NEL's lead), and 0xE2 (LS' and PS' lead)
+ * may start a terminator. These are looked for 8 bytes at a time,
+ * hence no code points need to be decoded in-between.
+ *
+ * @param s string
+ * @param j byte index to start at
+ * @param n number of bytes in s
+ * @param nl_end [out] byte index just past the terminator found
+ * @return byte index of the terminator found, n if there is none
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-12)
+ */
+static R_len_t stri__split_lines_next(const char* s, R_len_t j, R_len_t n, R_len_t& nl_end)
+{
+   while (true) {
+      for (; j+8 <= n; j += 8) {
+         uint64_t x;
+         memcpy(&x, s+j, 8);
+         if (STRI__SWAR_HAS_BETWEEN(x, ASCII_LF-1, ASCII_CR+1)
+               || STRI__SWAR_HAS_BYTE(x, 0xC2)
+               || STRI__SWAR_HAS_BYTE(x, 0xE2))
+            break; // there is a candidate byte in s[j..j+7]
+      }
+
+      R_len_t jend = (j+8 <= n) ? j+8 : n;
+      for (; j < jend; ++j) {
+         uint8_t b = (uint8_t)s[j];
+         if (b >= ASCII_LF && b <= ASCII_CR) {
+            nl_end = (b == ASCII_CR && j+1 < n && s[j+1] == ASCII_LF) ? j+2 : j+1;
+            return j;
+         }
+         else if (b == 0xC2) {  // NEL = C2 85
+            if (j+1 < n && (uint8_t)s[j+1] == 0x85) {
+               nl_end = j+2;
+               return j;
+            }
+         }
+         else if (b == 0xE2) {  // LS = E2 80 A8, PS = E2 80 A9
+            if (j+2 < n && (uint8_t)s[j+1] == 0x80
+                  && ((uint8_t)s[j+2] == 0xA8 || (uint8_t)s[j+2] == 0xA9)) {
+               nl_end = j+3;
+               return j;
+            }
+         }
+      }
+
+      if (j >= n) {
+         nl_end = n;
+         return n;
+      }
+   }
+}
+
+
 /**
  * Split a single string into text lines
  *
@@ -55,6 +114,10 @@ using namespace std;
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-05)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-12)
+ *    use stri__split_lines_next(); line boundaries are stored
+ *    in a flat array and the output is allocated once
  */
 SEXP stri_split_lines1(SEXP str)
 {
@@ -72,58 +135,23 @@ SEXP stri_split_lines1(SEXP str)
    const char* str_cur_s = str_cont.get(0).c_str();
    R_len_t str_cur_n = str_cont.get(0).length();
 
-   UChar32 c;
-   R_len_t jlast;
-   deque< pair<R_len_t, R_len_t> > occurrences;
-   occurrences.push_back(pair<R_len_t, R_len_t>(0, 0));
-   for (R_len_t j=0; j < str_cur_n; /* null */) {
-      jlast = j;
-      U8_NEXT(str_cur_s, j, str_cur_n, c);
-
-      switch (c) {
-         case ASCII_CR: /* CR */
-            /* check if next is LF */
-            if (str_cur_s[j] == ASCII_LF) { // look ahead one byte
-               j++; // just one byte
-            }
-            break;
-
-         case ASCII_LF: /* LF */
-            break;
-
-         case UCHAR_NEL: /* NEL */
-            break;
-
-         case ASCII_VT: /* VT */
-            break;
-
-         case ASCII_FF: /* FF */
-            break;
-
-         case UCHAR_LS: /* LS */
-            break;
-
-         case UCHAR_PS: /* PS */
-            break;
-
-         default:
-            /* not a newline character */
-            occurrences.back().second = j;
-            continue;
-      }
-
-      occurrences.back().second = jlast;
-      if (j < str_cur_n)
-         occurrences.push_back(pair<R_len_t, R_len_t>(j, j));
-   }
-
+   // bounds[2*k], bounds[2*k+1] - start and end of the k-th line
+   std::vector<R_len_t> bounds;
+   R_len_t j = 0;
+   do {
+      R_len_t nl_end;
+      R_len_t nl_start = stri__split_lines_next(str_cur_s, j, str_cur_n, nl_end);
+      bounds.push_back(j);
+      bounds.push_back(nl_start);
+      j = nl_end;
+   } while (j < str_cur_n);
+
+   R_len_t nlines = (R_len_t)(bounds.size()/2);
    SEXP ans;
-   STRI__PROTECT(ans = Rf_allocVector(STRSXP, (R_len_t)occurrences.size()));
-   deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
-   for (R_len_t k = 0; iter != occurrences.end(); ++iter, ++k) {
-      pair<R_len_t, R_len_t> curoccur = *iter;
-      SET_STRING_ELT(ans, k,
-         Rf_mkCharLenCE(str_cur_s+curoccur.first, curoccur.second-curoccur.first, CE_UTF8));
+   STRI__PROTECT(ans = Rf_allocVector(STRSXP, nlines));
+   for (R_len_t k = 0; k < nlines; ++k) {
+      SET_STRING_ELT(ans, k, Rf_mkCharLenCE(str_cur_s+bounds[2*k],
+         bounds[2*k+1]-bounds[2*k], CE_UTF8));
    }
    STRI__UNPROTECT_ALL
    return ans;
@@ -147,22 +175,26 @@ SEXP stri_split_lines1(SEXP str)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-05)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-12)
+ *    use stri__split_lines_next(); line boundaries are stored
+ *    in a flat array (reused across strings)
  */
 SEXP stri_split_lines(SEXP str, SEXP omit_empty)
 {
    PROTECT(str = stri_prepare_arg_string(str, "str"));
-//   n_max = stri_prepare_arg_integer(n_max, "n_max");
    PROTECT(omit_empty = stri_prepare_arg_logical(omit_empty, "omit_empty"));
-   R_len_t vectorize_length = stri__recycling_rule(true, 2, LENGTH(str), /*LENGTH(n_max), */LENGTH(omit_empty));
+   R_len_t vectorize_length = stri__recycling_rule(true, 2, LENGTH(str), LENGTH(omit_empty));
 
    STRI__ERROR_HANDLER_BEGIN(2)
    StriContainerUTF8 str_cont(str, vectorize_length);
-//   StriContainerInteger   n_max_cont(n_max, vectorize_length);
    StriContainerLogical   omit_empty_cont(omit_empty, vectorize_length);
 
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
 
+   // bounds[2*k], bounds[2*k+1] - start and end of the k-th line
+   std::vector<R_len_t> bounds;
    for (R_len_t i = str_cont.vectorize_init();
          i != str_cont.vectorize_end();
          i = str_cont.vectorize_next(i))
@@ -174,102 +206,27 @@ SEXP stri_split_lines(SEXP str, SEXP omit_empty)
 
       const char* str_cur_s = str_cont.get(i).c_str();
       R_len_t str_cur_n = str_cont.get(i).length();
-//      int  n_max_cur        = n_max_cont.get(i);
       int  omit_empty_cur   = omit_empty_cont.get(i);
 
-//      if (n_max_cur < 0)
-//         n_max_cur = INT_MAX;
-//      else if (n_max_cur == 0) {
-//         SET_VECTOR_ELT(ret, i, Rf_allocVector(STRSXP, 0));
-//         continue;
-//      }
-
-//#define STRI_INDEX_NEWLINE_CR   0
-//#define STRI_INDEX_NEWLINE_LF   1
-//#define STRI_INDEX_NEWLINE_CRLF 2
-//#define STRI_INDEX_NEWLINE_NEL  3
-//#define STRI_INDEX_NEWLINE_VT   4
-//#define STRI_INDEX_NEWLINE_FF   5
-//#define STRI_INDEX_NEWLINE_LS   6
-//#define STRI_INDEX_NEWLINE_PS   7
-//#define STRI_INDEX_NEWLINE_LAST 8
-
-//      int counts[STRI_INDEX_NEWLINE_LAST];
-//      for (R_len_t j=0; j<STRI_INDEX_NEWLINE_LAST; ++j)
-//         counts[j] = 0;
-
-      UChar32 c;
-      R_len_t jlast, k=1;
-      deque< pair<R_len_t, R_len_t> > occurrences;
-      occurrences.push_back(pair<R_len_t, R_len_t>(0, 0));
-      for (R_len_t j=0; j < str_cur_n /*&& k < n_max_cur*/; /* null */) {
-         jlast = j;
-         U8_NEXT(str_cur_s, j, str_cur_n, c);
-
-         switch (c) {
-            case ASCII_CR: /* CR */
-//               counts[STRI_INDEX_NEWLINE_CR]++;
-               /* check if next is LF */
-               if (str_cur_s[j] == ASCII_LF) { // look ahead one byte
-//                  counts[STRI_INDEX_NEWLINE_LF]++;
-//                  counts[STRI_INDEX_NEWLINE_CRLF]++;
-                  j++; // just one byte
-               }
-               break;
-
-            case ASCII_LF: /* LF */
-//               counts[STRI_INDEX_NEWLINE_LF]++;
-               break;
-
-            case UCHAR_NEL: /* NEL */
-//               counts[STRI_INDEX_NEWLINE_NEL]++;
-               break;
-
-            case ASCII_VT: /* VT */
-//               counts[STRI_INDEX_NEWLINE_VT]++;
-               break;
-
-            case ASCII_FF: /* FF */
-//               counts[STRI_INDEX_NEWLINE_FF]++;
-               break;
-
-            case UCHAR_LS: /* LS */
-//               counts[STRI_INDEX_NEWLINE_LS]++;
-               break;
-
-            case UCHAR_PS: /* PS */
-//               counts[STRI_INDEX_NEWLINE_PS]++;
-               break;
-
-            default:
-               /* not a newline character */
-               occurrences.back().second = j;
-               continue;
-         }
-
-         // if here, then at newline
-         if (omit_empty_cur && occurrences.back().second == occurrences.back().first)
-            occurrences.back().first = occurrences.back().second = j; // don't start any new field
-         else {
-            occurrences.back().second = jlast;
-            occurrences.push_back(pair<R_len_t, R_len_t>(j, j));
-            ++k; // another field
+      bounds.clear();
+      R_len_t j = 0;
+      while (true) {
+         R_len_t nl_end;
+         R_len_t nl_start = stri__split_lines_next(str_cur_s, j, str_cur_n, nl_end);
+         if (!omit_empty_cur || nl_start > j) {
+            bounds.push_back(j);
+            bounds.push_back(nl_start);
          }
+         if (nl_start >= str_cur_n) break; // no more terminators
+         j = nl_end;
       }
 
-//      if (k == n_max_cur)
-//         occurrences.back().second = str_cur_n;
-      if (omit_empty_cur && occurrences.back().first == occurrences.back().second)
-         occurrences.pop_back();
-
+      R_len_t nlines = (R_len_t)(bounds.size()/2);
       SEXP ans;
-      STRI__PROTECT(ans = Rf_allocVector(STRSXP, (R_len_t)occurrences.size()));
-
-      deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
-      for (R_len_t l = 0; iter != occurrences.end(); ++iter, ++l) {
-         pair<R_len_t, R_len_t> curoccur = *iter;
-         SET_STRING_ELT(ans, l,
-            Rf_mkCharLenCE(str_cur_s+curoccur.first, curoccur.second-curoccur.first, CE_UTF8));
+      STRI__PROTECT(ans = Rf_allocVector(STRSXP, nlines));
+      for (R_len_t k = 0; k < nlines; ++k) {
+         SET_STRING_ELT(ans, k, Rf_mkCharLenCE(str_cur_s+bounds[2*k],
+            bounds[2*k+1]-bounds[2*k], CE_UTF8));
       }
 
       SET_VECTOR_ELT(ret, i, ans);
@@ -33,6 +33,7 @@
 #include "stri_stringi.h"
 #include "stri_container_utf16.h"
 #include "stri_container_regex.h"
+#include "stri_locate_flat.h"
 #include <deque>
 #include <utility>
 using namespace std;
@@ -43,7 +44,10 @@ using namespace std;
  * @param str character vector
  * @param pattern character vector
  * @param opts_regex list
- * @return list of integer matrices (2 columns)
+ * @param units single string; "chars" or "bytes"
+ * @param output single string; "list" or "flat"
+ * @return list of integer matrices (2 columns) or, for output="flat",
+ *    a list of 3 integer vectors (id, start, end)
  *
  * @version 0.1-?? (Bartek Tartanus)
  *
@@ -61,12 +65,18 @@ using namespace std;
  *
  * @version 1.0-2 (Marek Gagolewski, 2016-01-29)
  *    Issue #214: allow a regex pattern like `.*`  to match an empty string
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units and output args added
  */
-SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_regex)
+SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts_regex,
+   SEXP units, SEXP output)
 {
    // ??? @TODO: capture_group arg (integer vector which capture group to locate) ???
    // ??? OR introduce stri_matchpos_*_regex ???
    bool omit_no_match1 = stri__prepare_arg_logical_1_notNA(omit_no_match, "omit_no_match");
+   bool units_bytes = stri__locate_get_units_bytes(units);
+   bool output_flat = stri__locate_get_output_flat(output);
    uint32_t pattern_flags = StriContainerRegexPattern::getRegexFlags(opts_regex);
    PROTECT(str = stri_prepare_arg_string(str, "str")); // prepare string argument
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern")); // prepare string argument
@@ -77,20 +87,23 @@ SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
    StriContainerRegexPattern pattern_cont(pattern, vectorize_length, pattern_flags);
 
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(VECSXP, vectorize_length));
+   STRI__PROTECT(ret = Rf_allocVector(VECSXP, output_flat?0:vectorize_length));
+   StriLocateFlat flat;
 
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
    {
       STRI__CONTINUE_ON_EMPTY_OR_NA_PATTERN(str_cont, pattern_cont,
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));)
+         if (output_flat) flat.pushNA(i);
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(1, 2));)
 
       RegexMatcher *matcher = pattern_cont.getMatcher(i); // will be deleted automatically
       matcher->reset(str_cont.get(i));
       int found = (int)matcher->find();
       if (!found) {
-         SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
+         if (output_flat) { if (!omit_no_match1) flat.pushNA(i); }
+         else SET_VECTOR_ELT(ret, i, stri__matrix_NA_INTEGER(omit_no_match1?0:1, 2));
          continue;
       }
 
@@ -106,24 +119,46 @@ SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
       } while (found);
 
       R_len_t noccurrences = (R_len_t)occurrences.size();
-      SEXP ans;
-      STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
-      int* ans_tab = INTEGER(ans);
+      SEXP ans = R_NilValue;
+      int* ans_start;
+      int* ans_end;
+      if (output_flat) {
+         R_len_t k = flat.append(i, noccurrences);
+         ans_start = flat.getStart(k);
+         ans_end   = flat.getEnd(k);
+      }
+      else {
+         STRI__PROTECT(ans = Rf_allocMatrix(INTSXP, noccurrences, 2));
+         ans_start = INTEGER(ans);
+         ans_end   = ans_start+noccurrences;
+      }
       deque< pair<R_len_t, R_len_t> >::iterator iter = occurrences.begin();
       for (R_len_t j = 0; iter != occurrences.end(); ++iter, ++j) {
          pair<R_len_t, R_len_t> match = *iter;
-         ans_tab[j]             = match.first;
-         ans_tab[j+noccurrences] = match.second;
+         ans_start[j] = match.first;
+         ans_end[j]   = match.second;
       }
 
-      // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-      str_cont.UChar16_to_UChar32_index(i, ans_tab,
-            ans_tab+noccurrences, noccurrences,
+      if (units_bytes) // Adjust UChar index -> UTF-8 byte index
+         str_cont.UChar16_to_UTF8_index(i, ans_start, ans_end, noccurrences,
+            1, // 0-based index -> 1-based
+            0  // end returns position of next byte after match
+         );
+      else // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
+         str_cont.UChar16_to_UChar32_index(i, ans_start, ans_end, noccurrences,
             1, // 0-based index -> 1-based
             0  // end returns position of next character after match
-      );
-      SET_VECTOR_ELT(ret, i, ans);
-      STRI__UNPROTECT(1);
+         );
+
+      if (!output_flat) {
+         SET_VECTOR_ELT(ret, i, ans);
+         STRI__UNPROTECT(1);
+      }
+   }
+
+   if (output_flat) {
+      STRI__UNPROTECT_ALL
+      return flat.toR();
    }
 
    stri__locate_set_dimnames_list(ret);
@@ -138,7 +173,8 @@ SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
  * @param str character vector
  * @param pattern character vector
  * @param opts_regex list
- * @param firs logical - search for the first or the last occurrence?
+ * @param units single string; "chars" or "bytes"
+ * @param first logical - search for the first or the last occurrence?
  * @return list of integer matrices (2 columns)
  *
  * @version 0.1-?? (Bartek Tartanus)
@@ -154,9 +190,13 @@ SEXP stri_locate_all_regex(SEXP str, SEXP pattern, SEXP omit_no_match, SEXP opts
  *
  * @version 1.0-2 (Marek Gagolewski, 2016-01-29)
  *    Issue #214: allow a regex pattern like `.*`  to match an empty string
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri__locate_firstlast_regex(SEXP str, SEXP pattern, SEXP opts_regex, bool first)
+SEXP stri__locate_firstlast_regex(SEXP str, SEXP pattern, SEXP opts_regex, SEXP units, bool first)
 {
+   bool units_bytes = stri__locate_get_units_bytes(units);
    PROTECT(str = stri_prepare_arg_string(str, "str")); // prepare string argument
    PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern")); // prepare string argument
    R_len_t vectorize_length = stri__recycling_rule(true, 2, LENGTH(str), LENGTH(pattern));
@@ -202,12 +242,18 @@ SEXP stri__locate_firstlast_regex(SEXP str, SEXP pattern, SEXP opts_regex, bool
          }
       }
 
-      // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
-      str_cont.UChar16_to_UChar32_index(i,
-            ret_tab+i, ret_tab+i+vectorize_length, 1,
-            1, // 0-based index -> 1-based
-            0  // end returns position of next character after match
-      );
+      if (units_bytes) // Adjust UChar index -> UTF-8 byte index
+         str_cont.UChar16_to_UTF8_index(i,
+               ret_tab+i, ret_tab+i+vectorize_length, 1,
+               1, // 0-based index -> 1-based
+               0  // end returns position of next byte after match
+         );
+      else // Adjust UChar index -> UChar32 index (1-2 byte UTF16 to 1 byte UTF32-code points)
+         str_cont.UChar16_to_UChar32_index(i,
+               ret_tab+i, ret_tab+i+vectorize_length, 1,
+               1, // 0-based index -> 1-based
+               0  // end returns position of next character after match
+         );
    }
 
    stri__locate_set_dimnames_matrix(ret);
@@ -222,6 +268,7 @@ SEXP stri__locate_firstlast_regex(SEXP str, SEXP pattern, SEXP opts_regex, bool
  * @param str character vector
  * @param pattern character vector
  * @param opts_regex list
+ * @param units single string; "chars" or "bytes"
  * @return list of integer matrices (2 columns)
  *
  * @version 0.1-?? (Bartek Tartanus)
@@ -231,10 +278,13 @@ SEXP stri__locate_firstlast_regex(SEXP str, SEXP pattern, SEXP opts_regex, bool
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-19)
  *          Use StriContainerRegexPattern + opts_regex
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex)
+SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex, SEXP units)
 {
-   return stri__locate_firstlast_regex(str, pattern, opts_regex, true);
+   return stri__locate_firstlast_regex(str, pattern, opts_regex, units, true);
 }
 
 
@@ -242,6 +292,7 @@ SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex)
  * @param str character vector
  * @param pattern character vector
  * @param opts_regex list
+ * @param units single string; "chars" or "bytes"
  * @return list of integer matrices (2 columns)
  *
  * @version 0.1-?? (Bartlomiej Tartanus, 2013-06-10)
@@ -249,8 +300,11 @@ SEXP stri_locate_first_regex(SEXP str, SEXP pattern, SEXP opts_regex)
  *
  * @version 0.1-?? (Marek Gagolewski, 2013-06-19)
  *          Use StriContainerRegexPattern + opts_regex
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-13)
+ *    units arg added
  */
-SEXP stri_locate_last_regex(SEXP str, SEXP pattern, SEXP opts_regex)
+SEXP stri_locate_last_regex(SEXP str, SEXP pattern, SEXP opts_regex, SEXP units)
 {
-   return stri__locate_firstlast_regex(str, pattern, opts_regex, false);
+   return stri__locate_firstlast_regex(str, pattern, opts_regex, units, false);
 }
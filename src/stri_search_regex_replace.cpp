@@ -33,6 +33,7 @@
 #include "stri_stringi.h"
 #include "stri_container_utf16.h"
 #include "stri_container_regex.h"
+#include "stri_memo.h"
 
 
 /**
@@ -63,6 +64,9 @@
  *
  * @version 1.0-2 (Marek Gagolewski, 2016-01-30)
  *    Issue #210: Allow NA replacement
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-10)
+ *    memoize the results for duplicated strings (fixed pattern and replacement)
  */
 SEXP stri__replace_allfirstlast_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_regex, int type)
 {
@@ -80,6 +84,10 @@ SEXP stri__replace_allfirstlast_regex(SEXP str, SEXP pattern, SEXP replacement,
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(STRSXP, vectorize_length));
 
+   // duplicated strings may be looked up only if pattern and replacement are fixed
+   R_len_t str_n = LENGTH(str);
+   StriMemo<SEXP> memo((LENGTH(pattern) == 1 && LENGTH(replacement) == 1)?vectorize_length:0, str);
+
    for (R_len_t i = pattern_cont.vectorize_init();
          i != pattern_cont.vectorize_end();
          i = pattern_cont.vectorize_next(i))
@@ -87,6 +95,13 @@ SEXP stri__replace_allfirstlast_regex(SEXP str, SEXP pattern, SEXP replacement,
       STRI__CONTINUE_ON_EMPTY_OR_NA_PATTERN(str_cont, pattern_cont,
          SET_STRING_ELT(ret, i, NA_STRING);)
 
+      SEXP str_orig = STRING_ELT(str, i%str_n);
+      SEXP memo_val;
+      if (memo.get(str_orig, memo_val)) {
+         SET_STRING_ELT(ret, i, memo_val);
+         continue;
+      }
+
       RegexMatcher *matcher = pattern_cont.getMatcher(i); // will be deleted automatically
       matcher->reset(str_cont.get(i));
 
@@ -94,6 +109,7 @@ SEXP stri__replace_allfirstlast_regex(SEXP str, SEXP pattern, SEXP replacement,
          if (matcher->find())
             str_cont.setNA(i);
          SET_STRING_ELT(ret, i, str_cont.toR(i));
+         memo.set(str_orig, STRING_ELT(ret, i));
          continue;
       }
 
@@ -130,6 +146,7 @@ SEXP stri__replace_allfirstlast_regex(SEXP str, SEXP pattern, SEXP replacement,
       }
 
       SET_STRING_ELT(ret, i, str_cont.toR(i));
+      memo.set(str_orig, STRING_ELT(ret, i));
    }
 
    STRI__UNPROTECT_ALL
@@ -278,6 +295,9 @@ SEXP stri__replace_all_regex_no_vectorize_all(SEXP str, SEXP pattern, SEXP repla
  */
 SEXP stri_replace_all_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP vectorize_all, SEXP opts_regex)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_all_regex(str, pattern, replacement, vectorize_all, opts_regex))
+
    if (stri__prepare_arg_logical_1_notNA(vectorize_all, "vectorize_all"))
       return stri__replace_allfirstlast_regex(str, pattern, replacement, opts_regex, 0);
    else
@@ -298,6 +318,9 @@ SEXP stri_replace_all_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP vecto
  */
 SEXP stri_replace_first_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_regex)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_first_regex(str, pattern, replacement, opts_regex))
+
    return stri__replace_allfirstlast_regex(str, pattern, replacement, opts_regex, 1);
 }
 
@@ -315,5 +338,8 @@ SEXP stri_replace_first_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP opt
  */
 SEXP stri_replace_last_regex(SEXP str, SEXP pattern, SEXP replacement, SEXP opts_regex)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, Rf_length(pattern) == 1 && Rf_length(replacement) == 1,
+      stri_replace_last_regex(str, pattern, replacement, opts_regex))
+
    return stri__replace_allfirstlast_regex(str, pattern, replacement, opts_regex, -1);
 }
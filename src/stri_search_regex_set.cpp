@@ -0,0 +1,526 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "stri_stringi.h"
+#include "stri_container_utf16.h"
+#include "stri_container_regex.h"
+#include <vector>
+
+
+/** Get a literal substring that each match of a regex must contain [internal]
+ *
+ * The pattern is scanned conservatively: only the top-level
+ * (not parenthesized) concatenation is considered; any top-level
+ * alternation, inline flags, or a construct not recognized
+ * gives no literal at all. Of all the literal runs found,
+ * the longest one is returned.
+ *
+ * @param pattern regex
+ * @param flags regex flags
+ * @param literal [out] empty if there is no such literal
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+static void stri__regex_required_literal(const UnicodeString& pattern,
+   uint32_t flags, std::vector<UChar>& literal)
+{
+   literal.clear();
+   if (flags & (UREGEX_CASE_INSENSITIVE|UREGEX_COMMENTS))
+      return;
+
+   const UChar* p = pattern.getBuffer();
+   R_len_t n = pattern.length();
+   if (flags & UREGEX_LITERAL) {
+      literal.assign(p, p+n);
+      return;
+   }
+
+   std::vector<UChar> best;
+   std::vector<UChar> cur;
+   R_len_t lastlen = 0; // number of code units of the last code point in cur
+   R_len_t depth = 0;   // parentheses
+
+#define STRI__REGEX_LITERAL_FLUSH \
+   { if (cur.size() > best.size()) best.swap(cur); cur.clear(); lastlen = 0; }
+
+   R_len_t j = 0;
+   while (j < n) {
+      UChar c = p[j];
+
+      if (depth > 0) {
+         // skip everything within parentheses
+         if (c == (UChar)'\\') {
+            if (j+1 < n && p[j+1] == (UChar)'Q') return;
+            j += 2;
+         }
+         else if (c == (UChar)'[') {
+            R_len_t bracket = 1;
+            if (j+1 < n && p[j+1] == (UChar)'^') ++j;
+            if (j+1 < n && p[j+1] == (UChar)']') return;
+            for (++j; j < n && bracket > 0; ++j) {
+               if (p[j] == (UChar)'\\') ++j;
+               else if (p[j] == (UChar)'[') ++bracket;
+               else if (p[j] == (UChar)']') --bracket;
+            }
+         }
+         else {
+            if (c == (UChar)'(') {
+               if (j+2 < n && p[j+1] == (UChar)'?' && p[j+2] == (UChar)'#') {
+                  while (j < n && p[j] != (UChar)')') ++j;
+                  if (j >= n) return;
+               }
+               else
+                  ++depth;
+            }
+            else if (c == (UChar)')') --depth;
+            ++j;
+         }
+         continue;
+      }
+
+      switch (c) {
+         case (UChar)'|':
+            return; // top-level alternation
+
+         case (UChar)'?':
+         case (UChar)'*':
+         case (UChar)'{':
+            // the preceding code point is optional
+            cur.resize(cur.size()-lastlen);
+            STRI__REGEX_LITERAL_FLUSH
+            if (c == (UChar)'{') {
+               while (j < n && p[j] != (UChar)'}') ++j;
+               if (j >= n) return;
+            }
+            ++j;
+            break;
+
+         case (UChar)'+':
+            // the preceding code point occurs at least once
+            STRI__REGEX_LITERAL_FLUSH
+            ++j;
+            break;
+
+         case (UChar)'(':
+            if (j+2 < n && p[j+1] == (UChar)'?' && p[j+2] == (UChar)'#') {
+               // a comment is ignored altogether: a quantifier that follows
+               // applies to the preceding atom, so cur and lastlen are kept
+               while (j < n && p[j] != (UChar)')') ++j;
+               if (j >= n) return;
+               ++j;
+               break;
+            }
+            STRI__REGEX_LITERAL_FLUSH
+            if (j+1 < n && p[j+1] == (UChar)'?') {
+               if (j+2 >= n) return;
+               UChar c2 = p[j+2];
+               if (c2 != (UChar)':' && c2 != (UChar)'=' && c2 != (UChar)'!' &&
+                     c2 != (UChar)'<' && c2 != (UChar)'>')
+                  return; // inline flags, e.g., (?i)
+            }
+            ++depth;
+            ++j;
+            break;
+
+         case (UChar)'[': {
+            STRI__REGEX_LITERAL_FLUSH
+            R_len_t bracket = 1;
+            if (j+1 < n && p[j+1] == (UChar)'^') ++j;
+            if (j+1 < n && p[j+1] == (UChar)']') return;
+            for (++j; j < n && bracket > 0; ++j) {
+               if (p[j] == (UChar)'\\') ++j;
+               else if (p[j] == (UChar)'[') ++bracket;
+               else if (p[j] == (UChar)']') --bracket;
+            }
+            if (bracket > 0) return;
+            break;
+         }
+
+         case (UChar)')':
+         case (UChar)']':
+         case (UChar)'}':
+            return; // unbalanced, let ICU deal with it
+
+         case (UChar)'.':
+         case (UChar)'^':
+         case (UChar)'$':
+            STRI__REGEX_LITERAL_FLUSH
+            ++j;
+            break;
+
+         case (UChar)'\\':
+            if (j+1 >= n) return;
+            c = p[j+1];
+            if (c < 128 && !isalnum((int)c)) {
+               // an escaped ASCII punctuation character
+               cur.push_back(c);
+               lastlen = 1;
+            }
+            else if (c >= 128 || strchr("dDwWsSbBhHvVRXAZzGntrfae", (char)c))
+               STRI__REGEX_LITERAL_FLUSH // no argument follows
+            else
+               return; // \Q, \xhh, \uhhhh, \0ooo, \cX, \k<name>, \p{...}, \1, ...
+            j += 2;
+            break;
+
+         default:
+            if (U16_IS_LEAD(c) && j+1 < n && U16_IS_TRAIL(p[j+1])) {
+               cur.push_back(c);
+               cur.push_back(p[j+1]);
+               lastlen = 2;
+               j += 2;
+            }
+            else {
+               cur.push_back(c);
+               lastlen = 1;
+               ++j;
+            }
+      }
+   }
+
+   if (depth != 0) return;
+   STRI__REGEX_LITERAL_FLUSH
+   literal.swap(best);
+#undef STRI__REGEX_LITERAL_FLUSH
+}
+
+
+/** An Aho-Corasick automaton over UTF-16 code units [internal]
+ *
+ * The goto function is stored in an open-addressing (linear probing)
+ * hash table keyed by (node, code unit). Node 0 is the root.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+class StriAhoCorasick {
+private:
+   struct Slot {
+      uint64_t key;  // (parent << 16) | code unit
+      R_len_t child; // < 0 for an empty slot
+   };
+
+   std::vector<Slot> slots;
+   size_t mask;
+   std::vector<R_len_t> parent;
+   std::vector<UChar> label;
+   std::vector<R_len_t> depth;
+   std::vector<bool> terminal;
+   std::vector<R_len_t> fail;
+   std::vector<R_len_t> dict;  // nearest terminal node on the fail chain or 0
+
+   static inline size_t hash(uint64_t key) {
+      key *= 0x9E3779B97F4A7C15ULL;
+      return (size_t)(key ^ (key >> 32));
+   }
+
+   inline size_t find(uint64_t key) const {
+      size_t k = hash(key) & mask;
+      while (slots[k].child >= 0 && slots[k].key != key)
+         k = (k+1) & mask;
+      return k;
+   }
+
+   inline R_len_t next(R_len_t node, UChar c) const {
+      return slots[find(((uint64_t)node << 16) | c)].child;
+   }
+
+public:
+   /** @param max_nodes upper bound for the number of nodes (edges+1) */
+   StriAhoCorasick(size_t max_nodes) {
+      size_t capacity = 16;
+      while (capacity < 2*max_nodes) capacity *= 2; // load factor <= 0.5
+      Slot empty = { 0, -1 };
+      slots.assign(capacity, empty);
+      mask = capacity-1;
+      parent.push_back(-1);
+      label.push_back(0);
+      depth.push_back(0);
+      terminal.push_back(false);
+   }
+
+   /** add a non-empty key
+    *  @return the key's node id (> 0), the same for equal keys */
+   R_len_t insert(const UChar* s, size_t n) {
+      R_len_t node = 0;
+      for (size_t j=0; j<n; ++j) {
+         uint64_t key = ((uint64_t)node << 16) | s[j];
+         size_t k = find(key);
+         if (slots[k].child < 0) {
+            slots[k].key = key;
+            slots[k].child = (R_len_t)parent.size();
+            parent.push_back(node);
+            label.push_back(s[j]);
+            depth.push_back(depth[node]+1);
+            terminal.push_back(false);
+         }
+         node = slots[k].child;
+      }
+      terminal[node] = true;
+      return node;
+   }
+
+   /** compute the failure links; call after all the keys are inserted */
+   void build() {
+      R_len_t nnodes = (R_len_t)parent.size();
+      R_len_t maxdepth = 0;
+      for (R_len_t v=0; v<nnodes; ++v)
+         if (depth[v] > maxdepth) maxdepth = depth[v];
+
+      // order the nodes by depth (breadth-first), counting sort
+      std::vector<R_len_t> count(maxdepth+2, 0);
+      for (R_len_t v=0; v<nnodes; ++v) ++count[depth[v]+1];
+      for (R_len_t d=1; d<=maxdepth+1; ++d) count[d] += count[d-1];
+      std::vector<R_len_t> order(nnodes);
+      for (R_len_t v=0; v<nnodes; ++v) order[count[depth[v]]++] = v;
+
+      fail.assign(nnodes, 0);
+      dict.assign(nnodes, 0);
+      for (R_len_t k=1; k<nnodes; ++k) {
+         R_len_t v = order[k];
+         if (parent[v] != 0) {
+            R_len_t f = fail[parent[v]];
+            R_len_t w;
+            while ((w = next(f, label[v])) < 0 && f != 0)
+               f = fail[f];
+            fail[v] = (w >= 0)?w:0;
+         }
+         dict[v] = terminal[fail[v]]?fail[v]:dict[fail[v]];
+      }
+   }
+
+   /** report all the keys occurring in a string
+    *  @param seen [out] seen[node] is set to stamp for each key found */
+   void scan(const UChar* s, R_len_t n, std::vector<R_len_t>& seen, R_len_t stamp) const {
+      R_len_t state = 0;
+      for (R_len_t j=0; j<n; ++j) {
+         R_len_t w;
+         while ((w = next(state, s[j])) < 0 && state != 0)
+            state = fail[state];
+         state = (w >= 0)?w:0;
+         for (R_len_t t = terminal[state]?state:dict[state];
+               t != 0 && seen[t] != stamp; t = dict[t])
+            seen[t] = stamp;
+      }
+   }
+
+   inline R_len_t getNumNodes() const {
+      return (R_len_t)parent.size();
+   }
+};
+
+
+/** A set of regexes matched against the same strings [internal]
+ *
+ * Each regex is compiled once. The literals that must occur
+ * in the regexes' matches are gathered in one Aho-Corasick automaton
+ * (the prefilter), so that a single pass over a string
+ * tells which regexes need to be run by ICU at all.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+class StriRegexSet {
+private:
+   StriRegexSet(const StriRegexSet&); /* not copy-able */
+   StriRegexSet& operator=(const StriRegexSet&);
+
+   std::vector<RegexMatcher*> matchers; // NULL for NA/empty patterns
+   std::vector<R_len_t> literal; // automaton node or 0 if no prefilter
+   StriAhoCorasick* prefilter;
+   std::vector<R_len_t> seen;
+   R_len_t stamp;
+
+public:
+   StriRegexSet() : prefilter(NULL), stamp(0) { }
+
+   /** may throw StriException; warns about empty patterns */
+   void compile(StriContainerUTF16& pattern_cont, R_len_t n, uint32_t flags)
+   {
+      matchers.assign(n, (RegexMatcher*)NULL);
+      literal.assign(n, 0);
+      bool warn_empty = false;
+      std::vector< std::vector<UChar> > lits(n);
+      size_t max_nodes = 1;
+      for (R_len_t j=0; j<n; ++j) {
+         if (pattern_cont.isNA(j)) continue; // never matched
+         if (pattern_cont.get(j).length() <= 0) {
+            warn_empty = true;
+            continue;
+         }
+
+         UErrorCode status = U_ZERO_ERROR;
+         matchers[j] = new RegexMatcher(pattern_cont.get(j), flags, status);
+         if (!matchers[j]) throw StriException(MSG__MEM_ALLOC_ERROR);
+         STRI__CHECKICUSTATUS_THROW(status, {/* deleted in the destructor */})
+
+         stri__regex_required_literal(pattern_cont.get(j), flags, lits[j]);
+         max_nodes += lits[j].size();
+      }
+      if (warn_empty) Rf_warning(MSG__EMPTY_SEARCH_PATTERN_UNSUPPORTED);
+
+      prefilter = new StriAhoCorasick(max_nodes);
+      if (!prefilter) throw StriException(MSG__MEM_ALLOC_ERROR);
+      for (R_len_t j=0; j<n; ++j) {
+         if (lits[j].size() > 0)
+            literal[j] = prefilter->insert(&lits[j][0], lits[j].size());
+      }
+      prefilter->build();
+      seen.assign(prefilter->getNumNodes(), -1);
+   }
+
+   ~StriRegexSet() {
+      for (size_t j=0; j<matchers.size(); ++j)
+         if (matchers[j]) delete matchers[j];
+      if (prefilter) delete prefilter;
+   }
+
+   /** run the prefilter on a new string */
+   void reset(const UnicodeString& str) {
+      ++stamp;
+      prefilter->scan(str.getBuffer(), str.length(), seen, stamp);
+   }
+
+   /** does the j-th regex match the string given to reset()? */
+   bool matches(R_len_t j, const UnicodeString& str) {
+      if (!matchers[j]) return false;
+      if (literal[j] != 0 && seen[literal[j]] != stamp) return false;
+      matchers[j]->reset(str);
+      return (bool)matchers[j]->find();
+   }
+};
+
+
+/** Detect which regexes from a set match a string [internal]
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param opts_regex list
+ * @param type 0 for any (logical vector), 1 for the first index
+ *    (integer vector), 2 for all indexes (list)
+ * @param negate_1 negate the result for type 0
+ * @return logical or integer vector or list
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+static SEXP stri__detect_regex_set(SEXP str, SEXP pattern, SEXP opts_regex,
+   int type, bool negate_1)
+{
+   PROTECT(str = stri_prepare_arg_string(str, "str"));
+   PROTECT(pattern = stri_prepare_arg_string(pattern, "pattern"));
+   R_len_t str_length = LENGTH(str);
+   R_len_t pattern_length = LENGTH(pattern);
+
+   uint32_t pattern_flags = StriContainerRegexPattern::getRegexFlags(opts_regex);
+
+   STRI__ERROR_HANDLER_BEGIN(2)
+   StriContainerUTF16 str_cont(str, str_length);
+   StriContainerUTF16 pattern_cont(pattern, pattern_length);
+   StriRegexSet regex_set; // cleans up after itself also on error
+   regex_set.compile(pattern_cont, pattern_length, pattern_flags);
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector((type == 0)?LGLSXP:((type == 1)?INTSXP:VECSXP), str_length));
+   std::vector<int> which;
+
+   for (R_len_t i = 0; i<str_length; ++i) {
+      if (str_cont.isNA(i)) {
+         if (type == 0)      LOGICAL(ret)[i] = NA_LOGICAL;
+         else if (type == 1) INTEGER(ret)[i] = NA_INTEGER;
+         else                SET_VECTOR_ELT(ret, i, Rf_ScalarInteger(NA_INTEGER));
+         continue;
+      }
+
+      const UnicodeString& str_cur = str_cont.get(i);
+      regex_set.reset(str_cur);
+      which.clear();
+      for (R_len_t j=0; j<pattern_length; ++j) {
+         if (regex_set.matches(j, str_cur)) {
+            which.push_back(j+1); // 0-based index -> 1-based
+            if (type != 2) break;
+         }
+      }
+
+      if (type == 0)
+         LOGICAL(ret)[i] = (negate_1)?(which.size() == 0):(which.size() > 0);
+      else if (type == 1)
+         INTEGER(ret)[i] = (which.size() > 0)?which[0]:NA_INTEGER;
+      else {
+         SEXP ans;
+         STRI__PROTECT(ans = Rf_allocVector(INTSXP, (R_len_t)which.size()));
+         if (which.size() > 0)
+            memcpy(INTEGER(ans), &which[0], which.size()*sizeof(int));
+         SET_VECTOR_ELT(ret, i, ans);
+         STRI__UNPROTECT(1);
+      }
+   }
+
+   STRI__UNPROTECT_ALL
+   return ret;
+   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
+}
+
+
+/** Detect if any regex from a set matches a string
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param negate single logical value
+ * @param opts_regex list
+ * @return logical vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+SEXP stri_detect_any_regex(SEXP str, SEXP pattern, SEXP negate, SEXP opts_regex)
+{
+   bool negate_1 = stri__prepare_arg_logical_1_notNA(negate, "negate");
+   return stri__detect_regex_set(str, pattern, opts_regex, 0, negate_1);
+}
+
+
+/** Detect which regexes from a set match a string
+ *
+ * @param str character vector
+ * @param pattern character vector
+ * @param mode single string, \code{"first"} or \code{"all"}
+ * @param opts_regex list
+ * @return integer vector (first) or list of integer vectors (all)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-15)
+ */
+SEXP stri_detect_which_regex(SEXP str, SEXP pattern, SEXP mode, SEXP opts_regex)
+{
+   const char* mode_val = stri__prepare_arg_string_1_notNA(mode, "mode");
+   const char* mode_opts[] = {"first", "all", NULL};
+   int mode_cur = stri__match_arg(mode_val, mode_opts);
+   if (mode_cur < 0)
+      Rf_error(MSG__INCORRECT_MATCH_OPTION, "mode");
+   return stri__detect_regex_set(str, pattern, opts_regex, mode_cur+1, false);
+}
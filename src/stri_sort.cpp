@@ -40,32 +40,71 @@
 #include <set>
 
 
+/** Big-endian key made of the first 8 bytes of a UTF-8 string [internal]
+ *
+ * The shorter strings are padded with zeros; as R strings never contain
+ * NULs, comparing keys (as integers) gives the same result
+ * as comparing the strings' prefixes code point-wise.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ */
+static inline uint64_t stri__sort_prefix_key(const char* s, R_len_t n)
+{
+   uint64_t key = 0;
+   R_len_t k = (n < 8)?n:8;
+   for (R_len_t i=0; i<k; ++i)
+      key |= ((uint64_t)(uint8_t)s[i]) << (8*(7-i));
+   return key;
+}
+
+
 /** help struct for stri_order **/
 struct StriSortComparer {
    StriContainerUTF8* cont;
    bool decreasing;
    UCollator* col;
+   const uint64_t* keys; // prefix keys; used only if col == NULL
 
-   StriSortComparer(StriContainerUTF8* _cont, UCollator* _col, bool _decreasing)
-   { this->cont = _cont; this->col = _col; this->decreasing = _decreasing; }
+   /* comparers are passed around by value, hence the prefix keys
+    * are stored in a vector owned by the caller */
+   StriSortComparer(StriContainerUTF8* _cont, UCollator* _col, bool _decreasing,
+      vector<uint64_t>& _keys)
+   {
+      this->cont = _cont; this->col = _col; this->decreasing = _decreasing;
+      this->keys = NULL;
+      if (!_col) {
+         // codepoint-wise cmp: most comparisons are resolved by prefix keys
+         R_len_t n = _cont->get_n();
+         _keys.assign(n, 0);
+         for (R_len_t i=0; i<n; ++i) {
+            if (!_cont->isNA(i))
+               _keys[i] = stri__sort_prefix_key(_cont->get(i).c_str(),
+                  _cont->get(i).length());
+         }
+         if (n > 0) this->keys = &_keys[0];
+      }
+   }
 
    bool operator() (int a, int b) const
    {
-//      if (col) {
+      int ret;
+      if (col) {
          UErrorCode status = U_ZERO_ERROR;
-         int ret = (int)ucol_strcollUTF8(col,
+         ret = (int)ucol_strcollUTF8(col,
             cont->get(a).c_str(), cont->get(a).length(),
             cont->get(b).c_str(), cont->get(b).length(), &status);
          STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
-         return (decreasing)?(ret > 0):(ret < 0);
-//      }
-//      else {
-//         int ret = stri__cmp_codepoints(
-//            cont->get(a).c_str(), cont->get(a).length(),
-//            cont->get(b).c_str(), cont->get(b).length()
-//         );
-//         return (decreasing)?(ret > 0):(ret < 0);
-//      }
+      }
+      else if (keys[a] != keys[b]) {
+         ret = (keys[a] < keys[b])?-1:1;
+      }
+      else {
+         ret = stri__cmp_codepoints(
+            cont->get(a).c_str(), cont->get(a).length(),
+            cont->get(b).c_str(), cont->get(b).length()
+         );
+      }
+      return (decreasing)?(ret > 0):(ret < 0);
    }
 };
 
@@ -102,6 +141,9 @@ struct StriSortComparer {
  *
  * @version 0.6-1 (Marek Gagolewski, 2015-07-05)
  *    use stri_order, stri_sort
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp
  */
 SEXP stri_order_or_sort(SEXP str, SEXP decreasing, SEXP na_last,
    SEXP opts_collator, int _type)
@@ -117,7 +159,8 @@ SEXP stri_order_or_sort(SEXP str, SEXP decreasing, SEXP na_last,
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
 
    STRI__ERROR_HANDLER_BEGIN(2)
@@ -143,7 +186,8 @@ SEXP stri_order_or_sort(SEXP str, SEXP decreasing, SEXP na_last,
    // TO DO: collation-based cmp: think of using sort keys...
    // however, now it's already very fast.
 
-   StriSortComparer comp(&str_cont, col, decr);
+   vector<uint64_t> keys;
+   StriSortComparer comp(&str_cont, col, decr, keys);
    std::stable_sort(order.begin(), order.end(), comp);
 
 
@@ -253,6 +297,9 @@ SEXP stri_sort(SEXP str, SEXP decreasing, SEXP na_last, SEXP opts_collator)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp
  */
 SEXP stri_unique(SEXP str, SEXP opts_collator)
 {
@@ -261,14 +308,16 @@ SEXP stri_unique(SEXP str, SEXP opts_collator)
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
    STRI__ERROR_HANDLER_BEGIN(1)
 
    R_len_t vectorize_length = LENGTH(str);
    StriContainerUTF8 str_cont(str, vectorize_length);
 
-   StriSortComparer comp(&str_cont, col, true);
+   vector<uint64_t> keys;
+   StriSortComparer comp(&str_cont, col, true, keys);
    set<int,StriSortComparer> uniqueset(comp);
 
    bool was_na = false;
@@ -323,6 +372,9 @@ SEXP stri_unique(SEXP str, SEXP opts_collator)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp
  */
 SEXP stri_duplicated(SEXP str, SEXP fromLast, SEXP opts_collator)
 {
@@ -332,14 +384,16 @@ SEXP stri_duplicated(SEXP str, SEXP fromLast, SEXP opts_collator)
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
    STRI__ERROR_HANDLER_BEGIN(1)
 
    R_len_t vectorize_length = LENGTH(str);
    StriContainerUTF8 str_cont(str, vectorize_length);
 
-   StriSortComparer comp(&str_cont, col, true);
+   vector<uint64_t> keys;
+   StriSortComparer comp(&str_cont, col, true, keys);
    set<int,StriSortComparer> uniqueset(comp);
 
    bool was_na = false;
@@ -403,6 +457,9 @@ SEXP stri_duplicated(SEXP str, SEXP fromLast, SEXP opts_collator)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-07)
+ *    opts_collator == NA: codepoint-wise cmp
  */
 SEXP stri_duplicated_any(SEXP str, SEXP fromLast, SEXP opts_collator)
 {
@@ -412,14 +469,16 @@ SEXP stri_duplicated_any(SEXP str, SEXP fromLast, SEXP opts_collator)
    // call stri__ucol_open after prepare_arg:
    // if prepare_arg had failed, we would have a mem leak
    UCollator* col = NULL;
-   col = stri__ucol_open(opts_collator);
+   if (!stri__ucol_is_off(opts_collator))
+      col = stri__ucol_open(opts_collator);
 
    STRI__ERROR_HANDLER_BEGIN(1)
 
    R_len_t vectorize_length = LENGTH(str);
    StriContainerUTF8 str_cont(str, vectorize_length);
 
-   StriSortComparer comp(&str_cont, col, true);
+   vector<uint64_t> keys;
+   StriSortComparer comp(&str_cont, col, true, keys);
    set<int,StriSortComparer> uniqueset(comp);
 
    bool was_na = false;
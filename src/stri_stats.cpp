@@ -33,6 +33,37 @@
 #include "stri_stringi.h"
 #include "stri_container_utf8.h"
 
+/** Copies the statistics to an R vector
+ *
+ * @param stats counts
+ * @param n number of counts
+ * @return an integer vector, or a numeric one if some count
+ *    does not fit into an int
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-18)
+ */
+static SEXP stri__stats_vector(const double* stats, int n)
+{
+   bool fits_int = true;
+   for (int i=0; i<n; ++i)
+      if (stats[i] > (double)INT_MAX) fits_int = false;
+
+   SEXP ret;
+   if (fits_int) {
+      PROTECT(ret = Rf_allocVector(INTSXP, n));
+      int* ret_int = INTEGER(ret);
+      for (int i=0; i<n; ++i) ret_int[i] = (int)stats[i];
+   }
+   else {
+      PROTECT(ret = Rf_allocVector(REALSXP, n));
+      double* ret_dbl = REAL(ret);
+      for (int i=0; i<n; ++i) ret_dbl[i] = stats[i];
+   }
+   UNPROTECT(1);
+   return ret;
+}
+
+
 /**
  * General statistics for a character vector
  *
@@ -52,6 +83,10 @@
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-18)
+ *    ASCII runs are processed 8 bytes at a time;
+ *    counts are accumulated per string and may exceed INT_MAX
  */
 SEXP stri_stats_general(SEXP str)
 {
@@ -69,41 +104,65 @@ SEXP stri_stats_general(SEXP str)
       gsAll = 4 // always == number of elements
    };
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(INTSXP, gsAll));
-   int* stats = INTEGER(ret);
+   double stats[gsAll];
    for (int i=0; i<gsAll; ++i)
-      stats[i] = 0;
+      stats[i] = 0.0;
 
    for (R_len_t i=0; i<str_length; ++i) {
       if (str_cont.isNA(i)) continue; // ignore
 
-      ++stats[gsNumLines]; // another line
       R_len_t     cn = str_cont.get(i).length();
       const char* cs = str_cont.get(i).c_str();
       UChar32 c;
-      bool AnyNonWhite = false;
+      R_len_t nchars = 0; // number of code points in this string
+      R_len_t nwhite = 0; // number of white spaces in this string
 
-      for (int j=0; j<cn; ) {
-         U8_NEXT(cs, j, cn, c);
-         if (c < 0)
-            throw StriException(MSG__INVALID_UTF8);
-         // @TODO: follow Unicode Newline Guidelines - Unicode Technical Report #13
-         else if (c == (UChar32)'\n' || c == (UChar32)'\r') {
-            throw StriException(MSG__NEWLINE_FOUND);
+      for (R_len_t j=0; j<cn; ) {
+         // ASCII-only blocks with no newlines: count
+         // [\t\v\f] (and [\n\r], excluded here) and spaces at once
+         while (j+8 <= cn) {
+            uint64_t x;
+            memcpy(&x, cs+j, 8);
+            if ((x & STRI__SWAR_HIGHS) || STRI__SWAR_HAS_BYTE(x, '\n')
+                  || STRI__SWAR_HAS_BYTE(x, '\r'))
+               break;
+            nwhite += STRI__SWAR_COUNT(
+               (STRI__SWAR_ASCII_GE(x, 0x09) & ~STRI__SWAR_ASCII_GE(x, 0x0e))
+               | STRI__SWAR_ASCII_EQ(x, 0x20));
+            nchars += 8;
+            j += 8;
          }
-         ++stats[gsNumChars]; // another character [code point]
-         // we test for UCHAR_WHITE_SPACE binary property
-         if (!u_hasBinaryProperty(c, UCHAR_WHITE_SPACE)) {
-            AnyNonWhite = true;
-            ++stats[gsNumCharsNonWhite];
+
+         // otherwise, one code point at a time till the end of this block
+         R_len_t jstop = min(j+8, cn);
+         while (j < jstop) {
+            U8_NEXT(cs, j, cn, c);
+            if (c < 0)
+               throw StriException(MSG__INVALID_UTF8);
+            // @TODO: follow Unicode Newline Guidelines - Unicode Technical Report #13
+            else if (c == (UChar32)'\n' || c == (UChar32)'\r') {
+               throw StriException(MSG__NEWLINE_FOUND);
+            }
+            ++nchars; // another character [code point]
+            // we test for UCHAR_WHITE_SPACE binary property
+            if (c < 128) {
+               if ((c >= 0x09 && c <= 0x0d) || c == 0x20)
+                  ++nwhite;
+            }
+            else if (u_hasBinaryProperty(c, UCHAR_WHITE_SPACE))
+               ++nwhite;
          }
       }
 
-      if (AnyNonWhite)
+      ++stats[gsNumLines]; // another line
+      stats[gsNumChars] += nchars;
+      stats[gsNumCharsNonWhite] += nchars-nwhite;
+      if (nchars > nwhite)
          ++stats[gsNumLinesNonEmpty]; // we have a non-empty line here
    }
 
+   SEXP ret;
+   STRI__PROTECT(ret = stri__stats_vector(stats, gsAll));
    stri__set_names(ret, gsAll, "Lines", "LinesNEmpty", "Chars", "CharsNWhite");
    STRI__UNPROTECT_ALL
    return ret;
@@ -133,6 +192,10 @@ SEXP stri_stats_general(SEXP str)
  *
  * @version 0.3-1 (Marek Gagolewski, 2014-11-04)
  *    Issue #112: str_prepare_arg* retvals were not PROTECTed from gc
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-18)
+ *    no ICU property look-ups for ASCII characters and in comments;
+ *    counts are accumulated per string and may exceed INT_MAX
  */
 SEXP stri_stats_latex(SEXP str)
 {
@@ -159,10 +222,8 @@ SEXP stri_stats_latex(SEXP str)
       lsAll = 6
    };
 
-   SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(INTSXP, lsAll));
-   int* stats = INTEGER(ret);
-   for (int i=0; i<lsAll; ++i) stats[i] = 0;
+   double stats[lsAll];
+   for (int i=0; i<lsAll; ++i) stats[i] = 0.0;
 
    for (R_len_t i=0; i<str_length; ++i) {
       if (str_cont.isNA(i)) continue; // ignore
@@ -171,9 +232,26 @@ SEXP stri_stats_latex(SEXP str)
       const char* cs = str_cont.get(i).c_str();
       UChar32 c;
 
+      R_len_t cur[lsAll]; // this string's counts
+      for (int k=0; k<lsAll; ++k) cur[k] = 0;
+
       int state = stStandard;
       bool word = false; // we are not in a word currently
       for (int j=0; j<cn; ) {
+         if (state == stComment) {
+            // ignore until the end - just check if the rest is valid
+            // and has no newlines (ASCII blocks are skipped at once)
+            while (j+8 <= cn) {
+               uint64_t x;
+               memcpy(&x, cs+j, 8);
+               if ((x & STRI__SWAR_HIGHS) || STRI__SWAR_HAS_BYTE(x, '\n')
+                     || STRI__SWAR_HAS_BYTE(x, '\r'))
+                  break;
+               j += 8;
+            }
+            if (j >= cn) break;
+         }
+
          U8_NEXT(cs, j, cn, c);
 
          if (c < 0)
@@ -183,14 +261,24 @@ SEXP stri_stats_latex(SEXP str)
             throw StriException(MSG__NEWLINE_FOUND);
          }
 
-         UBool isLetter = u_isUAlphabetic(c); // u_hasBinaryProperty(c, UCHAR_ALPHABETIC)
-         UBool isNumber = u_isdigit(c); // U_DECIMAL_DIGIT_NUMBER    Nd
+         if (state == stComment)
+            continue;
+
+         bool isLetter, isNumber;
+         if (c < 128) { // the only ASCII alphabetics and decimal digits
+            isLetter = ((uint32_t)((c|0x20)-'a') < 26);
+            isNumber = ((uint32_t)(c-'0') < 10);
+         }
+         else {
+            isLetter = u_isUAlphabetic(c); // u_hasBinaryProperty(c, UCHAR_ALPHABETIC)
+            isNumber = u_isdigit(c); // U_DECIMAL_DIGIT_NUMBER    Nd
+         }
 
          switch(state) {
             case stStandard:
                if (c == (UChar32)'\\') {
                   state = stControlSequence;
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCharsCmdEnvir];
 
                   if (j < cn) {
                      // Look Ahead:
@@ -214,12 +302,12 @@ SEXP stri_stats_latex(SEXP str)
                      // (42test is still counted as a word, but 42.2 not)
                      if (isLetter && !word) {
                         word = true;
-                        ++stats[lsWords];
+                        ++cur[lsWords];
                      }
-                     ++stats[lsCharsWord];
+                     ++cur[lsCharsWord];
                   }
                   else {
-                     ++stats[lsCharsWhite];
+                     ++cur[lsCharsWhite];
                      word = false;
                   }
               }
@@ -229,71 +317,70 @@ SEXP stri_stats_latex(SEXP str)
               if (isLetter) {
                   // "\begin{[a-zA-z]+}" is an environment, and you can't define a command like \begin
                   if (c == (UChar32)'b' && !strncmp(cs+j, "egin", 4) /* plain ASCII compare - it's OK */) {
-                     ++stats[lsEnvir];
+                     ++cur[lsEnvir];
                      state = stEnvironment;
-                     stats[lsCharsCmdEnvir] +=5;
+                     cur[lsCharsCmdEnvir] +=5;
                      j += 4;
                   }
                   else if (c == (UChar32)'e' && !strncmp(cs+j, "nd", 2) /* plain ASCII compare - it's OK */) {
-                     stats[lsCharsCmdEnvir] +=3;
+                     cur[lsCharsCmdEnvir] +=3;
                      state = stEnvironment;
                      j += 2;
                   } // we don't count \end as a new environment, this can give wrong results in selections
                   else {
-                     ++stats[lsCmd];
-                     ++stats[lsCharsCmdEnvir];
+                     ++cur[lsCmd];
+                     ++cur[lsCharsCmdEnvir];
                      state = stCommand;
                   }
                }
                else {
                   // MG: This will also prevent counting \% as a comment (it's a percent sign)
-                  ++stats[lsCmd];
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCmd];
+                  ++cur[lsCharsCmdEnvir];
                   state = stStandard;
                }
                break;
 
             case stCommand :
                if(isLetter) {
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCharsCmdEnvir];
                }
                else if(c == (UChar32)'\\') {
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCharsCmdEnvir];
                   state = stControlSequence;
                }
                else if(c == (UChar32)'%') {
                   state = stComment;
                }
                else {
-                  ++stats[lsCharsWhite];
+                  ++cur[lsCharsWhite];
                   state = stStandard;
                }
             break;
 
             case stEnvironment :
                if(c == (UChar32)'}') { // until we find a closing } we have an environment
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCharsCmdEnvir];
                   state = stStandard;
                }
                else if(c == (UChar32)'%') {
                   state = stComment;
                }
                else {
-                  ++stats[lsCharsCmdEnvir];
+                  ++cur[lsCharsCmdEnvir];
                }
             break;
 
-            case stComment:
-               // ignore until the end - any newline will be detected
-               // and the error will be thrown
-            break;
-
             default:
                throw StriException("DEBUG: stri_stats_latex() - this shouldn't happen :-(");
          }
-     }
+      }
+
+      for (int k=0; k<lsAll; ++k) stats[k] += cur[k];
    }
 
+   SEXP ret;
+   STRI__PROTECT(ret = stri__stats_vector(stats, lsAll));
    stri__set_names(ret, lsAll, "CharsWord", "CharsCmdEnvir", "CharsWhite",
       "Words", "Cmds", "Envirs");
    STRI__UNPROTECT_ALL
@@ -77,10 +77,12 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_datetime_format",              stri_datetime_format,            4),
    STRI__MK_CALL("C_stri_datetime_parse",               stri_datetime_parse,             5),
    STRI__MK_CALL("C_stri_datetime_add",                 stri_datetime_add,               5),
+   STRI__MK_CALL("C_stri_detect_any_regex",             stri_detect_any_regex,           4),
    STRI__MK_CALL("C_stri_detect_charclass",             stri_detect_charclass,           3),
    STRI__MK_CALL("C_stri_detect_coll",                  stri_detect_coll,                4),
    STRI__MK_CALL("C_stri_detect_fixed",                 stri_detect_fixed,               4),
    STRI__MK_CALL("C_stri_detect_regex",                 stri_detect_regex,               4),
+   STRI__MK_CALL("C_stri_detect_which_regex",           stri_detect_which_regex,         4),
    STRI__MK_CALL("C_stri_dup",                          stri_dup,                        2),
    STRI__MK_CALL("C_stri_duplicated",                   stri_duplicated,                 3),
    STRI__MK_CALL("C_stri_duplicated_any",               stri_duplicated_any,             3),
@@ -105,6 +107,7 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_endswith_charclass",           stri_endswith_charclass,         3),
    STRI__MK_CALL("C_stri_endswith_coll",                stri_endswith_coll,              4),
    STRI__MK_CALL("C_stri_endswith_fixed",               stri_endswith_fixed,             4),
+   STRI__MK_CALL("C_stri_endswith_which_fixed",         stri_endswith_which_fixed,       4),
    STRI__MK_CALL("C_stri_escape_unicode",               stri_escape_unicode,             1),
    STRI__MK_CALL("C_stri_extract_first_boundaries",     stri_extract_first_boundaries,   2),
    STRI__MK_CALL("C_stri_extract_last_boundaries",      stri_extract_last_boundaries,    2),
@@ -122,7 +125,8 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_extract_last_regex",           stri_extract_last_regex,         3),
    STRI__MK_CALL("C_stri_extract_all_regex",            stri_extract_all_regex,          5),
    STRI__MK_CALL("C_stri_flatten",                      stri_flatten,                    4),
-//   STRI__MK_CALL("C_stri_in_fixed",                   stri_in_fixed,                   3),  // TODO: version >= 0.6
+   STRI__MK_CALL("C_stri_in_coll",                      stri_in_coll,                    4),
+   STRI__MK_CALL("C_stri_in_fixed",                     stri_in_fixed,                   3),
    STRI__MK_CALL("C_stri_info",                         stri_info,                       0),
    STRI__MK_CALL("C_stri_isempty",                      stri_isempty,                    1),
    STRI__MK_CALL("C_stri_join",                         stri_join,                       4),
@@ -134,21 +138,21 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_locale_info",                  stri_locale_info,                1),
    STRI__MK_CALL("C_stri_locale_list",                  stri_locale_list,                0),
    STRI__MK_CALL("C_stri_locale_set",                   stri_locale_set,                 1),
-   STRI__MK_CALL("C_stri_locate_all_boundaries",        stri_locate_all_boundaries,      3),
-   STRI__MK_CALL("C_stri_locate_first_boundaries",      stri_locate_first_boundaries,    2),
-   STRI__MK_CALL("C_stri_locate_last_boundaries",       stri_locate_last_boundaries,     2),
-   STRI__MK_CALL("C_stri_locate_first_charclass",       stri_locate_first_charclass,     2),
-   STRI__MK_CALL("C_stri_locate_last_charclass",        stri_locate_last_charclass,      2),
-   STRI__MK_CALL("C_stri_locate_all_charclass",         stri_locate_all_charclass,       4),
-   STRI__MK_CALL("C_stri_locate_last_fixed",            stri_locate_last_fixed,          3),
-   STRI__MK_CALL("C_stri_locate_first_fixed",           stri_locate_first_fixed,         3),
-   STRI__MK_CALL("C_stri_locate_all_fixed",             stri_locate_all_fixed,           4),
-   STRI__MK_CALL("C_stri_locate_last_coll",             stri_locate_last_coll,           3),
-   STRI__MK_CALL("C_stri_locate_first_coll",            stri_locate_first_coll,          3),
-   STRI__MK_CALL("C_stri_locate_all_coll",              stri_locate_all_coll,            4),
-   STRI__MK_CALL("C_stri_locate_all_regex",             stri_locate_all_regex,           4),
-   STRI__MK_CALL("C_stri_locate_first_regex",           stri_locate_first_regex,         3),
-   STRI__MK_CALL("C_stri_locate_last_regex",            stri_locate_last_regex,          3),
+   STRI__MK_CALL("C_stri_locate_all_boundaries",        stri_locate_all_boundaries,      5),
+   STRI__MK_CALL("C_stri_locate_first_boundaries",      stri_locate_first_boundaries,    3),
+   STRI__MK_CALL("C_stri_locate_last_boundaries",       stri_locate_last_boundaries,     3),
+   STRI__MK_CALL("C_stri_locate_first_charclass",       stri_locate_first_charclass,     3),
+   STRI__MK_CALL("C_stri_locate_last_charclass",        stri_locate_last_charclass,      3),
+   STRI__MK_CALL("C_stri_locate_all_charclass",         stri_locate_all_charclass,       6),
+   STRI__MK_CALL("C_stri_locate_last_fixed",            stri_locate_last_fixed,          4),
+   STRI__MK_CALL("C_stri_locate_first_fixed",           stri_locate_first_fixed,         4),
+   STRI__MK_CALL("C_stri_locate_all_fixed",             stri_locate_all_fixed,           6),
+   STRI__MK_CALL("C_stri_locate_last_coll",             stri_locate_last_coll,           4),
+   STRI__MK_CALL("C_stri_locate_first_coll",            stri_locate_first_coll,          4),
+   STRI__MK_CALL("C_stri_locate_all_coll",              stri_locate_all_coll,            6),
+   STRI__MK_CALL("C_stri_locate_all_regex",             stri_locate_all_regex,           6),
+   STRI__MK_CALL("C_stri_locate_first_regex",           stri_locate_first_regex,         4),
+   STRI__MK_CALL("C_stri_locate_last_regex",            stri_locate_last_regex,          4),
    STRI__MK_CALL("C_stri_match_first_regex",            stri_match_first_regex,          4),
    STRI__MK_CALL("C_stri_match_last_regex",             stri_match_last_regex,           4),
    STRI__MK_CALL("C_stri_match_all_regex",              stri_match_all_regex,            5),
@@ -166,8 +170,8 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_prepare_arg_double_1",         stri_prepare_arg_double_1,       2),
    STRI__MK_CALL("C_stri_prepare_arg_integer_1",        stri_prepare_arg_integer_1,      2),
    STRI__MK_CALL("C_stri_prepare_arg_logical_1",        stri_prepare_arg_logical_1,      2),
-   STRI__MK_CALL("C_stri_rand_shuffle",                 stri_rand_shuffle,               1),
-   STRI__MK_CALL("C_stri_rand_strings",                 stri_rand_strings,               3),
+   STRI__MK_CALL("C_stri_rand_shuffle",                 stri_rand_shuffle,               2),
+   STRI__MK_CALL("C_stri_rand_strings",                 stri_rand_strings,               4),
    STRI__MK_CALL("C_stri_replace_na",                   stri_replace_na,                 2),
    STRI__MK_CALL("C_stri_replace_all_fixed",            stri_replace_all_fixed,          5),
    STRI__MK_CALL("C_stri_replace_first_fixed",          stri_replace_first_fixed,        4),
@@ -188,10 +192,12 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_split_fixed",                  stri_split_fixed,                7),
    STRI__MK_CALL("C_stri_split_lines",                  stri_split_lines,                2),
    STRI__MK_CALL("C_stri_split_lines1",                 stri_split_lines1,               1),
+   STRI__MK_CALL("C_stri_split_records",                stri_split_records,              4),
    STRI__MK_CALL("C_stri_split_regex",                  stri_split_regex,                7),
    STRI__MK_CALL("C_stri_startswith_charclass",         stri_startswith_charclass,       3),
    STRI__MK_CALL("C_stri_startswith_coll",              stri_startswith_coll,            4),
    STRI__MK_CALL("C_stri_startswith_fixed",             stri_startswith_fixed,           4),
+   STRI__MK_CALL("C_stri_startswith_which_fixed",       stri_startswith_which_fixed,     4),
    STRI__MK_CALL("C_stri_stats_general",                stri_stats_general,              1),
    STRI__MK_CALL("C_stri_stats_latex",                  stri_stats_latex,                1),
    STRI__MK_CALL("C_stri_sub",                          stri_sub,                        4),
@@ -219,6 +225,7 @@ const R_CallMethodDef cCallMethods[] = {
    STRI__MK_CALL("C_stri_trans_isnfkd",                 stri_trans_isnfkd,               1),
    STRI__MK_CALL("C_stri_trans_isnfkc_casefold",        stri_trans_isnfkc_casefold,      1),
    STRI__MK_CALL("C_stri_trans_general",                stri_trans_general,              2),
+   STRI__MK_CALL("C_stri_trans_general_clear_cache",    stri_trans_general_clear_cache,  0),
    STRI__MK_CALL("C_stri_trans_list",                   stri_trans_list,                 0),
    STRI__MK_CALL("C_stri_trans_nfc",                    stri_trans_nfc,                  1),
    STRI__MK_CALL("C_stri_trans_nfd",                    stri_trans_nfd,                  1),
@@ -310,11 +317,14 @@ extern "C" void R_init_stringi(DllInfo* dll)
    R_forceSymbols(dll, (Rboolean)TRUE);
 #endif
 
+   stri__sub_altrep_init(dll);
+
    const R_CallMethodDef* methods = cCallMethods;
    while (methods->name) {
       R_RegisterCCallable("stringi", methods->name, methods->fun);
       methods++;
    }
+   stri__capi_register(); // C API (stri_capi.h)
 
    if (!SUPPORT_UTF8) {
       /* Rconfig.h states that all R platforms supports that */
@@ -336,21 +346,27 @@ extern "C" void R_init_stringi(DllInfo* dll)
 }
 
 
-#ifndef NDEBUG
-
 #include <unicode/uclean.h>
+#include "stri_brkiter.h"
 
 /**
  * Library cleanup
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ *    free the cached break iterators and transliterators
+ *    in release builds too
  */
 extern "C" void  R_unload_stringi(DllInfo*)
 {
+   StriBrkIterCache::clear();
+   stri__trans_general_clear_cache();
+
+#ifndef NDEBUG
    // see http://bugs.icu-project.org/trac/ticket/10897
    // and https://github.com/Rexamine/stringi/issues/78
 //   fprintf(stdout, "!NDEBUG: ************************************************\n");
 //   fprintf(stdout, "!NDEBUG: Dynamic library 'stringi' unloaded.\n");
 //   fprintf(stdout, "!NDEBUG: ************************************************\n");
    u_cleanup();
-}
-
 #endif
+}
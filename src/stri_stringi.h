@@ -55,10 +55,17 @@ SEXP    stri__emptyList();
 SEXP    stri__matrix_NA_INTEGER(R_len_t nrow, R_len_t ncol);
 SEXP    stri__matrix_NA_STRING(R_len_t nrow, R_len_t ncol);
 int     stri__match_arg(const char* option, const char** set);
+bool    stri__factor_is_plain(SEXP x);
+bool    stri__factor_use_levels(SEXP x);
+SEXP    stri__factor_expand(SEXP x, SEXP values);
 
 // collator.cpp:
 struct UCollator;
 UCollator* stri__ucol_open(SEXP opts_collator);
+bool       stri__ucol_is_off(SEXP opts_collator);
+
+// compare.cpp:
+int stri__cmp_codepoints(const char* str1, R_len_t n1, const char* str2, R_len_t n2);
 
 // length.cpp
 R_len_t stri__numbytes_max(SEXP str);
@@ -102,6 +109,8 @@ SEXP stri_test_returnasis(SEXP x);
 // search
 void stri__locate_set_dimnames_list(SEXP list);
 void stri__locate_set_dimnames_matrix(SEXP matrix);
+bool stri__locate_get_units_bytes(SEXP units);
+bool stri__locate_get_output_flat(SEXP output);
 SEXP stri__subset_by_logical(const StriContainerUTF8& str_cont,
    const std::vector<int>& which, int result_counter);
 SEXP stri__subset_by_logical(const StriContainerUTF16& str_cont,
@@ -110,6 +119,18 @@ SEXP stri__subset_by_logical(const StriContainerUTF16& str_cont,
 // date/time
 void stri__set_class_POSIXct(SEXP x);
 
+// capi.cpp:
+void stri__capi_register();
+
+// sub_altrep.cpp:
+void stri__sub_altrep_init(DllInfo* dll);
+bool stri__sub_altrep_available();
+SEXP stri__sub_altrep_new(SEXP str, SEXP offsets);
+bool stri__sub_altrep_get(SEXP x, SEXP& str, const int*& offsets);
+
+// trans_transliterate.cpp:
+void stri__trans_general_clear_cache();
+
 // encoding_conversion.cpp:
 SEXP stri_encode_from_marked(SEXP str, SEXP to, SEXP to_raw);
 
@@ -34,6 +34,10 @@
 #include "stri_container_utf8_indexable.h"
 #include "stri_string8buf.h"
 
+
+/** lazy substrings are created only for longer vectors */
+#define STRI__SUB_ALTREP_MINLENGTH 1024
+
 /***
  * used both in stri_sub and stri_sub_replacement
  *
@@ -146,9 +150,19 @@ inline void stri__sub_get_indices(StriContainerUTF8_indexable& str_cont, R_len_t
  *
  * @version 0.5-9003 (Marek Gagolewski, 2015-08-05)
  *    Bugfix #183: floating point exception when to or length is an empty vector
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ *    return lazy substrings (ALTREP) if possible
  */
 SEXP stri_sub(SEXP str, SEXP from, SEXP to, SEXP length)
 {
+   // exactly one of to and length is given (the other one is NULL);
+   // empty ones give character(0), see below
+   STRI__FACTOR_APPLY_TO_LEVELS(str, !Rf_isMatrix(from) && Rf_length(from) == 1 &&
+      ((Rf_length(to) == 1) != (Rf_length(length) == 1)) &&
+      Rf_length(to) <= 1 && Rf_length(length) <= 1,
+      stri_sub(str, from, to, length))
+
    PROTECT(str = stri_prepare_arg_string(str, "str"));
 
    R_len_t str_len       = LENGTH(str);
@@ -172,23 +186,48 @@ SEXP stri_sub(SEXP str, SEXP from, SEXP to, SEXP length)
 
    STRI__ERROR_HANDLER_BEGIN(4)
    StriContainerUTF8_indexable str_cont(str, vectorize_len);
+
+   // substrings may be represented by byte offsets, provided that
+   // the strings in str_cont are exactly those in str (ASCII/UTF-8, no BOMs)
+   // (2*vectorize_len offsets must fit into an R_len_t)
+   bool lazy = (vectorize_len >= STRI__SUB_ALTREP_MINLENGTH &&
+      vectorize_len <= R_LEN_T_MAX/2 && stri__sub_altrep_available());
+   for (R_len_t i=0; lazy && i<str_len; ++i) {
+      if (!str_cont.isNA(i) &&
+            str_cont.get(i).c_str() != CHAR(STRING_ELT(str, i)))
+         lazy = false;
+   }
+
    SEXP ret;
-   STRI__PROTECT(ret = Rf_allocVector(STRSXP, vectorize_len));
+   int* offsets_tab = NULL;
+   if (lazy) {
+      STRI__PROTECT(ret = Rf_allocVector(INTSXP, 2*(R_xlen_t)vectorize_len));
+      offsets_tab = INTEGER(ret);
+   }
+   else
+      STRI__PROTECT(ret = Rf_allocVector(STRSXP, vectorize_len));
 
    for (R_len_t i = str_cont.vectorize_init();
          i != str_cont.vectorize_end();
          i = str_cont.vectorize_next(i))
    {
+      R_xlen_t k           = 2*(R_xlen_t)i; // offsets_tab index
       R_len_t cur_from     = from_tab[i % from_len];
       R_len_t cur_to       = (to_tab)?to_tab[i % to_len]:length_tab[i % length_len];
       if (str_cont.isNA(i) || cur_from == NA_INTEGER || cur_to == NA_INTEGER) {
-         SET_STRING_ELT(ret, i, NA_STRING);
+         if (offsets_tab)
+            offsets_tab[k] = offsets_tab[k+1] = NA_INTEGER;
+         else
+            SET_STRING_ELT(ret, i, NA_STRING);
          continue;
       }
 
       if (length_tab) {
          if (cur_to <= 0) {
-            SET_STRING_ELT(ret, i, R_BlankString);
+            if (offsets_tab)
+               offsets_tab[k] = offsets_tab[k+1] = 0;
+            else
+               SET_STRING_ELT(ret, i, R_BlankString);
             continue;
          }
          cur_to = cur_from + cur_to - 1;
@@ -202,7 +241,11 @@ SEXP stri_sub(SEXP str, SEXP from, SEXP to, SEXP length)
 
       stri__sub_get_indices(str_cont, i, cur_from, cur_to, cur_from2, cur_to2);
 
-      if (cur_to2 > cur_from2) { // just copy
+      if (offsets_tab) {
+         offsets_tab[k]   = cur_from2;
+         offsets_tab[k+1] = (cur_to2 > cur_from2)?cur_to2:cur_from2;
+      }
+      else if (cur_to2 > cur_from2) { // just copy
          SET_STRING_ELT(ret, i, Rf_mkCharLenCE(str_cur_s+cur_from2, cur_to2-cur_from2, CE_UTF8));
       }
       else {
@@ -211,6 +254,9 @@ SEXP stri_sub(SEXP str, SEXP from, SEXP to, SEXP length)
       }
    }
 
+   if (offsets_tab)
+      STRI__PROTECT(ret = stri__sub_altrep_new(str, ret));
+
    STRI__UNPROTECT_ALL
    return ret;
    STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
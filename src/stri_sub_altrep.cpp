@@ -0,0 +1,233 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "stri_stringi.h"
+
+#if defined(R_VERSION) && R_VERSION >= R_Version(3, 6, 0)
+/* ALTREP is available since R 3.5.0, but its header
+   is usable from C++ only since R 3.6.0 */
+#define STRI__SUB_ALTREP
+#include <R_ext/Altrep.h>
+#endif
+
+
+/* Lazy stri_sub() results (ALTREP character vectors)
+ *
+ * data1 is a list consisting of:
+ *    the source character vector (ASCII/UTF-8 strings with no BOMs) and
+ *    an integer vector of 2*n UTF-8 byte offsets: [from, to) of the
+ *    ith substring in the (i mod length(source))th source string
+ *    (from==NA_INTEGER denotes an NA);
+ * data2 is R_NilValue or the materialized character vector.
+ *
+ * Single elements are created on demand and are not stored.
+ * stringi's containers read the source strings' bytes directly,
+ * see stri__sub_altrep_get().
+ */
+
+
+#ifdef STRI__SUB_ALTREP
+
+static R_altrep_class_t stri__sub_altrep_class;
+
+
+static R_xlen_t stri__sub_altrep_Length(SEXP x)
+{
+   return XLENGTH(VECTOR_ELT(R_altrep_data1(x), 1))/2;
+}
+
+
+static SEXP stri__sub_altrep_make_elt(SEXP x, R_xlen_t i)
+{
+   SEXP data1 = R_altrep_data1(x);
+   SEXP str = VECTOR_ELT(data1, 0);
+   const int* offsets = INTEGER(VECTOR_ELT(data1, 1));
+   if (offsets[2*i] == NA_INTEGER)
+      return NA_STRING;
+
+   SEXP str_cur = STRING_ELT(str, i%XLENGTH(str));
+   return Rf_mkCharLenCE(CHAR(str_cur)+offsets[2*i],
+      offsets[2*i+1]-offsets[2*i], CE_UTF8);
+}
+
+
+static SEXP stri__sub_altrep_materialize(SEXP x)
+{
+   SEXP data2 = R_altrep_data2(x);
+   if (data2 != R_NilValue)
+      return data2;
+
+   R_xlen_t n = stri__sub_altrep_Length(x);
+   PROTECT(data2 = Rf_allocVector(STRSXP, n));
+   for (R_xlen_t i=0; i<n; ++i)
+      SET_STRING_ELT(data2, i, stri__sub_altrep_make_elt(x, i));
+   R_set_altrep_data2(x, data2);
+   UNPROTECT(1);
+   return data2;
+}
+
+
+static SEXP stri__sub_altrep_Elt(SEXP x, R_xlen_t i)
+{
+   SEXP data2 = R_altrep_data2(x);
+   if (data2 != R_NilValue)
+      return STRING_ELT(data2, i);
+   return stri__sub_altrep_make_elt(x, i);
+}
+
+
+static void stri__sub_altrep_Set_elt(SEXP x, R_xlen_t i, SEXP v)
+{
+   SET_STRING_ELT(stri__sub_altrep_materialize(x), i, v);
+}
+
+
+static void* stri__sub_altrep_Dataptr(SEXP x, Rboolean /*writeable*/)
+{
+   return DATAPTR(stri__sub_altrep_materialize(x));
+}
+
+
+static const void* stri__sub_altrep_Dataptr_or_null(SEXP x)
+{
+   SEXP data2 = R_altrep_data2(x);
+   if (data2 == R_NilValue)
+      return NULL;
+   return DATAPTR(data2);
+}
+
+
+static Rboolean stri__sub_altrep_Inspect(SEXP x, int /*pre*/, int /*deep*/,
+   int /*pvec*/, void (*/*inspect_subtree*/)(SEXP, int, int, int))
+{
+   Rprintf(" stringi substrings (len=%d, materialized=%s)\n",
+      (int)stri__sub_altrep_Length(x),
+      (R_altrep_data2(x) != R_NilValue)?"T":"F");
+   return TRUE;
+}
+
+#endif
+
+
+/** Register the ALTREP class for lazy substrings (if available)
+ *
+ * @param dll
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ */
+void stri__sub_altrep_init(DllInfo* dll)
+{
+#ifdef STRI__SUB_ALTREP
+   R_altrep_class_t cls = R_make_altstring_class("stri_sub", "stringi", dll);
+   R_set_altrep_Length_method(cls, stri__sub_altrep_Length);
+   R_set_altrep_Inspect_method(cls, stri__sub_altrep_Inspect);
+   R_set_altvec_Dataptr_method(cls, stri__sub_altrep_Dataptr);
+   R_set_altvec_Dataptr_or_null_method(cls, stri__sub_altrep_Dataptr_or_null);
+   R_set_altstring_Elt_method(cls, stri__sub_altrep_Elt);
+   R_set_altstring_Set_elt_method(cls, stri__sub_altrep_Set_elt);
+   stri__sub_altrep_class = cls;
+#else
+   (void)dll;
+#endif
+}
+
+
+/** Can lazy substrings be created?
+ *
+ * @return logical value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ */
+bool stri__sub_altrep_available()
+{
+#ifdef STRI__SUB_ALTREP
+   return true;
+#else
+   return false;
+#endif
+}
+
+
+/** Create a lazy character vector of substrings
+ *
+ * @param str source character vector, each string is NA, ASCII or
+ *    UTF-8 with no BOM
+ * @param offsets integer vector of length 2*n, see above
+ * @return character vector of length n
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ */
+SEXP stri__sub_altrep_new(SEXP str, SEXP offsets)
+{
+#ifdef STRI__SUB_ALTREP
+   SEXP data1, ret;
+   PROTECT(data1 = Rf_allocVector(VECSXP, 2));
+   SET_VECTOR_ELT(data1, 0, str);
+   SET_VECTOR_ELT(data1, 1, offsets);
+   PROTECT(ret = R_new_altrep(stri__sub_altrep_class, data1, R_NilValue));
+   UNPROTECT(2);
+   return ret;
+#else
+   (void)str;
+   (void)offsets;
+   throw StriException(MSG__INTERNAL_ERROR);
+#endif
+}
+
+
+/** Get the description of a lazy character vector of substrings
+ *
+ * @param x character vector
+ * @param str [out] source character vector
+ * @param offsets [out] 2*LENGTH(x) byte offsets
+ * @return true if x is a lazy stri_sub() result that has not been
+ *    materialized yet; false otherwise (str and offsets are not set)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-06)
+ */
+bool stri__sub_altrep_get(SEXP x, SEXP& str, const int*& offsets)
+{
+#ifdef STRI__SUB_ALTREP
+   if (!ALTREP(x) || !R_altrep_inherits(x, stri__sub_altrep_class)
+         || R_altrep_data2(x) != R_NilValue)
+      return false;
+   SEXP data1 = R_altrep_data1(x);
+   str     = VECTOR_ELT(data1, 0);
+   offsets = INTEGER(VECTOR_ELT(data1, 1));
+   return true;
+#else
+   (void)x;
+   (void)str;
+   (void)offsets;
+   return false;
+#endif
+}
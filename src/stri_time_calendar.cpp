@@ -36,6 +36,80 @@
 #include "stri_container_integer.h"
 #include <unicode/calendar.h>
 #include <unicode/gregocal.h>
+#include <unicode/basictz.h>
+#include <unicode/tztrans.h>
+
+
+/* instants (in ms) beyond this bound are left for ICU to handle (clamping etc.);
+   ICU's own MIN_MILLIS and MAX_MILLIS are about +/-1.8e17 */
+#define STRI__DATETIME_MILLIS_SAFE 1.0e17
+
+
+/**
+ * Memoizes a time zone's total UTC offset (raw + DST)
+ * over the interval between two consecutive zone transitions.
+ *
+ * This is used to compute the date-time fields arithmetically
+ * (like ICU does in `Calendar::computeFields`) for all the
+ * timestamps that fall within the same transition interval, which
+ * is particularly beneficial for sorted timestamp vectors.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-25)
+ */
+class StriTimeZoneOffsetCache {
+private:
+   const BasicTimeZone* tz; ///< NULL if transitions cannot be queried
+   double from;             ///< the interval start (inclusive, ms)
+   double to;               ///< the interval end (exclusive, ms)
+   int32_t offset;          ///< raw + DST offset valid in [from, to)
+
+public:
+
+   StriTimeZoneOffsetCache(const TimeZone& tz) {
+      this->tz = dynamic_cast<const BasicTimeZone*>(&tz);
+      this->from = 0.0;
+      this->to   = 0.0; // empty interval
+      this->offset = 0;
+   }
+
+
+   /** Get the total UTC offset at a given instant
+    *
+    * @param t UTC time in ms
+    * @param off [out] raw + DST offset in ms
+    * @return false if the offset could not be determined
+    * (the caller should then rely on ICU's Calendar)
+    */
+   bool getOffset(double t, int32_t& off) {
+      if (from <= t && t < to) {
+         off = offset;
+         return true;
+      }
+
+      if (!tz || !(t > -STRI__DATETIME_MILLIS_SAFE && t < STRI__DATETIME_MILLIS_SAFE))
+         return false; // also catches NaNs
+
+      UErrorCode status = U_ZERO_ERROR;
+      int32_t raw_offset, dst_offset;
+      tz->getOffset(t, false, raw_offset, dst_offset, status);
+      if (U_FAILURE(status)) return false;
+
+      TimeZoneTransition trans;
+      double new_from = -STRI__DATETIME_MILLIS_SAFE;
+      double new_to   =  STRI__DATETIME_MILLIS_SAFE;
+      if (tz->getPreviousTransition(t, true/*inclusive*/, trans))
+         new_from = trans.getTime();
+      if (tz->getNextTransition(t, false/*inclusive*/, trans))
+         new_to = trans.getTime();
+      if (!(new_from <= t && t < new_to)) return false; // just in case
+
+      from = new_from;
+      to = new_to;
+      offset = raw_offset + dst_offset;
+      off = offset;
+      return true;
+   }
+};
 
 
 /** Set POSIXct class on a given object
@@ -84,6 +158,9 @@ SEXP stri_datetime_now()
  *
  * @version 0.5-1 (Marek Gagolewski, 2014-12-30)
  * @version 0.5-1 (Marek Gagolewski, 2015-03-06) tz arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-25)
+ *    units <= days computed arithmetically, ICU only used at DST edges
  */
 SEXP stri_datetime_add(SEXP time, SEXP value, SEXP units, SEXP tz, SEXP locale) {
    PROTECT(time = stri_prepare_arg_POSIXct(time, "time"));
@@ -126,6 +203,23 @@ SEXP stri_datetime_add(SEXP time, SEXP value, SEXP units, SEXP tz, SEXP locale)
    cal->adoptTimeZone(tz_val);
    tz_val = NULL; /* The Calendar takes ownership of the TimeZone. */
 
+   // For units <= days, Calendar::add() boils down to adding a fixed number
+   // of ms. For days and weeks, the wall time is kept invariant, which
+   // requires an adjustment only if the UTC offset changes in-between.
+   double units_millis;
+   switch (units_cur) {
+      case 2: units_millis = 7.0*(double)U_MILLIS_PER_DAY;  break;
+      case 3: units_millis = (double)U_MILLIS_PER_DAY;      break;
+      case 4: units_millis = (double)U_MILLIS_PER_HOUR;     break;
+      case 5: units_millis = 60000.0;                       break;
+      case 6: units_millis = 1000.0;                        break;
+      case 7: units_millis = 1.0;                           break;
+      default: units_millis = 0.0; /* years, months - use ICU */
+   }
+   bool units_keep_wall_time = (units_cur == 2 || units_cur == 3);
+   StriTimeZoneOffsetCache offset_cache0(cal->getTimeZone()); // at `time`
+   StriTimeZoneOffsetCache offset_cache1(cal->getTimeZone()); // at the result
+
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(REALSXP, vectorize_length));
    double* ret_val = REAL(ret);
@@ -134,6 +228,34 @@ SEXP stri_datetime_add(SEXP time, SEXP value, SEXP units, SEXP tz, SEXP locale)
          ret_val[i] = NA_REAL;
          continue;
       }
+
+      if (units_millis > 0.0) {
+         double t0 = time_cont.get(i)*1000.0;
+         double t1 = t0 + value_cont.get(i)*units_millis;
+         if (t0 > -STRI__DATETIME_MILLIS_SAFE && t0 < STRI__DATETIME_MILLIS_SAFE &&
+             t1 > -STRI__DATETIME_MILLIS_SAFE && t1 < STRI__DATETIME_MILLIS_SAFE) {
+            if (!units_keep_wall_time) {
+               ret_val[i] = t1/1000.0;
+               continue;
+            }
+
+            // the same check as in Calendar::add(): if the wall time
+            // is unchanged, no DST adjustment is necessary
+            int32_t off0, off1;
+            if (offset_cache0.getOffset(t0, off0) && offset_cache1.getOffset(t1, off1)) {
+               double local0 = t0 + off0;
+               double local1 = t1 + off1;
+               double day0 = floor(local0/(double)U_MILLIS_PER_DAY);
+               double day1 = floor(local1/(double)U_MILLIS_PER_DAY);
+               if ((int32_t)(local0-day0*(double)U_MILLIS_PER_DAY) ==
+                   (int32_t)(local1-day1*(double)U_MILLIS_PER_DAY)) {
+                  ret_val[i] = t1/1000.0;
+                  continue;
+               }
+            }
+         }
+      }
+
       status = U_ZERO_ERROR;
       cal->setTime((UDate)(time_cont.get(i)*1000.0), status);
       STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
@@ -171,6 +293,9 @@ SEXP stri_datetime_add(SEXP time, SEXP value, SEXP units, SEXP tz, SEXP locale)
  *
  * @version 0.5-1 (Marek Gagolewski, 2015-01-01)
  * @version 0.5-1 (Marek Gagolewski, 2015-03-03) tz arg added
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-25)
+ *    memoize calendar fields per local day
  */
 SEXP stri_datetime_fields(SEXP time, SEXP tz, SEXP locale) {
    PROTECT(time = stri_prepare_arg_POSIXct(time, "time"));
@@ -194,55 +319,87 @@ SEXP stri_datetime_fields(SEXP time, SEXP tz, SEXP locale) {
    SEXP ret;
 #define STRI__FIELDS_NUM 14
    STRI__PROTECT(ret = Rf_allocVector(VECSXP, STRI__FIELDS_NUM));
-   for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j)
+   int* ret_val[STRI__FIELDS_NUM];
+   for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j) {
       SET_VECTOR_ELT(ret, j, Rf_allocVector(INTSXP, vectorize_length));
+      ret_val[j] = INTEGER(VECTOR_ELT(ret, j));
+   }
+
+   const UCalendarDateFields units_fields[STRI__FIELDS_NUM] = {
+      UCAL_EXTENDED_YEAR, UCAL_MONTH, UCAL_DAY_OF_MONTH, UCAL_HOUR_OF_DAY,
+      UCAL_MINUTE, UCAL_SECOND, UCAL_MILLISECOND, UCAL_WEEK_OF_YEAR,
+      UCAL_WEEK_OF_MONTH, UCAL_DAY_OF_YEAR, UCAL_DAY_OF_WEEK, UCAL_HOUR,
+      UCAL_AM_PM, UCAL_ERA
+   };
+   //UCAL_IS_LEAP_MONTH
+   //UCAL_MILLISECONDS_IN_DAY -> SecondsInDay
+
+   // UCAL_AM_PM -> "AM" or "PM" (localized? or factor?+index in stri_datetime_symbols) add arg use_symbols????
+   // UCAL_DAY_OF_WEEK -> (localized? or factor?) SUNDAY, MONDAY
+   // UCAL_DAY_OF_YEAR '
+
+   // isWekend
+
+   // Fields other than Hour, Minute, Second, Millisecond, Hour12, and AmPm
+   // depend solely on the local (wall) day number. These are memoized
+   // for the most recently seen day; the remaining ones are derived
+   // from the wall time in ms exactly as in ICU's Calendar::computeFields().
+   StriTimeZoneOffsetCache offset_cache(cal->getTimeZone());
+   bool day_cached = false;
+   double day_cached_num = 0.0;
+   int day_cached_vals[STRI__FIELDS_NUM];
 
    for (R_len_t i=0; i<vectorize_length; ++i) {
       if (time_cont.isNA(i)) {
          for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j)
-            INTEGER(VECTOR_ELT(ret, j))[i] = NA_INTEGER;
+            ret_val[j][i] = NA_INTEGER;
+         continue;
+      }
+
+      double t = time_cont.get(i)*1000.0;
+      int32_t off;
+      bool day_known = offset_cache.getOffset(t, off);
+      double local = 0.0, day = 0.0;
+      if (day_known) {
+         local = t + off;
+         day = floor(local/(double)U_MILLIS_PER_DAY);
+      }
+
+      if (day_known && day_cached && day == day_cached_num) {
+         int32_t millis = (int32_t)(local - day*(double)U_MILLIS_PER_DAY);
+         for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j)
+            ret_val[j][i] = day_cached_vals[j];
+         ret_val[6][i]  = millis % 1000;
+         millis /= 1000;
+         ret_val[5][i]  = millis % 60;
+         millis /= 60;
+         ret_val[4][i]  = millis % 60;
+         millis /= 60;
+         ret_val[3][i]  = millis;
+         ret_val[11][i] = millis % 12;
+         ret_val[12][i] = millis / 12 + 1; // ampm + 1
          continue;
       }
 
       status = U_ZERO_ERROR;
-      cal->setTime((UDate)(time_cont.get(i)*1000.0), status);
+      cal->setTime((UDate)t, status);
       STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
       for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j) {
-         UCalendarDateFields units_field;
-         switch (j) {
-            case 0:  units_field = UCAL_EXTENDED_YEAR;          break;
-            case 1:  units_field = UCAL_MONTH;                  break;
-            case 2:  units_field = UCAL_DAY_OF_MONTH;           break;
-            case 3:  units_field = UCAL_HOUR_OF_DAY;            break;
-            case 4:  units_field = UCAL_MINUTE;                 break;
-            case 5:  units_field = UCAL_SECOND;                 break;
-            case 6:  units_field = UCAL_MILLISECOND;            break;
-            case 7:  units_field = UCAL_WEEK_OF_YEAR;           break;
-            case 8:  units_field = UCAL_WEEK_OF_MONTH;          break;
-            case 9:  units_field = UCAL_DAY_OF_YEAR;            break;
-            case 10: units_field = UCAL_DAY_OF_WEEK;            break;
-            case 11: units_field = UCAL_HOUR;                   break;
-            case 12: units_field = UCAL_AM_PM;                  break;
-            case 13: units_field = UCAL_ERA;                    break;
-            default: throw StriException(MSG__INCORRECT_MATCH_OPTION, "units");
-         }
-         //UCAL_IS_LEAP_MONTH
-         //UCAL_MILLISECONDS_IN_DAY -> SecondsInDay
-
-         // UCAL_AM_PM -> "AM" or "PM" (localized? or factor?+index in stri_datetime_symbols) add arg use_symbols????
-         // UCAL_DAY_OF_WEEK -> (localized? or factor?) SUNDAY, MONDAY
-         // UCAL_DAY_OF_YEAR '
-
-         // isWekend
-
          status = U_ZERO_ERROR;
-         INTEGER(VECTOR_ELT(ret, j))[i] = cal->get(units_field, status);
+         ret_val[j][i] = cal->get(units_fields[j], status);
          STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
-         if (units_field == UCAL_MONTH)      ++INTEGER(VECTOR_ELT(ret, j))[i]; // month + 1
-         else if (units_field == UCAL_AM_PM) ++INTEGER(VECTOR_ELT(ret, j))[i]; // ampm + 1
-         else if (units_field == UCAL_ERA)   ++INTEGER(VECTOR_ELT(ret, j))[i]; // era + 1
+         if (units_fields[j] == UCAL_MONTH)      ++ret_val[j][i]; // month + 1
+         else if (units_fields[j] == UCAL_AM_PM) ++ret_val[j][i]; // ampm + 1
+         else if (units_fields[j] == UCAL_ERA)   ++ret_val[j][i]; // era + 1
+      }
+
+      if (day_known) {
+         day_cached = true;
+         day_cached_num = day;
+         for (R_len_t j=0; j<STRI__FIELDS_NUM; ++j)
+            day_cached_vals[j] = ret_val[j][i];
       }
    }
 
@@ -34,6 +34,7 @@
 #include "stri_container_utf16.h"
 #include "stri_container_double.h"
 #include "stri_container_integer.h"
+#include "stri_memo.h"
 #include <unicode/calendar.h>
 #include <unicode/gregocal.h>
 #include <unicode/smpdtfmt.h>
@@ -178,6 +179,11 @@ SEXP stri_datetime_format(SEXP time, SEXP format, SEXP tz, SEXP locale) {
  * @version 0.5-1 (Marek Gagolewski, 2015-01-11) lenient arg added
  * @version 0.5-1 (Marek Gagolewski, 2015-02-22) use tz
  * @version 0.5-1 (Marek Gagolewski, 2015-03-01) set tzone attrib on retval
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-10)
+ *    the fields missing in a string are taken from the current time,
+ *    and not from the previously parsed string; memoize the results
+ *    for duplicated strings
  */
 SEXP stri_datetime_parse(SEXP str, SEXP format, SEXP lenient, SEXP tz, SEXP locale) {
    PROTECT(str = stri_prepare_arg_string(str, "str"));
@@ -257,15 +263,26 @@ SEXP stri_datetime_parse(SEXP str, SEXP format, SEXP lenient, SEXP tz, SEXP loca
 
    cal->setLenient(lenient_val);
 
+   // the fields missing in str are set based on the calendar's state
+   UDate now = cal->getTime(status);
+   STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(REALSXP, vectorize_length));
+   StriMemo<double> memo(vectorize_length, str);
    for (R_len_t i=0; i<vectorize_length; ++i) {
       if (str_cont.isNA(i)) {
          REAL(ret)[i] = NA_REAL;
          continue;
       }
 
+      SEXP str_orig = STRING_ELT(str, i);
+      if (memo.get(str_orig, REAL(ret)[i]))
+         continue;
+
       status = U_ZERO_ERROR;
+      cal->setTime(now, status);
+      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
       ParsePosition pos;
       fmt->parse(str_cont.get(i), *cal, pos);
 
@@ -276,6 +293,7 @@ SEXP stri_datetime_parse(SEXP str, SEXP format, SEXP lenient, SEXP tz, SEXP loca
          REAL(ret)[i] = ((double)cal->getTime(status))/1000.0;
          if (U_FAILURE(status)) REAL(ret)[i] = NA_REAL;
       }
+      memo.set(str_orig, REAL(ret)[i]);
    }
 
 
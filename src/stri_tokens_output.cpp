@@ -0,0 +1,188 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#include "stri_stringi.h"
+#include "stri_tokens_output.h"
+
+
+/** Determine the output form based on the `simplify` argument
+ *
+ * @param simplify single logical value or \code{"flat"}
+ * @param argname argument name (for error messages)
+ * @return output mode
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ */
+StriTokensOutput::Mode StriTokensOutput::getMode(SEXP simplify, const char* argname)
+{
+   if (Rf_isString(simplify) && LENGTH(simplify) == 1
+         && STRING_ELT(simplify, 0) != NA_STRING
+         && !strcmp(CHAR(STRING_ELT(simplify, 0)), "flat"))
+      return FLAT;
+
+   PROTECT(simplify = stri_prepare_arg_logical_1(simplify, argname));
+   int simplify_val = LOGICAL(simplify)[0];
+   UNPROTECT(1);
+
+   if (simplify_val == NA_LOGICAL) return MATRIX_NA;
+   else if (simplify_val)          return MATRIX;
+   else                            return LIST;
+}
+
+
+/** Convert a list of character vectors to the desired output form
+ *
+ * To be used where the tokens cannot be referenced
+ * directly (e.g., when they are generated from UTF-16 data).
+ *
+ * @param x list of character vectors
+ * @param mode output form
+ * @param n_min minimal number of columns of the resulting matrix
+ * @return `x`, a character matrix,
+ *    or a list with two components: `tokens` and `offsets`
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ */
+SEXP StriTokensOutput::listToR(SEXP x, Mode mode, R_len_t n_min)
+{
+   if (mode == LIST)
+      return x;
+   else if (mode == MATRIX || mode == MATRIX_NA)
+      return stri_list2matrix(x, Rf_ScalarLogical(TRUE),
+         (mode == MATRIX_NA)?stri__vector_NA_strings(1)
+                            :stri__vector_empty_strings(1),
+         Rf_ScalarInteger(n_min));
+
+   // else FLAT
+   R_len_t n = LENGTH(x);
+   double ntokens = 0.0;
+   for (R_len_t i=0; i<n; ++i)
+      ntokens += (double)LENGTH(VECTOR_ELT(x, i));
+   if (ntokens > (double)R_LEN_T_MAX)
+      throw StriException(MSG__EXPECTED_SMALLER, "the number of tokens");
+
+   SEXP ret, ret_tokens, ret_offsets;
+   PROTECT(ret = Rf_allocVector(VECSXP, 2));
+   SET_VECTOR_ELT(ret, 0, ret_tokens = Rf_allocVector(STRSXP, (R_len_t)ntokens));
+   SET_VECTOR_ELT(ret, 1, ret_offsets = Rf_allocVector(INTSXP, n+1));
+   int* offsets = INTEGER(ret_offsets);
+   R_len_t k = 0;
+   for (R_len_t i=0; i<n; ++i) {
+      offsets[i] = k;
+      SEXP cur = VECTOR_ELT(x, i);
+      R_len_t cur_n = LENGTH(cur);
+      for (R_len_t j=0; j<cur_n; ++j, ++k)
+         SET_STRING_ELT(ret_tokens, k, STRING_ELT(cur, j));
+   }
+   offsets[n] = k;
+   stri__set_names(ret, 2, "tokens", "offsets");
+   UNPROTECT(1);
+   return ret;
+}
+
+
+/** Constructor
+ *
+ * @param n number of elements
+ * @param mode output form
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ */
+StriTokensOutput::StriTokensOutput(R_len_t n, Mode mode)
+   : n(n), mode(mode), tokens(), start(n, 0), count(n, 0), cur(0)
+{
+   tokens.reserve(n);
+}
+
+
+/** Convert to an R object
+ *
+ * @param n_min minimal number of columns of the resulting matrix
+ * @return list of character vectors, character matrix,
+ *    or a list with two components: `tokens` and `offsets`
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ */
+SEXP StriTokensOutput::toR(R_len_t n_min) const
+{
+   double ntokens = 0.0;
+   for (R_len_t i=0; i<n; ++i)
+      ntokens += (double)count[i];
+   if (mode == FLAT && ntokens > (double)R_LEN_T_MAX)
+      throw StriException(MSG__EXPECTED_SMALLER, "the number of tokens");
+
+   SEXP ret;
+   if (mode == LIST) {
+      PROTECT(ret = Rf_allocVector(VECSXP, n));
+      for (R_len_t i=0; i<n; ++i) {
+         SEXP ans;
+         PROTECT(ans = Rf_allocVector(STRSXP, count[i]));
+         for (R_len_t j=0; j<count[i]; ++j)
+            SET_STRING_ELT(ans, j, mkToken(start[i]+j));
+         SET_VECTOR_ELT(ret, i, ans);
+         UNPROTECT(1);
+      }
+   }
+   else if (mode == MATRIX || mode == MATRIX_NA) {
+      R_len_t m = n_min; // number of columns
+      for (R_len_t i=0; i<n; ++i)
+         if (count[i] > m) m = count[i];
+
+      SEXP fill = (mode == MATRIX_NA)?NA_STRING:R_BlankString;
+      PROTECT(ret = Rf_allocMatrix(STRSXP, n, m));
+      for (R_len_t i=0; i<n; ++i) {
+         R_len_t j;
+         for (j=0; j<count[i]; ++j)
+            SET_STRING_ELT(ret, i+(R_xlen_t)j*n, mkToken(start[i]+j));
+         for (; j<m; ++j)
+            SET_STRING_ELT(ret, i+(R_xlen_t)j*n, fill);
+      }
+   }
+   else { // FLAT
+      SEXP ret_tokens, ret_offsets;
+      PROTECT(ret = Rf_allocVector(VECSXP, 2));
+      SET_VECTOR_ELT(ret, 0, ret_tokens = Rf_allocVector(STRSXP, (R_len_t)ntokens));
+      SET_VECTOR_ELT(ret, 1, ret_offsets = Rf_allocVector(INTSXP, n+1));
+      int* offsets = INTEGER(ret_offsets);
+      R_len_t k = 0;
+      for (R_len_t i=0; i<n; ++i) {
+         offsets[i] = k;
+         for (R_len_t j=0; j<count[i]; ++j, ++k)
+            SET_STRING_ELT(ret_tokens, k, mkToken(start[i]+j));
+      }
+      offsets[n] = k;
+      stri__set_names(ret, 2, "tokens", "offsets");
+   }
+
+   UNPROTECT(1);
+   return ret;
+}
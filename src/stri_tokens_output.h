@@ -0,0 +1,165 @@
+/* This file is part of the 'stringi' package for R.
+ * Copyright (c) 2013-2018, Marek Gagolewski and other contributors.
+ * All rights reserved.
+ *
+ * Redistribution and use in source and binary forms, with or without
+ * modification, are permitted provided that the following conditions are met:
+ *
+ * 1. Redistributions of source code must retain the above copyright notice,
+ * this list of conditions and the following disclaimer.
+ *
+ * 2. Redistributions in binary form must reproduce the above copyright notice,
+ * this list of conditions and the following disclaimer in the documentation
+ * and/or other materials provided with the distribution.
+ *
+ * 3. Neither the name of the copyright holder nor the names of its
+ * contributors may be used to endorse or promote products derived from
+ * this software without specific prior written permission.
+ *
+ * THIS SOFTWARE IS PROVIDED BY THE COPYRIGHT HOLDERS AND CONTRIBUTORS
+ * "AS IS" AND ANY EXPRESS OR IMPLIED WARRANTIES, INCLUDING,
+ * BUT NOT LIMITED TO, THE IMPLIED WARRANTIES OF MERCHANTABILITY AND FITNESS
+ * FOR A PARTICULAR PURPOSE ARE DISCLAIMED. IN NO EVENT SHALL THE COPYRIGHT
+ * HOLDER OR CONTRIBUTORS BE LIABLE FOR ANY DIRECT, INDIRECT, INCIDENTAL,
+ * SPECIAL, EXEMPLARY, OR CONSEQUENTIAL DAMAGES (INCLUDING, BUT NOT LIMITED TO,
+ * PROCUREMENT OF SUBSTITUTE GOODS OR SERVICES; LOSS OF USE, DATA, OR PROFITS;
+ * OR BUSINESS INTERRUPTION) HOWEVER CAUSED AND ON ANY THEORY OF LIABILITY,
+ * WHETHER IN CONTRACT, STRICT LIABILITY, OR TORT (INCLUDING NEGLIGENCE
+ * OR OTHERWISE) ARISING IN ANY WAY OUT OF THE USE OF THIS SOFTWARE,
+ * EVEN IF ADVISED OF THE POSSIBILITY OF SUCH DAMAGE.
+ */
+
+
+#ifndef __stri_tokens_output_h
+#define __stri_tokens_output_h
+
+#include "stri_stringi.h"
+
+
+/**
+ * A class to gather the outputs of functions returning a list
+ * of character vectors (e.g., `stri_split_*` and `stri_extract_all_*`)
+ * and convert them to an R object of the desired form.
+ *
+ * Only pointers to the tokens (e.g., substrings of the strings
+ * stored in a `StriContainerUTF8`, which must remain alive)
+ * are memorized. This way, a character matrix (`simplify=TRUE` or `NA`)
+ * may be created directly, i.e., with no intermediate list
+ * of character vectors nor a call to `stri_list2matrix`.
+ * Moreover, the "flat" output form is available: a list with
+ * a character vector of all the tokens and an integer vector of
+ * (0-based) offsets giving the tokens' ranges for each string,
+ * like the column pointers of a CSR/CSC sparse matrix.
+ *
+ * Elements may be set in any order (see vectorize_next()),
+ * but the tokens of each element must be added in one go.
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-26)
+ */
+class StriTokensOutput {
+
+   public:
+
+      enum Mode {
+         LIST,        ///< a list of character vectors (`simplify=FALSE`)
+         MATRIX,      ///< a character matrix, fill with "" (`simplify=TRUE`)
+         MATRIX_NA,   ///< a character matrix, fill with NA (`simplify=NA`)
+         FLAT         ///< tokens + offsets (`simplify="flat"`)
+      };
+
+      static Mode getMode(SEXP simplify, const char* argname="simplify");
+
+      static SEXP listToR(SEXP x, Mode mode, R_len_t n_min=0);
+
+
+   private:
+
+      struct Token {
+         const char* s; ///< NULL for NA
+         R_len_t n;     ///< number of bytes
+      };
+
+      R_len_t n;                  ///< number of elements
+      Mode mode;
+      std::vector<Token> tokens;
+      std::vector<size_t> start;  ///< the first token of each element
+      std::vector<R_len_t> count; ///< the number of tokens of each element
+      R_len_t cur;                ///< the element being filled
+
+      StriTokensOutput(const StriTokensOutput&); // no copy
+      StriTokensOutput& operator=(const StriTokensOutput&); // no copy
+
+      /** create a CHARSXP corresponding to the k-th token */
+      inline SEXP mkToken(size_t k) const {
+         const Token& t = tokens[k];
+         return (t.s)?Rf_mkCharLenCE(t.s, t.n, CE_UTF8):NA_STRING;
+      }
+
+
+   public:
+
+      StriTokensOutput(R_len_t n, Mode mode);
+
+
+      /** start adding the tokens of the i-th element
+       * (any previously added ones are discarded)
+       *
+       * @param i element index
+       */
+      inline void set(R_len_t i) {
+#ifndef NDEBUG
+         if (i < 0 || i >= n)
+            throw StriException("StriTokensOutput::set(): INDEX OUT OF BOUNDS");
+#endif
+         cur = i;
+         start[i] = tokens.size();
+         count[i] = 0;
+      }
+
+
+      /** add a token to the current element
+       *
+       * @param s pointer to the first byte (UTF-8), must be valid until toR()
+       * @param len number of bytes
+       */
+      inline void add(const char* s, R_len_t len) {
+         Token t;
+         t.s = s;
+         t.n = len;
+         tokens.push_back(t);
+         ++count[cur];
+      }
+
+
+      /** add a missing value to the current element */
+      inline void addNA() {
+         add(NULL, 0);
+      }
+
+
+      /** set the i-th element to a vector of k missing values
+       *
+       * @param i element index
+       * @param k number of NAs
+       */
+      inline void setNA(R_len_t i, R_len_t k=1) {
+         set(i);
+         for (R_len_t j=0; j<k; ++j) addNA();
+      }
+
+
+      /** set the i-th element to a vector of k empty strings
+       *
+       * @param i element index
+       * @param k number of empty strings
+       */
+      inline void setEmpty(R_len_t i, R_len_t k) {
+         set(i);
+         for (R_len_t j=0; j<k; ++j) add("", 0);
+      }
+
+
+      SEXP toR(R_len_t n_min=0) const;
+};
+
+#endif
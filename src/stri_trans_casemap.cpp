@@ -34,7 +34,61 @@
 #include "stri_container_utf8.h"
 #include "stri_string8buf.h"
 #include "stri_brkiter.h"
+#include <cstring>
 #include <unicode/ucasemap.h>
+#include <unicode/uloc.h>
+
+
+/**
+ * Does ASCII lower/upper case mapping leave a string unchanged?
+ *
+ * The loop is branch-free so that it may be vectorized by the compiler.
+ *
+ * @param str ASCII string
+ * @param n number of bytes
+ * @param _type 1 for tolower, 2 for toupper
+ * @return logical value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-31)
+ */
+static inline bool stri__casemap_ascii_isidentity(const char* str, R_len_t n, int _type)
+{
+   const unsigned char first = (_type == 1) ? (unsigned char)'A' : (unsigned char)'a';
+   unsigned char found = 0;
+   for (R_len_t j=0; j<n; ++j)
+      found |= (unsigned char)((unsigned char)((unsigned char)str[j]-first) < 26);
+   return !found;
+}
+
+
+/**
+ * ASCII lower/upper case mapping
+ *
+ * This gives the same results as ICU for any locale but tr, az, and lt.
+ * The loop is branch-free so that it may be vectorized by the compiler.
+ *
+ * @param buf [out] buffer of size at least \code{n}
+ * @param str ASCII string
+ * @param n number of bytes
+ * @param _type 1 for tolower, 2 for toupper
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-31)
+ */
+static inline void stri__casemap_ascii(char* buf, const char* str, R_len_t n, int _type)
+{
+   if (_type == 1) {
+      for (R_len_t j=0; j<n; ++j) {
+         unsigned char c = (unsigned char)str[j];
+         buf[j] = (char)(c | (((unsigned char)(c-'A') < 26) << 5));
+      }
+   }
+   else {
+      for (R_len_t j=0; j<n; ++j) {
+         unsigned char c = (unsigned char)str[j];
+         buf[j] = (char)(c & ~(((unsigned char)(c-'a') < 26) << 5));
+      }
+   }
+}
 
 
 /**
@@ -50,6 +104,9 @@
  *    use StriUBreakIterator
  */
 SEXP stri_trans_totitle(SEXP str, SEXP opts_brkiter) {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_totitle(str, opts_brkiter))
+
    StriBrkIterOptions opts_brkiter2(opts_brkiter, "word");
    PROTECT(str = stri_prepare_arg_string(str, "str")); // prepare string argument
 
@@ -166,9 +223,16 @@ SEXP stri_trans_totitle(SEXP str, SEXP opts_brkiter) {
  *
  * @version 0.6-1 (Marek Gagolewski, 2015-07-11)
  *    now this is an internal function
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-31)
+ *    ASCII fast path (but not for tr, az, lt);
+ *    return the input CHARSXP if it's unchanged
 */
 SEXP stri_trans_casemap(SEXP str, int _type, SEXP locale)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_casemap(str, _type, locale))
+
    if (_type < 1 || _type > 2) Rf_error(MSG__INCORRECT_INTERNAL_ARG);
    const char* qloc = stri__prepare_arg_locale(locale, "locale", true); /* this is R_alloc'ed */
    PROTECT(str = stri_prepare_arg_string(str, "str")); // prepare string argument
@@ -181,6 +245,14 @@ SEXP stri_trans_casemap(SEXP str, int _type, SEXP locale)
    ucasemap = ucasemap_open(qloc, U_FOLD_CASE_DEFAULT, &status);
    STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
+   // Turkish, Azeri, and Lithuanian have special rules for i/I,
+   // for all the other languages ASCII is mapped as usual
+   char lang[ULOC_FULLNAME_CAPACITY];
+   status = U_ZERO_ERROR;
+   uloc_getLanguage(ucasemap_getLocale(ucasemap), lang, ULOC_FULLNAME_CAPACITY, &status);
+   bool ascii_ok = (U_SUCCESS(status) && strcmp(lang, "tr") != 0 &&
+      strcmp(lang, "az") != 0 && strcmp(lang, "lt") != 0);
+
    R_len_t str_n = LENGTH(str);
    StriContainerUTF8 str_cont(str, str_n);
    SEXP ret;
@@ -208,6 +280,22 @@ SEXP stri_trans_casemap(SEXP str, int _type, SEXP locale)
 
       R_len_t str_cur_n     = str_cont.get(i).length();
       const char* str_cur_s = str_cont.get(i).c_str();
+      SEXP str_orig         = STRING_ELT(str, i);
+      // str_orig may be reused only if it is exactly what we operate on
+      // (e.g., not if a BOM has been stripped)
+      bool str_orig_utf8    = (IS_ASCII(str_orig) || IS_UTF8(str_orig))
+         && str_cur_s == CHAR(str_orig) && str_cur_n == LENGTH(str_orig);
+
+      if (ascii_ok && str_cont.get(i).isASCII()) {
+         if (stri__casemap_ascii_isidentity(str_cur_s, str_cur_n, _type))
+            SET_STRING_ELT(ret, i, str_orig_utf8 ? str_orig :
+               Rf_mkCharLenCE(str_cur_s, str_cur_n, CE_UTF8));
+         else {
+            stri__casemap_ascii(buf.data(), str_cur_s, str_cur_n, _type);
+            SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), str_cur_n, CE_UTF8));
+         }
+         continue;
+      }
 
       status = U_ZERO_ERROR;
       int buf_need;
@@ -228,7 +316,10 @@ SEXP stri_trans_casemap(SEXP str, int _type, SEXP locale)
                                              // we do have the buffer size required to complete this op
       }
 
-      SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), buf_need, CE_UTF8));
+      if (str_orig_utf8 && buf_need == str_cur_n && !memcmp(buf.data(), str_cur_s, (size_t)str_cur_n))
+         SET_STRING_ELT(ret, i, str_orig); // unchanged, avoid touching R's string cache
+      else
+         SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), buf_need, CE_UTF8));
    }
 
    if (ucasemap) { ucasemap_close(ucasemap); ucasemap = NULL;}
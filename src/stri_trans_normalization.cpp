@@ -30,8 +30,11 @@
  */
 
 #include "stri_stringi.h"
-#include "stri_container_utf16.h"
+#include "stri_memo.h"
+#include "stri_container_utf8.h"
+#include <string>
 #include <unicode/normalizer2.h>
+#include <unicode/bytestream.h>
 
 
 #define STRI_UNINORM_NFC 10
@@ -94,6 +97,38 @@ const Normalizer2* stri__normalizer_get(int _type)
 }
 
 
+/**
+ * Is a given string in a given normalization form?
+ *
+ * ASCII strings are normalized in each form except NFKC_Casefold.
+ * Other strings are checked with ICU's quick check
+ * (directly on UTF-8 if available).
+ *
+ * @param normalizer normalizer
+ * @param type normalization type [internal]
+ * @param str_cur string (in UTF-8)
+ * @param status [out] ICU error status
+ * @return logical value
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-30)
+ */
+bool stri__normalizer_is_normalized(const Normalizer2* normalizer, int type,
+   const String8& str_cur, UErrorCode& status)
+{
+   if (str_cur.isASCII() && type != STRI_UNINORM_NFKC_CF)
+      return true;
+
+#if U_ICU_VERSION_MAJOR_NUM>=60
+   return (bool)normalizer->isNormalizedUTF8(
+      StringPiece(str_cur.c_str(), str_cur.length()), status);
+#else
+   UnicodeString str_cur16 = UnicodeString::fromUTF8(
+      StringPiece(str_cur.c_str(), str_cur.length()));
+   return (bool)normalizer->isNormalized(str_cur16, status);
+#endif
+}
+
+
 /**
  * Perform Unicode Normalization
  *
@@ -117,18 +152,26 @@ const Normalizer2* stri__normalizer_get(int _type)
  *
  * @version 0.6-1 (Marek Gagolewski, 2015-07-11)
  *    This is now an internal function
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-30)
+ *    use StriContainerUTF8; strings that are already normalized
+ *    are not copied (the input CHARSXP is returned if it's in UTF-8);
+ *    use normalizeUTF8 for ICU >= 60, otherwise normalize
+ *    only the part following the quick check's "yes" span
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-10)
+ *    memoize the results for duplicated strings
  */
 SEXP stri_trans_nf(SEXP str, int type)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_nf(str, type))
+
    // As of ICU 52.1 (Unicode 6.3.0), the "most expansive" decomposition
    // is 1 UChar -> 18 UChars (data/unidata/norm2/nfkc.txt)
    // FDFA>0635 0644 0649 0020 0627 0644 0644 0647 0020
    //      0639 0644 064A 0647 0020 0648 0633 0644 0645
 
-   // C API will not be faster here
-   // In ICU 52.1 unorm2_normalize does UnicodeString destString(dest, 0, capacity);
-   // and so on, thus it is a simple wrapper for C++ API
-
    const Normalizer2* normalizer =
       stri__normalizer_get(type); // auto `type` check here, call before ERROR_HANDLER
 
@@ -136,18 +179,79 @@ SEXP stri_trans_nf(SEXP str, int type)
    R_len_t str_length = LENGTH(str);
 
    STRI__ERROR_HANDLER_BEGIN(1)
-   StriContainerUTF16 str_cont(str, str_length, false); // writable, no recycle
+   StriContainerUTF8 str_cont(str, str_length); // no recycle
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(STRSXP, str_length));
 
+   StriMemo<SEXP> memo(str_length, str);
+   std::string buf;
    for (R_len_t i=0; i<str_length; ++i) {
-      if (str_cont.isNA(i)) continue;
+      if (str_cont.isNA(i)) {
+         SET_STRING_ELT(ret, i, NA_STRING);
+         continue;
+      }
+
+      SEXP str_orig = STRING_ELT(str, i);
+      SEXP memo_val;
+      if (memo.get(str_orig, memo_val)) {
+         SET_STRING_ELT(ret, i, memo_val);
+         continue;
+      }
+
+      const String8& str_cur = str_cont.get(i);
+      // str_orig may be reused only if it is exactly what we operate on
+      // (e.g., not if a BOM has been stripped)
+      bool str_orig_utf8 = (IS_ASCII(str_orig) || IS_UTF8(str_orig))
+         && str_cur.c_str() == CHAR(str_orig) && str_cur.length() == LENGTH(str_orig);
+
       UErrorCode status = U_ZERO_ERROR;
-      str_cont.set(i, normalizer->normalize(str_cont.get(i), status));
+#if U_ICU_VERSION_MAJOR_NUM>=60
+      if (stri__normalizer_is_normalized(normalizer, type, str_cur, status)) {
+         STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+         SET_STRING_ELT(ret, i, str_orig_utf8 ? str_orig :
+            Rf_mkCharLenCE(str_cur.c_str(), str_cur.length(), CE_UTF8));
+         continue;
+      }
+      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+
+      buf.clear();
+      StringByteSink<std::string> buf_sink(&buf);
+      normalizer->normalizeUTF8(0, StringPiece(str_cur.c_str(), str_cur.length()),
+         buf_sink, NULL, status);
+      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+#else
+      if (str_cur.isASCII() && type != STRI_UNINORM_NFKC_CF) {
+         SET_STRING_ELT(ret, i, str_orig_utf8 ? str_orig :
+            Rf_mkCharLenCE(str_cur.c_str(), str_cur.length(), CE_UTF8));
+         continue;
+      }
+
+      UnicodeString str_cur16 = UnicodeString::fromUTF8(
+         StringPiece(str_cur.c_str(), str_cur.length()));
+      int32_t span = normalizer->spanQuickCheckYes(str_cur16, status);
+      STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      if (span == str_cur16.length()) {
+         SET_STRING_ELT(ret, i, str_orig_utf8 ? str_orig :
+            Rf_mkCharLenCE(str_cur.c_str(), str_cur.length(), CE_UTF8));
+         continue;
+      }
+
+      // normalize only what follows the normalized prefix
+      UnicodeString out16(str_cur16, 0, span);
+      normalizer->normalizeSecondAndAppend(out16, str_cur16.tempSubString(span), status);
       STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
+      buf.clear();
+      out16.toUTF8String(buf);
+#endif
+
+      SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), (int)buf.size(), CE_UTF8));
+      memo.set(str_orig, STRING_ELT(ret, i));
    }
 
    // normalizer shall not be deleted at all
    STRI__UNPROTECT_ALL
-   return str_cont.toR();
+   return ret;
    STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
 }
 
@@ -173,9 +277,15 @@ SEXP stri_trans_nf(SEXP str, int type)
  *
  * @version 0.6-1 (Marek Gagolewski, 2015-07-11)
  *    This is now an internal function
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-30)
+ *    use StriContainerUTF8 and stri__normalizer_is_normalized
  */
 SEXP stri_trans_isnf(SEXP str, int type)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_isnf(str, type))
+
    const Normalizer2* normalizer =
       stri__normalizer_get(type); // auto `type` check here, call before ERROR_HANDLER
 
@@ -183,7 +293,7 @@ SEXP stri_trans_isnf(SEXP str, int type)
    R_len_t str_length = LENGTH(str);
 
    STRI__ERROR_HANDLER_BEGIN(1)
-   StriContainerUTF16 str_cont(str, str_length);
+   StriContainerUTF8 str_cont(str, str_length);
 
    SEXP ret;
    STRI__PROTECT(ret = Rf_allocVector(LGLSXP, str_length));
@@ -198,11 +308,9 @@ SEXP stri_trans_isnf(SEXP str, int type)
          continue;
       }
 
-      // C API will not be faster here
-      // as it is a simple wrapper for C++ API
-
       UErrorCode status = U_ZERO_ERROR;
-      ret_tab[i] = normalizer->isNormalized(str_cont.get(i), status) ? TRUE : FALSE;
+      ret_tab[i] = stri__normalizer_is_normalized(normalizer, type,
+         str_cont.get(i), status) ? TRUE : FALSE;
       STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
    }
 
@@ -68,6 +68,9 @@ void stri__split_codepoints(deque<SEXP>& out, const char* s, int n) {
  *
  */
 SEXP stri_trans_char(SEXP str, SEXP pattern, SEXP replacement) {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_char(str, pattern, replacement))
+
    PROTECT(str          = stri_prepare_arg_string(str, "str"));
    PROTECT(pattern      = stri_prepare_arg_string_1(pattern, "pattern"));
    PROTECT(replacement  = stri_prepare_arg_string_1(replacement, "replacement"));
@@ -31,10 +31,173 @@
 
 
 #include "stri_stringi.h"
-#include "stri_container_utf16.h"
+#include "stri_memo.h"
+#include "stri_container_utf8.h"
 #include <unicode/translit.h>
 #include <unicode/strenum.h>
+#include <unicode/uniset.h>
 #include <string>
+#include <deque>
+
+
+/** maximal number of transliterators kept in the cache */
+#define STRI__TRANSLIT_CACHE_SIZE 16
+
+
+/**
+ * A transliterator stored in the cache
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-01)
+ */
+struct StriTranslitCacheEntry {
+   UnicodeString id;
+   UTransDirection dir;
+   Transliterator* trans;
+   bool ascii_identity;
+};
+
+
+/** Transliterators, the most recently used one is at the front */
+static std::deque<StriTranslitCacheEntry> stri__translit_cache;
+
+
+/** Does a transliterator leave each ASCII string as-is?
+ *
+ * This is only known to be true if each element of a compound transform
+ * is either filtered so that no ASCII character is ever touched or it is
+ * one of the few transforms that map ASCII onto itself.
+ *
+ * @param trans transliterator
+ * @return logical value, false if unknown
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-01)
+ */
+static bool stri__translit_ascii_identity(const Transliterator* trans)
+{
+   const char* ascii_identity_ids[] = {
+      "any-latin", "latin-ascii", "null", "any-null",
+      "nfc", "nfd", "nfkc", "nfkd", "any-nfc", "any-nfd", "any-nfkc", "any-nfkd",
+      NULL
+   };
+   UnicodeSet ascii((UChar32)0, (UChar32)0x7f);
+
+   std::deque<const Transliterator*> elements;
+   UnicodeString id = trans->getID();
+   if (id.indexOf((UChar)0x3B /* ; */) < 0)
+      elements.push_back(trans);
+   else {
+      UErrorCode status = U_ZERO_ERROR;
+      int32_t n = trans->countElements();
+      for (int32_t i=0; i<n; ++i) {
+         const Transliterator& el = trans->getElement(i, status);
+         if (U_FAILURE(status)) return false;
+         elements.push_back(&el);
+      }
+   }
+
+   for (std::deque<const Transliterator*>::iterator it = elements.begin();
+         it != elements.end(); ++it) {
+      const UnicodeSet* filter = dynamic_cast<const UnicodeSet*>((*it)->getFilter());
+      if (filter && !filter->containsSome(ascii))
+         continue; // no ASCII char is touched
+
+      std::string el_id;
+      UnicodeString((*it)->getID()).trim().toLower(Locale::getRoot()).toUTF8String(el_id);
+      bool found = false;
+      for (int k=0; !found && ascii_identity_ids[k]; ++k)
+         found = (el_id == ascii_identity_ids[k]);
+      if (!found) return false;
+   }
+
+   return true;
+}
+
+
+/** Get a (cached) transliterator
+ *
+ * Creating a transliterator may require parsing transform rules
+ * (especially for compound IDs), hence we keep a few most recently used
+ * ones. \code{Transliterator::transliterate()} is a const method,
+ * so a cached object may be used directly.
+ *
+ * Note that R calls us from a single thread only, therefore
+ * the cache is not guarded by a lock.
+ *
+ * @param id transliterator ID
+ * @param dir direction
+ * @param ascii_identity [out] does the transliterator leave ASCII strings as-is?
+ * @param status [out] ICU error status
+ * @return transliterator owned by the cache or NULL on error
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-01)
+ */
+static const Transliterator* stri__translit_get(const UnicodeString& id,
+   UTransDirection dir, bool& ascii_identity, UErrorCode& status)
+{
+   for (std::deque<StriTranslitCacheEntry>::iterator it = stri__translit_cache.begin();
+         it != stri__translit_cache.end(); ++it) {
+      if ((*it).dir == dir && (*it).id == id) {
+         if (it != stri__translit_cache.begin()) {
+            StriTranslitCacheEntry entry = *it;
+            stri__translit_cache.erase(it);
+            stri__translit_cache.push_front(entry);
+         }
+         ascii_identity = stri__translit_cache.front().ascii_identity;
+         return stri__translit_cache.front().trans;
+      }
+   }
+
+   Transliterator* trans = Transliterator::createInstance(id, dir, status);
+   if (U_FAILURE(status)) {
+      if (trans) delete trans;
+      return NULL;
+   }
+   if (!trans) {
+      status = U_MEMORY_ALLOCATION_ERROR;
+      return NULL;
+   }
+
+   if (stri__translit_cache.size() >= STRI__TRANSLIT_CACHE_SIZE) {
+      delete stri__translit_cache.back().trans;
+      stri__translit_cache.pop_back();
+   }
+
+   StriTranslitCacheEntry entry;
+   entry.id = id;
+   entry.dir = dir;
+   entry.trans = trans;
+   entry.ascii_identity = stri__translit_ascii_identity(trans);
+   stri__translit_cache.push_front(entry);
+
+   ascii_identity = entry.ascii_identity;
+   return trans;
+}
+
+
+/** Delete all the cached transliterators
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-01)
+ */
+void stri__trans_general_clear_cache()
+{
+   for (std::deque<StriTranslitCacheEntry>::iterator it = stri__translit_cache.begin();
+         it != stri__translit_cache.end(); ++it)
+      delete (*it).trans;
+   stri__translit_cache.clear();
+}
+
+
+/** Delete all the cached transliterators (R interface)
+ *
+ * @return R_NilValue
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-19)
+ */
+SEXP stri_trans_general_clear_cache()
+{
+   stri__trans_general_clear_cache();
+   return R_NilValue;
+}
 
 
 /** List available transliterators
@@ -93,36 +256,86 @@ SEXP stri_trans_list()
  * @return character vector
  *
  * @version 0.2-2 (Marek Gagolewski, 2014-04-19)
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-01)
+ *    cache transliterators; use StriContainerUTF8;
+ *    return ASCII strings as-is if the transform is known to be
+ *    identity on ASCII; reuse unchanged CHARSXPs
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-10)
+ *    memoize the results for duplicated strings
  */
 SEXP stri_trans_general(SEXP str, SEXP id)
 {
+   STRI__FACTOR_APPLY_TO_LEVELS(str, true,
+      stri_trans_general(str, id))
+
    PROTECT(str = stri_prepare_arg_string(str, "str"));
    PROTECT(id  = stri_prepare_arg_string_1(id, "id"));
    R_len_t str_length = LENGTH(str);
 
-   Transliterator* trans = NULL;
    STRI__ERROR_HANDLER_BEGIN(2)
-   StriContainerUTF16  id_cont(id, 1);
+   StriContainerUTF8 id_cont(id, 1);
    if (id_cont.isNA(0)) {
       STRI__UNPROTECT_ALL
       return stri__vector_NA_strings(str_length);
    }
 
    UErrorCode status = U_ZERO_ERROR;
-   trans = Transliterator::createInstance(id_cont.get(0), UTRANS_FORWARD, status);
+   bool ascii_identity = false;
+   const Transliterator* trans = stri__translit_get(
+      UnicodeString::fromUTF8(StringPiece(id_cont.get(0).c_str(), id_cont.get(0).length())),
+      UTRANS_FORWARD, ascii_identity, status);
    STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
-   StriContainerUTF16 str_cont(str, str_length, false); // writable, no recycle
+   StriContainerUTF8 str_cont(str, str_length); // no recycle
+
+   SEXP ret;
+   STRI__PROTECT(ret = Rf_allocVector(STRSXP, str_length));
 
+   StriMemo<SEXP> memo(str_length, str);
+   std::string buf;
    for (R_len_t i=0; i<str_length; ++i) {
-      if (str_cont.isNA(i)) continue;
-      trans->transliterate(str_cont.getWritable(i));
+      if (str_cont.isNA(i)) {
+         SET_STRING_ELT(ret, i, NA_STRING);
+         continue;
+      }
+
+      SEXP str_orig = STRING_ELT(str, i);
+      SEXP memo_val;
+      if (memo.get(str_orig, memo_val)) {
+         SET_STRING_ELT(ret, i, memo_val);
+         continue;
+      }
+
+      const String8& str_cur = str_cont.get(i);
+      // str_orig may be reused only if it is exactly what we operate on
+      // (e.g., not if a BOM has been stripped)
+      bool str_orig_utf8 = (IS_ASCII(str_orig) || IS_UTF8(str_orig))
+         && str_cur.c_str() == CHAR(str_orig) && str_cur.length() == LENGTH(str_orig);
+
+      if (ascii_identity && str_cur.isASCII()) {
+         SET_STRING_ELT(ret, i, str_orig_utf8 ? str_orig :
+            Rf_mkCharLenCE(str_cur.c_str(), str_cur.length(), CE_UTF8));
+         continue;
+      }
+
+      UnicodeString str_cur16 = UnicodeString::fromUTF8(
+         StringPiece(str_cur.c_str(), str_cur.length()));
+      trans->transliterate(str_cur16);
+
+      buf.clear();
+      str_cur16.toUTF8String(buf);
+      if (str_orig_utf8 && (R_len_t)buf.size() == str_cur.length() &&
+            !memcmp(buf.data(), str_cur.c_str(), buf.size()))
+         SET_STRING_ELT(ret, i, str_orig); // unchanged
+      else
+         SET_STRING_ELT(ret, i, Rf_mkCharLenCE(buf.data(), (int)buf.size(), CE_UTF8));
+      memo.set(str_orig, STRING_ELT(ret, i));
    }
 
-   if (trans) { delete trans; trans = NULL; }
+   // trans is owned by the cache
    STRI__UNPROTECT_ALL
-   return str_cont.toR();
-   STRI__ERROR_HANDLER_END(
-      if (trans) { delete trans; trans = NULL; }
-   )
+   return ret;
+   STRI__ERROR_HANDLER_END(;/* nothing special to be done on error */)
 }
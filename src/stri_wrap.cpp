@@ -32,6 +32,7 @@
 
 #include "stri_stringi.h"
 #include "stri_container_utf8_indexable.h"
+#include "stri_brkiter.h"
 #include <deque>
 #include <vector>
 #include <utility>
@@ -77,6 +78,20 @@ void stri__wrap_greedy(std::deque<R_len_t>& wrap_after,
 }
 
 
+/** Cost of a line with a given number of blanks at the end
+ *
+ * @param blanks number of blank codepoints (negative if a word doesn't fit)
+ * @param exponent_val cost function exponent
+ * @return cost
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-03)
+ */
+static inline double stri__wrap_dynamic_cost(double blanks, double exponent_val)
+{
+   return (blanks < 0.0) ? 0.0 : pow(blanks, exponent_val);
+}
+
+
 /** Dynamic word wrap algorithm
  * (Knuth's word wrapping algorithm that minimizes raggedness of formatted text)
  *
@@ -98,6 +113,10 @@ void stri__wrap_greedy(std::deque<R_len_t>& wrap_after,
  * @version 0.4-1 (Marek Gagolewski, 2014-12-06)
  *    new args: add_para_1, add_para_n,
  *    cost of the last line is zero
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-08-03)
+ *    O(nwords) memory: don't store the cost and wrap matrices,
+ *    look back only at the words that may fit in the current line
  */
 void stri__wrap_dynamic(std::deque<R_len_t>& wrap_after,
    R_len_t nwords, int width_val, double exponent_val,
@@ -105,83 +124,72 @@ void stri__wrap_dynamic(std::deque<R_len_t>& wrap_after,
    const std::vector<R_len_t>& widths_trim,
    int add_para_1, int add_para_n)
 {
-#define IDX(i,j) (i)*nwords+(j)
-   vector<double> cost(nwords*nwords);
-   // where cost[IDX(i,j)] == cost of printing words i..j in a single line, i<=j
-
-   // calculate costs:
+   // widths_sum[k] == widths_orig[0]+...+widths_orig[k-1]
+   vector<double> widths_sum(nwords+1);
+   widths_sum[0] = 0.0;
+   for (R_len_t k=0; k<nwords; ++k)
+      widths_sum[k+1] = widths_sum[k]+widths_orig[k];
+
+   // number of "blank" codepoints left when printing words i..j in a single line
+   // (negative if they don't fit)
+#define STRI__WRAP_BLANKS(i,j) \
+   ((double)width_val-(widths_sum[(j)]-widths_sum[(i)]+widths_trim[(j)]) \
+      -(((i) == 0)?add_para_1:add_para_n))
+
+   // cost of printing words i..j, i<=j, in a single line, provided that
+   // they fit (or i==j -- some words don't fit in a line at all -> cost 0.0);
    // there is some "punishment" for leaving blanks at the end of each line
-   // (number of "blank" codepoints ^ exponent_val)
-   for (int i=0; i<nwords; i++) {
-      int sum = 0;
-      for (int j=i; j<nwords; j++) {
-         if (j > i) {
-            if (cost[IDX(i,j-1)] < 0.0) { // already Inf
-               cost[IDX(i,j)] = -1.0; // Inf
-               continue;
-            }
-            else {
-               sum -= widths_trim[j-1];
-               sum += widths_orig[j-1];
-            }
-         }
-         sum += widths_trim[j];
-         int ct = width_val - sum;
-         if (i == 0) ct -= add_para_1;
-         else        ct -= add_para_n;
-
-         if (j == nwords-1) { // last line == cost 0
-            if (j == i || ct >= 0)
-               cost[IDX(i,j)] = 0.0;
-            else
-               cost[IDX(i,j)] = -1.0/*Inf*/;
-         }
-         else if (j == i)
-            // some words don't fit in a line at all -> cost 0.0
-            cost[IDX(i,j)] = (ct < 0) ? 0.0 : pow((double)ct, exponent_val);
-         else
-            cost[IDX(i,j)] = (ct < 0) ? -1.0/*"Inf"*/ : pow((double)ct, exponent_val);
-      }
-   }
+   // (number of "blank" codepoints ^ exponent_val), the last line costs nothing
+#define STRI__WRAP_COST(i,j) \
+   (((j) == nwords-1)?0.0:stri__wrap_dynamic_cost(STRI__WRAP_BLANKS(i,j), exponent_val))
 
    vector<double> f(nwords); // f[j] == total cost of  (optimally) printing words 0..j
-   vector<bool> where(nwords*nwords, false); // where[IDX(i,j)] == false iff
-                                             // we don't wrap after i-th word, i<=j
-                                             // when (optimally) printing words 0..j
+   vector<R_len_t> wrap_prev(nwords, -1); // wrap_prev[j] == the last word of
+                                          // the previous line when (optimally)
+                                          // printing words 0..j, -1 if none
+
+   // As widths are nonnegative, if words i..j don't fit in a line,
+   // then neither do words i'..j' for all 1<=i'<=i and j'>=j
+   // (the first line has a different indentation).
+   // Hence, we only have to look back at words first..j.
+   bool fits_first_line = true; // do words 0..j fit in a single line?
+   R_len_t first = 1;           // the least i>=1 such that words i..j fit
+   for (R_len_t j=0; j<nwords; ++j) {
+      if (j > 0) {
+         if (fits_first_line && STRI__WRAP_BLANKS(0,j) < 0.0)
+            fits_first_line = false;
+         while (first < j && STRI__WRAP_BLANKS(first,j) < 0.0)
+            ++first;
+      }
 
-   for (int j=0; j<nwords; ++j) {
-      if (cost[IDX(0,j)] >= 0.0) {
+      if (fits_first_line) {
          // no breaking needed: words 0..j fit in one line
-         f[j] = cost[IDX(0,j)];
+         f[j] = STRI__WRAP_COST(0,j);
          continue;
       }
 
       // let i = optimal way of printing of words 0..i + printing i+1..j
-      int i = 0;
-      while (i <= j) {
-         if (cost[IDX(i+1,j)] >= 0.0) break;
-         ++i;
-      }
-
-      double best_i = f[i] + cost[IDX(i+1,j)];
-      for (int k=i+1; k<j; ++k) {
-         if (cost[IDX(k+1,j)] < 0.0) continue;
-         double best_cur = f[k] + cost[IDX(k+1,j)];
+      R_len_t i = first-1;
+      double best_i = f[i] + STRI__WRAP_COST(i+1,j);
+      for (R_len_t k=i+1; k<j; ++k) {
+         double best_cur = f[k] + STRI__WRAP_COST(k+1,j);
          if (best_cur < best_i) {
             best_i = best_cur;
             i = k;
          }
       }
-      for (int k=0; k<i; ++k)
-         where[IDX(k,j)] = where[IDX(k,i)];
-      where[IDX(i,j)] = true;
+      wrap_prev[j] = i;
       f[j] = best_i;
    }
 
-   //result is in the last row of where...
-   for (int k=0; k<nwords; ++k)
-      if (where[IDX(k, nwords-1)])
-         wrap_after.push_back(k);
+#undef STRI__WRAP_COST
+#undef STRI__WRAP_BLANKS
+
+   // follow the back-links from the last word
+   std::deque<R_len_t> wrap_after_rev;
+   for (R_len_t k=wrap_prev[nwords-1]; k >= 0; k=wrap_prev[k])
+      wrap_after_rev.push_front(k);
+   wrap_after.insert(wrap_after.end(), wrap_after_rev.begin(), wrap_after_rev.end());
 }
 
 
@@ -241,6 +249,9 @@ struct StriWrapLineStart {
  *
  * @version 0.5-1 (Marek Gagolewski, 2015-06-09)
  *    BIGSKIP: no more CHARSXP on out on "" input
+ *
+ * @version 1.2.5 (Marek Gagolewski, 2018-07-28)
+ *    get the line break iterator from StriBrkIterCache
  */
 SEXP stri_wrap(SEXP str, SEXP width, SEXP cost_exponent,
    SEXP indent, SEXP exdent, SEXP prefix, SEXP initial, SEXP whitespace_only,
@@ -261,7 +272,6 @@ SEXP stri_wrap(SEXP str, SEXP width, SEXP cost_exponent,
 
 
    const char* qloc = stri__prepare_arg_locale(locale, "locale", true); /* this is R_alloc'ed */
-   Locale loc = Locale::createFromName(qloc);
    PROTECT(str     = stri_prepare_arg_string(str, "str"));
    PROTECT(prefix  = stri_prepare_arg_string_1(prefix, "prefix"));
    PROTECT(initial = stri_prepare_arg_string_1(initial, "initial"));
@@ -271,7 +281,7 @@ SEXP stri_wrap(SEXP str, SEXP width, SEXP cost_exponent,
 
    STRI__ERROR_HANDLER_BEGIN(3)
    UErrorCode status = U_ZERO_ERROR;
-   briter = BreakIterator::createLineInstance(loc, status);
+   briter = StriBrkIterCache::createInstance(UBRK_LINE, qloc, UnicodeString(), status);
    STRI__CHECKICUSTATUS_THROW(status, {/* do nothing special on err */})
 
    R_len_t str_length = LENGTH(str);